@@ -0,0 +1,28 @@
+// Build_Snapshot.cc.
+
+// This example converts a text lexicon into a binary snapshot. Snapshots hold the canonicalized lexicon along with the
+// precomputed state of the selected modules, so they can be loaded (in place of the text lexicon) with very little
+// startup cost. Snapshots are specific to the version of this library and to the host byte order.
+
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "Explicator.h"
+
+int main(int argc, char **argv) {
+    if((argc != 3) && (argc != 4)) {
+        throw std::runtime_error("Please provide a lexicon filename, a snapshot filename, and (optionally) a module mask.");
+    }
+    const std::string lexicon_filename(argv[1]);
+    const std::string snapshot_filename(argv[2]);
+    const uint64_t modmask = (argc == 4) ? std::stoull(argv[3], nullptr, 0) : Ex_Mods::Sane_Defaults;
+
+    Explicator X(lexicon_filename, modmask);
+    X.Write_Snapshot(snapshot_filename);
+
+    std::cerr << "Wrote snapshot of " << X.lexicon.size() << " lexicon entries to '" << snapshot_filename << "'"
+              << std::endl;
+    return 0;
+}
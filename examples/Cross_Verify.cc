@@ -2,6 +2,10 @@
 //
 // It takes a fraction of the lexicon, attempts to translate entries from the complete lexicon, and determines whether
 // or not the translation was successful by comparing the output to the actual value.
+//
+// If a candidate limit is given, cheap shortlisting modules are enabled alongside the defaults and cascaded matching
+// is used (see Explicator::cascade_candidate_limit). An extra column reports the change in the fraction of correct
+// translations relative to exhaustive matching.
 
 #include <iostream>
 #include <stdexcept>
@@ -11,12 +15,16 @@
 #include "Explicator.h"
 
 int main(int argc, char **argv) {
-    if(argc != 2) {
-        throw std::runtime_error("Please provide a lexicon filename.");
+    if((argc != 2) && (argc != 3)) {
+        throw std::runtime_error("Usage: " + std::string(argv[0]) + " lexicon [cascade_candidate_limit]");
     }
     const std::string filename(argv[1]);
+    const long int candidate_limit = (argc == 3) ? std::stol(argv[2]) : 0;
+    const bool cascade             = (candidate_limit > 0);
 
-    Explicator X(filename);
+    Explicator X(filename, cascade ? (Ex_Mods::Sane_Defaults | Ex_Mods::NGrams | Ex_Mods::Dbl_Metaphone)
+                                   : Ex_Mods::Sane_Defaults);
+    if(cascade) X.cascade_candidate_limit = static_cast<size_t>(candidate_limit);
 
     const bool beverbose = false;
 
@@ -26,8 +34,8 @@ int main(int argc, char **argv) {
 
     std::cout << "# Generated by Cross_Verify(...)." << std::endl;
     std::cout << "# Columns: lexicon_threshold(%), frac_of_lexicon(%), frac_correct, frac_false_neg, frac_false_pos, "
-                 "frac_theo_best."
-              << std::endl;
+                 "frac_theo_best"
+              << (cascade ? ", cascade_delta_frac_correct." : ".") << std::endl;
     std::cout << "# Each column is a fraction of the total number of translations." << std::endl;
     for(long int t = 100; t >= 5; t -= 5) {     // Threshold, percent.
         for(long int f = 100; f >= 5; f -= 5) { // Lexicon fraction, percent.
@@ -35,9 +43,12 @@ int main(int argc, char **argv) {
             const float threshold = static_cast<float>(t) / 100.0;
 
             X.group_threshold = threshold;
-            const auto res = X.Cross_Verify(frac, 5, beverbose);
+            float cascade_delta = 0.0;
+            const auto res      = X.Cross_Verify(frac, 5, beverbose, {}, {}, &cascade_delta);
             std::cout << t << " " << f << " " << std::get<0>(res) << " " << std::get<2>(res) << " " << std::get<3>(res)
-                      << " " << std::get<1>(res) << std::endl;
+                      << " " << std::get<1>(res);
+            if(cascade) std::cout << " " << cascade_delta;
+            std::cout << std::endl;
         }
     }
 
@@ -0,0 +1,80 @@
+// DICOM_Hash_Search_Report.cc - A program which compares the exhaustive and sub-linear DICOM_Hash search modes.
+//
+// The DICOM_Hash module can either scan the whole lexicon or use multi-index hashing to consider only the lexicon
+// entries within some Hamming radius of the query. This program perturbs every dirty string in the lexicon, translates
+// them using each search radius, and reports the speed and how often the result agrees with the exhaustive scan.
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Explicator.h"
+
+int main(int argc, char **argv) {
+    if(argc != 2) {
+        throw std::runtime_error("Please provide a lexicon filename.");
+    }
+    const std::string filename(argv[1]);
+
+    Explicator X(filename, Ex_Mods::DICOM_Hash);
+
+    // Generate queries which are not (usually) exact matches by deleting, swapping, and appending characters.
+    std::vector<std::string> queries;
+    for(const auto &apair : X.lexicon) {
+        const std::string &dirty = apair.first;
+        const auto mid           = dirty.size() / 2;
+        if(dirty.size() > 1) {
+            queries.push_back(dirty.substr(0, mid) + dirty.substr(mid + 1));
+            std::string swapped(dirty);
+            std::swap(swapped[mid - 1], swapped[mid]);
+            queries.push_back(swapped);
+        }
+        queries.push_back(dirty + "_2");
+    }
+
+    // Translates all queries, returning the mean time per query (in microseconds).
+    std::vector<std::string> outputs(queries.size());
+    std::vector<std::map<std::string, float>> results(queries.size());
+    const auto run_all = [&](void) -> double {
+        const auto t_start = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < queries.size(); ++i) {
+            outputs[i] = X(queries[i]);
+            results[i] = *(X.Get_Last_Results());
+        }
+        const auto t_stop = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::micro>(t_stop - t_start).count() / static_cast<double>(queries.size());
+    };
+
+    X.dicom_hash_search_radius = -1;
+    const double exhaustive_time = run_all();
+    const auto exhaustive_outputs = outputs;
+    const auto exhaustive_results = results;
+
+    std::cout << "# Generated by DICOM_Hash_Search_Report(...)." << std::endl;
+    std::cout << "# Queries: " << queries.size() << ". Exhaustive scan: " << exhaustive_time << " us/query." << std::endl;
+    std::cout << "# Columns: radius, us_per_query, speedup, frac_same_translation, frac_candidates_recalled."
+              << std::endl;
+    for(long int r : {0L, 2L, 4L, 6L, 8L, 10L, 12L, 15L, 20L, 25L, 55L}) {
+        X.dicom_hash_search_radius = r;
+        const double t = run_all();
+
+        size_t same = 0, recalled = 0, total = 0;
+        for(size_t i = 0; i < queries.size(); ++i) {
+            if(outputs[i] == exhaustive_outputs[i]) ++same;
+            for(const auto &c : exhaustive_results[i]) {
+                ++total;
+                if(results[i].count(c.first) != 0) ++recalled;
+            }
+        }
+        const double frac_same     = static_cast<double>(same) / static_cast<double>(queries.size());
+        const double frac_recalled = (total == 0) ? 1.0 : static_cast<double>(recalled) / static_cast<double>(total);
+        std::cout << r << " " << t << " " << (exhaustive_time / t) << " " << frac_same << " " << frac_recalled
+                  << std::endl;
+    }
+    return 0;
+}
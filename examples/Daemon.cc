@@ -0,0 +1,174 @@
+// Daemon.cc.
+
+// This example loads one or more lexicons once and serves translation requests over a Unix domain socket. Each lexicon
+// is given a name, which clients use to select it. Every connection is served by its own thread, up to
+// Max_Connections at once; further connections are sent an error and closed. Requests on a connection are handled in
+// order, so clients can pipeline batches. See Explicator_Client.h for a client,
+// Daemon_Protocol.h for the wire protocol, and Daemon_Client.cc for a command-line client.
+//
+// The daemon runs until it receives SIGINT or SIGTERM, at which point the socket file is removed.
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Explicator.h"
+#include "Daemon_Protocol.h"
+
+using namespace explicator_internals;
+
+static int signal_pipe[2] = {-1, -1};
+
+// The number of connections served at once. Each has a thread of its own.
+static const size_t Max_Connections = 64;
+static std::atomic<size_t> active_connections(0);
+
+static void Handle_Signal(int) {
+    const char c = 0;
+    const auto n = write(signal_pipe[1], &c, 1);
+    (void)n;
+}
+
+// Serves a single connection until the client disconnects or an I/O error occurs.
+static void Serve(int fd, const std::map<std::string, std::unique_ptr<Explicator>> &explicators) {
+    try {
+        std::string payload;
+        std::string lexicon;
+        std::vector<std::string> dirties;
+        while(Read_Frame(fd, payload)) {
+            const auto t_start = std::chrono::steady_clock::now();
+            const auto elapsed = [&](void) -> uint64_t {
+                return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                 std::chrono::steady_clock::now() - t_start)
+                                                 .count());
+            };
+
+            std::string response;
+            try {
+                Decode_Translate_Request(payload, lexicon, dirties);
+                const auto it = explicators.find(lexicon);
+                if(it == explicators.end()) throw std::invalid_argument("No lexicon named '" + lexicon + "'");
+
+                std::vector<Explicator_Client_Result> results(dirties.size());
+                for(size_t i = 0; i < dirties.size(); ++i) {
+                    auto t            = it->second->Translate(dirties[i]);
+                    results[i].clean  = std::move(t.clean);
+                    results[i].score  = t.best_score;
+                    results[i].module = t.best_module;
+                }
+                response = Encode_Translate_Response(results, elapsed());
+            } catch(const std::exception &e) {
+                response = Encode_Error_Response(e.what(), elapsed());
+            }
+            Write_Frame(fd, response);
+        }
+    } catch(const std::exception &e) {
+        std::cerr << "Dropping connection: " << e.what() << std::endl;
+    }
+    close(fd);
+    --active_connections;
+}
+
+int main(int argc, char **argv) {
+    if(argc < 3) {
+        throw std::runtime_error("Usage: " + std::string(argv[0])
+                                 + " socket_path [name=]lexicon [[name=]lexicon ...]\n"
+                                   "  Lexicons are selected by name. If no name is given, the filename is used.");
+    }
+    const std::string socket_path(argv[1]);
+
+    std::map<std::string, std::unique_ptr<Explicator>> explicators;
+    for(int i = 2; i < argc; ++i) {
+        const std::string arg(argv[i]);
+        const auto eq              = arg.find('=');
+        const std::string name     = (eq == std::string::npos) ? arg : arg.substr(0, eq);
+        const std::string filename = (eq == std::string::npos) ? arg : arg.substr(eq + 1);
+        if(explicators.count(name) != 0) throw std::invalid_argument("Lexicon name '" + name + "' is used twice");
+
+        std::unique_ptr<Explicator> X(new Explicator(filename));
+        if(X->lexicon.empty()) throw std::runtime_error("The lexicon '" + filename + "' is empty");
+
+        // Module state is global, so each lexicon needs a generation of its own to be served alongside the others.
+        X->Reload();
+        explicators.emplace(name, std::move(X));
+        std::cerr << "Loaded lexicon '" << name << "' from '" << filename << "'" << std::endl;
+    }
+
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(sizeof(addr.sun_path) <= socket_path.size()) {
+        throw std::runtime_error("Socket path '" + socket_path + "' is too long");
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if((listen_fd < 0) || (bind(listen_fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0)
+       || (listen(listen_fd, SOMAXCONN) != 0)) {
+        throw std::runtime_error("Unable to listen on '" + socket_path + "': " + std::strerror(errno));
+    }
+
+    if(pipe(signal_pipe) != 0) throw std::runtime_error("Unable to create signal pipe");
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = Handle_Signal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    std::cerr << "Listening on '" << socket_path << "'" << std::endl;
+
+    // Connection threads are detached; they only read the explicators, which outlive them since the process exits
+    // directly after the accept loop.
+    while(true) {
+        pollfd fds[2] = {{listen_fd, POLLIN, 0}, {signal_pipe[0], POLLIN, 0}};
+        if(poll(fds, 2, -1) < 0) {
+            if(errno == EINTR) continue;
+            break;
+        }
+        if(fds[1].revents != 0) break;
+        if((fds[0].revents & POLLIN) == 0) continue;
+
+        const int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if(fd < 0) continue;
+        if(Max_Connections <= active_connections.load()) {
+            // The error is sent as the reply to the client's first request, which it reads after sending. The frame is
+            // small enough to fit in the socket buffer of a new connection, so the write does not block.
+            try {
+                Write_Frame(fd, Encode_Error_Response("Too many connections", 0));
+            } catch(const std::exception &) {
+            }
+            close(fd);
+            continue;
+        }
+        ++active_connections;
+        try {
+            std::thread(Serve, fd, std::cref(explicators)).detach();
+        } catch(const std::exception &e) {
+            std::cerr << "Unable to serve connection: " << e.what() << std::endl;
+            close(fd);
+            --active_connections;
+        }
+    }
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    std::cerr << "Shutting down" << std::endl;
+    std::_Exit(0);
+}
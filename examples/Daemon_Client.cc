@@ -0,0 +1,115 @@
+// Daemon_Client.cc.
+
+// This example sends strings, one per line read from stdin, to a running explicator daemon (see Daemon.cc) for
+// translation. Lines are sent in batches, and several batches are kept outstanding so the daemon is never idle waiting
+// on the client. Each input line produces one output line (in input order) on stdout with the tab-separated clean
+// string, score, and the module which contributed most to the translation.
+//
+// The latency of each batch is reported on stderr: the round-trip time seen by the client and the time the daemon
+// spent translating. Pass '-q' to suppress the per-batch report and only print a summary.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Explicator.h"
+#include "Explicator_Client.h"
+
+int main(int argc, char **argv) {
+    if(argc < 3) {
+        throw std::runtime_error("Usage: " + std::string(argv[0])
+                                 + " socket_path lexicon_name [-b batch_size] [-w window] [-q] < input > output\n"
+                                   "  -b batch_size Lines per request (default: 256).\n"
+                                   "  -w window     Maximum number of outstanding requests (default: 8).\n"
+                                   "  -q            Only report a latency summary rather than every request.");
+    }
+    const std::string socket_path(argv[1]);
+    const std::string lexicon(argv[2]);
+    size_t batch_size = 256;
+    size_t window     = 8;
+    bool quiet        = false;
+    for(int i = 3; i < argc; ++i) {
+        const std::string opt(argv[i]);
+        if(opt == "-q") {
+            quiet = true;
+            continue;
+        }
+        if((i + 1) >= argc) throw std::runtime_error("Option '" + opt + "' requires an argument");
+        const std::string val(argv[++i]);
+        if(opt == "-b") {
+            batch_size = static_cast<size_t>(std::stol(val));
+        } else if(opt == "-w") {
+            window = static_cast<size_t>(std::stol(val));
+        } else {
+            throw std::runtime_error("Unrecognized option '" + opt + "'");
+        }
+    }
+    if(batch_size == 0) batch_size = 1;
+    if(window == 0) window = 1;
+
+    Explicator_Client client(socket_path);
+
+    using clock = std::chrono::steady_clock;
+    std::deque<clock::time_point> sent; // Send times of the outstanding requests, oldest first.
+    uint64_t N_received = 0;
+    double total_rtt_us = 0.0, total_daemon_us = 0.0, max_rtt_us = 0.0;
+
+    const auto receive = [&](void) {
+        uint64_t daemon_ns = 0;
+        const auto results = client.Receive(&daemon_ns);
+        const auto rtt_us  = std::chrono::duration<double, std::micro>(clock::now() - sent.front()).count();
+        const auto dmn_us  = static_cast<double>(daemon_ns) / 1000.0;
+        sent.pop_front();
+
+        for(const auto &res : results) {
+            std::cout << res.clean << '\t' << res.score << '\t' << Ex_Mods::Name(res.module) << '\n';
+        }
+        if(!quiet) {
+            std::cerr << "request " << N_received << ": " << results.size() << " strings, round-trip " << rtt_us
+                      << " us, daemon " << dmn_us << " us" << std::endl;
+        }
+        ++N_received;
+        total_rtt_us += rtt_us;
+        total_daemon_us += dmn_us;
+        if(max_rtt_us < rtt_us) max_rtt_us = rtt_us;
+    };
+
+    std::ios_base::sync_with_stdio(false);
+    std::string line;
+    std::vector<std::string> batch;
+    const auto send = [&](void) {
+        if(sent.size() >= window) receive();
+        sent.push_back(clock::now());
+        client.Send(lexicon, batch);
+        batch.clear();
+    };
+    try {
+        while(std::getline(std::cin, line)) {
+            if(!line.empty() && (line.back() == '\r')) line.pop_back();
+            batch.push_back(std::move(line));
+            if(batch.size() == batch_size) send();
+        }
+        if(!batch.empty()) send();
+        while(!sent.empty()) receive();
+    } catch(const std::exception &e) {
+        std::cout.flush();
+        std::cerr << "Translation failed: " << e.what() << std::endl;
+        return 1;
+    }
+    std::cout.flush();
+
+    if(N_received != 0) {
+        std::cerr << N_received << " requests: mean round-trip " << (total_rtt_us / N_received)
+                  << " us, max round-trip " << max_rtt_us << " us, mean daemon " << (total_daemon_us / N_received)
+                  << " us" << std::endl;
+    }
+    return 0;
+}
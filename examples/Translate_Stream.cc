@@ -0,0 +1,207 @@
+// Translate_Stream.cc.
+
+// This example translates a stream of strings, one per line, read from stdin. Either the whole line or a single column
+// of a TSV or CSV file is translated. The lexicon is loaded once and the lines are translated by a pool of worker
+// threads. Each input line produces one output line (in input order) on stdout with the tab-separated clean string,
+// score, and the module which contributed most to the translation.
+//
+// Lines are handled in batches, and only a fixed number of batches can be in flight at once, so memory use does not
+// grow with the length of the input.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Explicator.h"
+
+static const size_t Batch_Size         = 256; // Lines per batch.
+static const size_t Batches_Per_Worker = 4;   // Bounds the number of batches in flight.
+
+// Extracts the requested (1-based) column. Column 0 selects the whole line. For comma-separated input, double-quoted
+// fields (with "" as an escaped quote) are supported.
+static std::string Extract_Column(const std::string &line, long int column, char delim) {
+    if(column <= 0) return line;
+
+    long int current = 1;
+    std::string field;
+    bool quoted = false;
+    for(size_t i = 0; i < line.size(); ++i) {
+        const char c = line[i];
+        if((delim == ',') && (c == '"')) {
+            if(quoted && ((i + 1) < line.size()) && (line[i + 1] == '"')) {
+                field.push_back('"');
+                ++i;
+            } else {
+                quoted = !quoted;
+            }
+        } else if((c == delim) && !quoted) {
+            if(current == column) return field;
+            ++current;
+            field.clear();
+        } else {
+            field.push_back(c);
+        }
+    }
+    return (current == column) ? field : std::string();
+}
+
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        throw std::runtime_error("Usage: " + std::string(argv[0])
+                                 + " lexicon [-c column] [-d delimiter] [-j threads] [-m memo] < input > output\n"
+                                   "  -c column    Translate only this 1-based column rather than the whole line.\n"
+                                   "  -d delimiter Column delimiter: 'tab' (default), 'comma', or a single character.\n"
+                                   "  -j threads   Number of worker threads (default: all available).\n"
+                                   "  -m memo      Reuse and record translations in this memo file across runs.");
+    }
+    const std::string filename(argv[1]);
+    long int column  = 0;
+    char delim       = '\t';
+    size_t N_workers = std::thread::hardware_concurrency();
+    std::string memo_filename;
+    for(int i = 2; i < argc; ++i) {
+        const std::string opt(argv[i]);
+        if((i + 1) >= argc) throw std::runtime_error("Option '" + opt + "' requires an argument");
+        const std::string val(argv[++i]);
+        if(opt == "-c") {
+            column = std::stol(val);
+        } else if(opt == "-d") {
+            delim = (val == "tab") ? '\t' : (val == "comma") ? ',' : (val.size() == 1) ? val[0] : '\0';
+            if(delim == '\0') throw std::runtime_error("Unrecognized delimiter '" + val + "'");
+        } else if(opt == "-j") {
+            N_workers = static_cast<size_t>(std::stol(val));
+        } else if(opt == "-m") {
+            memo_filename = val;
+        } else {
+            throw std::runtime_error("Unrecognized option '" + opt + "'");
+        }
+    }
+    if(N_workers == 0) N_workers = 1;
+
+    Explicator X(filename);
+    if(X.lexicon.empty()) {
+        throw std::runtime_error("The lexicon is empty");
+    }
+    if(!memo_filename.empty()) X.Attach_Memo(memo_filename);
+
+    // Shared state. Batches flow from the reader (this thread) to the workers via 'pending' and on to the writer via
+    // 'finished'. The writer emits batches strictly in sequence order.
+    std::mutex m;
+    std::condition_variable cv_reader, cv_workers, cv_writer;
+    std::deque<std::pair<uint64_t, std::vector<std::string>>> pending;
+    std::map<uint64_t, std::string> finished;
+    const size_t max_in_flight = Batches_Per_Worker * N_workers;
+    size_t in_flight = 0;
+    uint64_t N_read  = 0; // Number of batches read so far.
+    bool input_done  = false;
+    bool failed      = false;
+    std::string error;
+
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < N_workers; ++i) {
+        workers.emplace_back([&](void) {
+            while(true) {
+                std::pair<uint64_t, std::vector<std::string>> batch;
+                {
+                    std::unique_lock<std::mutex> lock(m);
+                    cv_workers.wait(lock, [&](void) { return !pending.empty() || input_done || failed; });
+                    if(pending.empty() || failed) return;
+                    batch = std::move(pending.front());
+                    pending.pop_front();
+                }
+
+                std::ostringstream os;
+                try {
+                    for(const auto &line : batch.second) {
+                        const auto t = X.Translate(Extract_Column(line, column, delim));
+                        os << t.clean << '\t' << t.best_score << '\t' << Ex_Mods::Name(t.best_module) << '\n';
+                    }
+                } catch(const std::exception &e) {
+                    std::lock_guard<std::mutex> lock(m);
+                    failed = true;
+                    error  = e.what();
+                    cv_reader.notify_all();
+                    cv_workers.notify_all();
+                    cv_writer.notify_all();
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(m);
+                finished.emplace(batch.first, os.str());
+                cv_writer.notify_one();
+            }
+        });
+    }
+
+    std::thread writer([&](void) {
+        uint64_t next = 0;
+        while(true) {
+            std::string out;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv_writer.wait(lock, [&](void) {
+                    return (finished.count(next) != 0) || (input_done && (next == N_read)) || failed;
+                });
+                if(failed || (finished.count(next) == 0)) return;
+                out = std::move(finished[next]);
+                finished.erase(next);
+            }
+            std::fwrite(out.data(), 1, out.size(), stdout);
+            ++next;
+
+            std::lock_guard<std::mutex> lock(m);
+            --in_flight;
+            cv_reader.notify_one();
+        }
+    });
+
+    // Read the input in batches, waiting whenever too many batches are in flight.
+    std::ios_base::sync_with_stdio(false);
+    std::string line;
+    std::vector<std::string> batch;
+    const auto submit = [&](void) -> bool {
+        std::unique_lock<std::mutex> lock(m);
+        cv_reader.wait(lock, [&](void) { return (in_flight < max_in_flight) || failed; });
+        if(failed) return false;
+        ++in_flight;
+        pending.emplace_back(N_read++, std::move(batch));
+        batch = std::vector<std::string>();
+        cv_workers.notify_one();
+        return true;
+    };
+    bool ok = true;
+    while(ok && std::getline(std::cin, line)) {
+        if(!line.empty() && (line.back() == '\r')) line.pop_back();
+        batch.push_back(std::move(line));
+        if(batch.size() == Batch_Size) ok = submit();
+    }
+    if(ok && !batch.empty()) submit();
+    {
+        std::lock_guard<std::mutex> lock(m);
+        input_done = true;
+        cv_workers.notify_all();
+        cv_writer.notify_all();
+    }
+
+    for(auto &w : workers) w.join();
+    writer.join();
+    std::fflush(stdout);
+
+    if(failed) {
+        std::cerr << "Translation failed: " << error << std::endl;
+        return 1;
+    }
+    return 0;
+}
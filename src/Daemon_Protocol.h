@@ -0,0 +1,48 @@
+// Daemon_Protocol.h - The wire protocol spoken by the explicator daemon and Explicator_Client.
+//
+// This header is not installed, so the protocol can change along with the library and the daemon.
+//
+// Wire protocol. Every message is a frame: a uint32_t payload size followed by the payload. Both peers are on the same
+// host, so all values are in native byte order and are encoded as per Snapshot_Writer.
+//
+//    Request:   uint8_t  opcode (1 = translate)
+//               string   lexicon name
+//               uint64_t N, then N dirty strings
+//
+//    Response:  uint8_t  status (0 = OK, 1 = error)
+//               uint64_t nanoseconds the daemon spent handling the request
+//               if OK:    uint64_t N, then N x {string clean, float score, uint64_t module (see Ex_Mods)}
+//               if error: string message
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "Explicator_Client.h"
+
+namespace explicator_internals {
+
+const uint8_t Daemon_Op_Translate  = 1;
+const uint8_t Daemon_Status_OK     = 0;
+const uint8_t Daemon_Status_Error  = 1;
+const uint32_t Daemon_Max_Frame    = 64 * 1024 * 1024; // Larger frames are rejected.
+
+// Reads one frame. Returns false if the peer closed the connection cleanly before the frame began. Throws
+// std::runtime_error on I/O errors, truncated frames, or frames larger than Daemon_Max_Frame.
+bool Read_Frame(int fd, std::string &payload);
+
+// Writes one frame. Throws std::runtime_error on I/O errors.
+void Write_Frame(int fd, const std::string &payload);
+
+std::string Encode_Translate_Request(const std::string &lexicon, const std::vector<std::string> &dirties);
+
+// Throws std::runtime_error if the request is malformed.
+void Decode_Translate_Request(const std::string &payload, std::string &lexicon, std::vector<std::string> &dirties);
+
+std::string Encode_Translate_Response(const std::vector<Explicator_Client_Result> &results, uint64_t daemon_ns);
+std::string Encode_Error_Response(const std::string &message, uint64_t daemon_ns);
+
+} //namespace explicator_internals
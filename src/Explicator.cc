@@ -1,9 +1,21 @@
 // Explicator.cc - DICOMautomaton, 2012.
 //
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -12,17 +24,25 @@
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <random> //Needed in Cross_Check member function.
-#include <regex>
+#include <set>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "Explicator.h"
-#include "Files.h"  //Needed for Does_File_Exist_And_Can_Be_Read(...)
+#include "Explicator_Query.h"
+#include "Files.h"  //Needed for Mapped_File.
+#include "Memo.h"
+#include "Perfect_Hash.h"
 #include "Misc.h"   //Needed for FUNCEXPLICATORINFO(), FUNCEXPLICATORERR(), FUNCEXPLICATORWARN() macros.
+#include "Snapshot.h"
 #include "String.h" //Needed for Canonicalization().
 
 #include "Explicator_Module_DICOM_Hash.h"
@@ -39,21 +59,412 @@
 
 using namespace explicator_internals;
 
+// Lexicon snapshot layout. The header is followed by a payload of exactly 'payload_size' bytes:
+//
+//    char[8]   magic ("EXPLSNAP")
+//    uint32_t  version
+//    uint32_t  byte order marker (0x01020304, in the writer's byte order)
+//    uint64_t  payload size
+//    uint64_t  payload checksum (see Snapshot_Checksum())
+//
+// The payload holds the table of unique cleans, the <dirty, clean ID> entries in lexicon order, the exact-match and
+// normalized-key indexes of the lexicon, the module mask, and the saved state of each module along with the module's ID
+// and threshold.
+static const char Snapshot_Magic[8]       = {'E', 'X', 'P', 'L', 'S', 'N', 'A', 'P'};
+static const uint32_t Snapshot_Version    = 2;
+static const uint32_t Snapshot_Byte_Order = 0x01020304;
+static const size_t Snapshot_Header_Size  = sizeof(Snapshot_Magic) + 2 * sizeof(uint32_t) + 2 * sizeof(uint64_t);
+
+// The compiled-in modules and the routines each provides (see Explicator.h). Optional routines which a module does
+// not provide are null. Modules are run and their results combined in this order.
+struct Explicator_Module_Functions {
+    uint64_t id;
+    explicator_module_func_init init;
+    explicator_module_func_query query;
+    explicator_module_func_deinit deinit;
+    explicator_module_func_save save;
+    explicator_module_func_load load;
+    explicator_module_func_build build;
+    explicator_module_func_query_state query_state;
+    explicator_module_func_query_v2 query_v2;
+    explicator_module_func_edit add;
+    explicator_module_func_edit remove;
+    explicator_module_func_edit_state add_state;
+    explicator_module_func_edit_state remove_state;
+    bool top_k; // Honours Explicator_Query::Top_K() and Explicator_Query::Restrict_Candidates().
+};
+
+static const Explicator_Module_Functions Module_Functions[] = {
+    {Ex_Mods::Levenshtein,
+     Explicator_Module_Levenshtein_Init,
+     Explicator_Module_Levenshtein_Query,
+     Explicator_Module_Levenshtein_Deinit,
+     Explicator_Module_Levenshtein_Save,
+     Explicator_Module_Levenshtein_Load,
+     Explicator_Module_Levenshtein_Build,
+     Explicator_Module_Levenshtein_Query_State,
+     Explicator_Module_Levenshtein_Query_V2,
+     Explicator_Module_Levenshtein_Add,
+     Explicator_Module_Levenshtein_Remove,
+     Explicator_Module_Levenshtein_Add_State,
+     Explicator_Module_Levenshtein_Remove_State,
+     true},
+    {Ex_Mods::DICOM_Hash,
+     Explicator_Module_DICOM_Hash_Init,
+     Explicator_Module_DICOM_Hash_Query,
+     Explicator_Module_DICOM_Hash_Deinit,
+     Explicator_Module_DICOM_Hash_Save,
+     Explicator_Module_DICOM_Hash_Load,
+     Explicator_Module_DICOM_Hash_Build,
+     Explicator_Module_DICOM_Hash_Query_State,
+     Explicator_Module_DICOM_Hash_Query_V2,
+     Explicator_Module_DICOM_Hash_Add,
+     Explicator_Module_DICOM_Hash_Remove,
+     Explicator_Module_DICOM_Hash_Add_State,
+     Explicator_Module_DICOM_Hash_Remove_State,
+     false},
+    {Ex_Mods::Emplacement,
+     Explicator_Module_Emplacement_Init,
+     Explicator_Module_Emplacement_Query,
+     Explicator_Module_Emplacement_Deinit,
+     Explicator_Module_Emplacement_Save,
+     Explicator_Module_Emplacement_Load,
+     Explicator_Module_Emplacement_Build,
+     Explicator_Module_Emplacement_Query_State,
+     Explicator_Module_Emplacement_Query_V2,
+     Explicator_Module_Emplacement_Add,
+     Explicator_Module_Emplacement_Remove,
+     Explicator_Module_Emplacement_Add_State,
+     Explicator_Module_Emplacement_Remove_State,
+     false},
+    {Ex_Mods::NGrams,
+     Explicator_Module_NGrams_Init,
+     Explicator_Module_NGrams_Query,
+     Explicator_Module_NGrams_Deinit,
+     Explicator_Module_NGrams_Save,
+     Explicator_Module_NGrams_Load,
+     Explicator_Module_NGrams_Build,
+     Explicator_Module_NGrams_Query_State,
+     Explicator_Module_NGrams_Query_V2,
+     Explicator_Module_NGrams_Add,
+     Explicator_Module_NGrams_Remove,
+     Explicator_Module_NGrams_Add_State,
+     Explicator_Module_NGrams_Remove_State,
+     false},
+    {Ex_Mods::Soundex,
+     Explicator_Module_Soundex_Init,
+     Explicator_Module_Soundex_Query,
+     Explicator_Module_Soundex_Deinit,
+     nullptr,
+     nullptr,
+     Explicator_Module_Soundex_Build,
+     Explicator_Module_Soundex_Query_State,
+     Explicator_Module_Soundex_Query_V2,
+     Explicator_Module_Soundex_Add,
+     Explicator_Module_Soundex_Remove,
+     Explicator_Module_Soundex_Add_State,
+     Explicator_Module_Soundex_Remove_State,
+     false},
+    {Ex_Mods::MRA,
+     Explicator_Module_MRA_Init,
+     Explicator_Module_MRA_Query,
+     Explicator_Module_MRA_Deinit,
+     nullptr,
+     nullptr,
+     Explicator_Module_MRA_Build,
+     Explicator_Module_MRA_Query_State,
+     Explicator_Module_MRA_Query_V2,
+     Explicator_Module_MRA_Add,
+     Explicator_Module_MRA_Remove,
+     Explicator_Module_MRA_Add_State,
+     Explicator_Module_MRA_Remove_State,
+     false},
+    {Ex_Mods::Dbl_Metaphone,
+     Explicator_Module_Double_Metaphone_Init,
+     Explicator_Module_Double_Metaphone_Query,
+     Explicator_Module_Double_Metaphone_Deinit,
+     nullptr,
+     nullptr,
+     Explicator_Module_Double_Metaphone_Build,
+     Explicator_Module_Double_Metaphone_Query_State,
+     Explicator_Module_Double_Metaphone_Query_V2,
+     Explicator_Module_Double_Metaphone_Add,
+     Explicator_Module_Double_Metaphone_Remove,
+     Explicator_Module_Double_Metaphone_Add_State,
+     Explicator_Module_Double_Metaphone_Remove_State,
+     false},
+    {Ex_Mods::DS_Head_Neck,
+     Explicator_Module_DS_Head_and_Neck_Init,
+     Explicator_Module_DS_Head_and_Neck_Query,
+     Explicator_Module_DS_Head_and_Neck_Deinit,
+     nullptr,
+     nullptr,
+     Explicator_Module_DS_Head_and_Neck_Build,
+     Explicator_Module_DS_Head_and_Neck_Query_State,
+     Explicator_Module_DS_Head_and_Neck_Query_V2,
+     Explicator_Module_DS_Head_and_Neck_Add,
+     Explicator_Module_DS_Head_and_Neck_Remove,
+     Explicator_Module_DS_Head_and_Neck_Add_State,
+     Explicator_Module_DS_Head_and_Neck_Remove_State,
+     false},
+    {Ex_Mods::Subsequence,
+     Explicator_Module_Subsequence_Init,
+     Explicator_Module_Subsequence_Query,
+     Explicator_Module_Subsequence_Deinit,
+     Explicator_Module_Subsequence_Save,
+     Explicator_Module_Subsequence_Load,
+     Explicator_Module_Subsequence_Build,
+     Explicator_Module_Subsequence_Query_State,
+     Explicator_Module_Subsequence_Query_V2,
+     Explicator_Module_Subsequence_Add,
+     Explicator_Module_Subsequence_Remove,
+     Explicator_Module_Subsequence_Add_State,
+     Explicator_Module_Subsequence_Remove_State,
+     false},
+    {Ex_Mods::JaroWinkler,
+     Explicator_Module_JaroWinkler_Init,
+     Explicator_Module_JaroWinkler_Query,
+     Explicator_Module_JaroWinkler_Deinit,
+     Explicator_Module_JaroWinkler_Save,
+     Explicator_Module_JaroWinkler_Load,
+     Explicator_Module_JaroWinkler_Build,
+     Explicator_Module_JaroWinkler_Query_State,
+     Explicator_Module_JaroWinkler_Query_V2,
+     Explicator_Module_JaroWinkler_Add,
+     Explicator_Module_JaroWinkler_Remove,
+     Explicator_Module_JaroWinkler_Add_State,
+     Explicator_Module_JaroWinkler_Remove_State,
+     true},
+    {Ex_Mods::Substrings,
+     Explicator_Module_Substrings_Init,
+     Explicator_Module_Substrings_Query,
+     Explicator_Module_Substrings_Deinit,
+     Explicator_Module_Substrings_Save,
+     Explicator_Module_Substrings_Load,
+     Explicator_Module_Substrings_Build,
+     Explicator_Module_Substrings_Query_State,
+     Explicator_Module_Substrings_Query_V2,
+     Explicator_Module_Substrings_Add,
+     Explicator_Module_Substrings_Remove,
+     Explicator_Module_Substrings_Add_State,
+     Explicator_Module_Substrings_Remove_State,
+     true},
+};
+
+// Returns the routines of a compiled-in module, or nullptr if there is no such module.
+static const Explicator_Module_Functions *Find_Module_Functions(uint64_t mod) {
+    for(const auto &f : Module_Functions) {
+        if(f.id == mod) return &f;
+    }
+    return nullptr;
+}
+
+// Relative cost of querying each module, cheapest first, used to order modules for early termination. Modules which
+// look up precomputed keys are cheap, and those which compare the query against every lexicon entry are expensive.
+static int Module_Cost_Rank(uint64_t mod) {
+    switch(mod) {
+        case Ex_Mods::Soundex: return 0;
+        case Ex_Mods::DICOM_Hash: return 1;
+        case Ex_Mods::Dbl_Metaphone: return 2;
+        case Ex_Mods::DS_Head_Neck: return 3;
+        case Ex_Mods::NGrams: return 4;
+        case Ex_Mods::MRA: return 5;
+        case Ex_Mods::Subsequence: return 6;
+        case Ex_Mods::Emplacement: return 7;
+        case Ex_Mods::JaroWinkler: return 8;
+        case Ex_Mods::Levenshtein: return 9;
+        case Ex_Mods::Substrings: return 10;
+        default: return 11;
+    }
+}
+
+// A sharded LRU cache of complete translations, keyed on the canonicalized dirty string.
+//
+// Entries are tagged with an epoch, which is advanced whenever the lexicon or modules change, and a fingerprint of the
+// configuration (weights, thresholds, etc.) they were computed with. A shard discards its entries when it sees a newer
+// epoch or a different fingerprint, and translations computed under an older epoch are never inserted. Readers load the
+// epoch before the lexicon generation, and writers advance it after publishing a new one, so a stale translation can
+// not be cached under the new epoch.
+class Explicator_Cache {
+  public:
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+    explicit Explicator_Cache(size_t capacity) : shard_capacity((capacity + N_Shards - 1) / N_Shards) {}
+
+    bool Find(const std::string &key, uint64_t at_epoch, uint64_t config, Explicator_Translation &out) {
+        auto &s = this->Shard_For(key);
+        std::lock_guard<std::mutex> lock(s.m);
+        if(!Sync(s, at_epoch, config)) return false;
+        const auto it = s.index.find(key);
+        if(it == s.index.end()) return false;
+
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        const auto &e   = *(it->second);
+        out.clean             = e.clean;
+        out.best_score        = e.best_score;
+        out.best_module       = e.best_module;
+        out.completed_modules = e.completed_modules;
+        out.results.reset(new std::map<std::string, float>(e.results));
+        return true;
+    }
+
+    void Insert(const std::string &key, uint64_t at_epoch, uint64_t config, const Explicator_Translation &t) {
+        auto &s = this->Shard_For(key);
+        std::lock_guard<std::mutex> lock(s.m);
+        if(!Sync(s, at_epoch, config) || (s.index.count(key) != 0)) return;
+
+        s.lru.push_front({key, t.clean, t.best_score, t.best_module, t.completed_modules, *(t.results)});
+        s.index.emplace(key, s.lru.begin());
+        while(this->shard_capacity < s.lru.size()) {
+            s.index.erase(s.lru.back().key);
+            s.lru.pop_back();
+        }
+    }
+
+    // Advances the epoch and frees the entries of every shard.
+    void Invalidate(void) {
+        const auto new_epoch = this->epoch.fetch_add(1) + 1;
+        for(auto &s : this->shards) {
+            std::lock_guard<std::mutex> lock(s.m);
+            Sync(s, new_epoch, s.config);
+        }
+    }
+
+  private:
+    static const size_t N_Shards = 16;
+
+    struct entry {
+        std::string key;
+        std::string clean;
+        float best_score;
+        uint64_t best_module;
+        uint64_t completed_modules;
+        std::map<std::string, float> results;
+    };
+    struct shard {
+        std::mutex m;
+        uint64_t epoch  = 0;
+        uint64_t config = 0;
+        std::list<entry> lru; // Most recently used first.
+        std::unordered_map<std::string, std::list<entry>::iterator> index;
+    };
+
+    const size_t shard_capacity;
+    shard shards[N_Shards];
+
+    shard &Shard_For(const std::string &key) {
+        return this->shards[std::hash<std::string>()(key) % N_Shards];
+    }
+
+    // Brings the shard up to date with the given epoch and configuration, discarding its entries if they are stale.
+    // Returns false if the shard has already seen a newer epoch, in which case the caller's view is stale.
+    static bool Sync(shard &s, uint64_t at_epoch, uint64_t config) {
+        if(at_epoch < s.epoch) return false;
+        if((s.epoch < at_epoch) || (s.config != config)) {
+            s.lru.clear();
+            s.index.clear();
+            s.epoch  = at_epoch;
+            s.config = config;
+        }
+        return true;
+    }
+};
+
+// Hashes a single lexicon entry. The hash of a lexicon is the sum of the hashes of its entries, so it does not depend
+// on the order entries are visited in and can be updated as entries are added and removed.
+static uint64_t Lexicon_Entry_Hash(const std::string &dirty, const std::string &clean) {
+    std::string entry;
+    entry.reserve(dirty.size() + clean.size() + 1);
+    entry.append(dirty).push_back('\0');
+    entry.append(clean);
+    uint64_t h = Snapshot_Checksum(entry.data(), entry.size());
+    h ^= (h >> 33);
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= (h >> 33);
+    return h;
+}
+
+static uint64_t Lexicon_Hash(const std::map<std::string, std::string> &lexicon) {
+    uint64_t h = 0;
+    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) h += Lexicon_Entry_Hash(it->first, it->second);
+    return h;
+}
+
+// The key of a dirty string for normalized_key_matching: upper-cased, with everything but letters and digits removed.
+static std::string Normalized_Key(const std::string &dirty) {
+    auto key = Canonicalize_String2(dirty, CANONICALIZE::TRIM_ALL | CANONICALIZE::TO_NUMAZ | CANONICALIZE::TO_UPPER);
+    key.erase(std::remove_if(key.begin(), key.end(), [](char c) -> bool { return (c == '.') || (c == '-'); }),
+              key.end());
+    return key;
+}
+
+static void Normalized_Index_Edit(explicator_normalized_index &index,
+                                  const std::string &dirty,
+                                  const std::string &clean,
+                                  bool added) {
+    auto key = Normalized_Key(dirty);
+    if(key.empty()) return;
+    if(added) {
+        ++(index[std::move(key)][clean]);
+        return;
+    }
+    auto it = index.find(key);
+    if(it == index.end()) return;
+    auto c_it = it->second.find(clean);
+    if((c_it == it->second.end()) || (--(c_it->second) != 0)) return;
+    it->second.erase(c_it);
+    if(it->second.empty()) index.erase(it);
+}
+
+static explicator_normalized_index Normalized_Index(const std::map<std::string, std::string> &lexicon) {
+    explicator_normalized_index index;
+    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) Normalized_Index_Edit(index, it->first, it->second, true);
+    return index;
+}
+
+// Snapshot serialization of the normalized-key index. Cleans are stored as IDs into the snapshot's table of cleans.
+static void Save_Normalized_Index(Snapshot_Writer &w,
+                                  const explicator_normalized_index &index,
+                                  const std::map<std::string, uint32_t> &clean_ids) {
+    w.Put(static_cast<uint64_t>(index.size()));
+    for(const auto &key : index) {
+        w.Put_String(key.first);
+        w.Put(static_cast<uint64_t>(key.second.size()));
+        for(const auto &clean : key.second) {
+            w.Put(clean_ids.at(clean.first));
+            w.Put(static_cast<uint64_t>(clean.second));
+        }
+    }
+}
+
+static explicator_normalized_index Load_Normalized_Index(Snapshot_Reader &r, const std::vector<std::string> &cleans) {
+    explicator_normalized_index index;
+    auto N = r.Get_Count(2 * sizeof(uint64_t));
+    index.reserve(N);
+    for(; N != 0; --N) {
+        auto &key_cleans = index[r.Get_String()];
+        for(auto M = r.Get_Count(sizeof(uint32_t) + sizeof(uint64_t)); M != 0; --M) {
+            const auto clean_id = r.Get<uint32_t>();
+            if(cleans.size() <= clean_id) {
+                throw std::runtime_error("invalid clean ID in normalized-key index");
+            }
+            key_cleans.emplace_hint(key_cleans.end(), cleans[clean_id], static_cast<size_t>(r.Get<uint64_t>()));
+        }
+    }
+    return index;
+}
+
 // Constructors.
 Explicator::Explicator(const std::string &file_name) : filename(file_name) {
-    // Check if the file can be opened/read.
-    if(!Does_File_Exist_And_Can_Be_Read(this->filename))
-        throw std::invalid_argument("Input lexicon '" + this->filename + "' could not be read");
-    this->ResetDefaults();
+    this->ResetDefaults(); // Note: ReReadFile() throws if the file cannot be read.
     this->ReReadFile();
     this->ReInitModules();
 }
 
 Explicator::Explicator(const std::string &file_name, uint64_t modulemask) : filename(file_name) {
-    // Check if the file can be opened/read.
-    if(!Does_File_Exist_And_Can_Be_Read(this->filename))
-        throw std::invalid_argument("Input lexicon '" + this->filename + "' could not be read");
-    this->ResetDefaults();
+    this->ResetDefaults(); // Note: ReReadFile() throws if the file cannot be read.
     this->ReReadFile();
     this->modmask = modulemask;
     this->ReInitModules();
@@ -89,6 +500,8 @@ Explicator::Explicator(const std::map<std::string, std::string> &new_lexicon,
 
 // Destructors.
 Explicator::~Explicator() {
+    if(this->watcher.joinable()) this->Watch_File(false);
+
     // De-initialize all the modules we've got.
     for(auto it = modules.begin(); it != modules.end(); ++it) { (std::get<2>(*it))(); }
 }
@@ -99,6 +512,13 @@ void Explicator::ResetDefaults(void) { // Resets everything except filename and
     this->last_best_score  = -1.0;
     this->last_best_module = Ex_Mods::None;
     this->group_threshold = 0.45;
+    this->cascade_candidate_limit     = 0;
+    this->cascade_min_candidates      = 1;
+    this->cascade_min_candidate_score = 0.0;
+    this->fusion_early_termination    = false;
+    this->normalized_key_matching     = false;
+    this->dicom_hash_search_radius    = -1;
+    this->deadline_module_priority.clear();
     this->last_results.reset(new std::map<std::string, float>()); // Allocate space for the last_results.
 
     // Ensure the 'no reasonable match' string does not collide with any of the cleans in the lexicon.
@@ -126,45 +546,177 @@ void Explicator::ResetDefaults(void) { // Resets everything except filename and
     return;
 }
 
-void Explicator::ReReadFile(void) {
-    // File syntax is: " clean string(s) : dirty string(s) "
-    // The purpose of this function is to read a '.lexicon' or '.lex' file to fill the this->lexicon map.
-    const std::regex regex_first_non_whitespace_is_pound(R"***(^[[:blank:]]*#)***", std::regex::ECMAScript | std::regex::icase);
-
-    // Check if the file can be opened/read.
-    if(!Does_File_Exist_And_Can_Be_Read(filename))
-        throw std::invalid_argument("Input lexicon '" + this->filename + "' could not be read");
-    std::fstream FI(this->filename.c_str(), std::ifstream::in);
-
-    // Clear the current lexicon and populate the new one.
-    this->lexicon.clear();
-    std::string rawline, dirty, clean; // Each line and Parts of the line (A...):(B...)
-    while(!((getline(FI, rawline)).eof())) {
-        if(std::regex_search(rawline, regex_first_non_whitespace_is_pound)) {
-            continue; // If the first non-whitespace character is #, then ignore.
-        }
-
-        std::size_t thecolon = rawline.find(":");
-        if(thecolon == std::string::npos){
-            continue; // If the line does not contain :, then ignore.
+// Lexicons at least this large are parsed in parallel chunks.
+static const size_t Parallel_Lexicon_Threshold = 4 * 1024 * 1024;
+
+// Parses the newline-terminated lines in [begin, end), passing each valid <dirty, clean> pair to f in file order.
+// Comment lines (first non-blank character is '#') and lines without a ':' are ignored.
+template <class F> static void Parse_Lexicon_Lines(const char *begin, const char *end, F f) {
+    std::string dirty, clean;
+    for(const char *line = begin; line < end;) {
+        const char *eol = static_cast<const char *>(std::memchr(line, '\n', static_cast<size_t>(end - line)));
+        if(eol == nullptr) break; // A final line without a newline is not part of the lexicon.
+
+        const char *c = line;
+        while((c < eol) && ((*c == ' ') || (*c == '\t'))) ++c;
+        const char *colon = static_cast<const char *>(std::memchr(line, ':', static_cast<size_t>(eol - line)));
+        if(((c == eol) || (*c != '#')) && (colon != nullptr)) {
+            // Chomp off extra whitespace (all from front, all from back, shorten whitespace within to a single space.)
+            // Keys can have anything, so only trim excess space.
+            clean.resize(static_cast<size_t>(colon - line));
+            clean.resize(Canonicalize_String(line, clean.size(), CANONICALIZE::TRIM, &clean[0]));
+            dirty.resize(static_cast<size_t>(eol - colon - 1));
+            dirty.resize(Canonicalize_String(colon + 1, dirty.size(), CANONICALIZE::TRIM | CANONICALIZE::TO_UPPER,
+                                             &dirty[0]));
+
+            // Push back the strings if they are valid (and sane...)
+            if(!clean.empty() && !dirty.empty()) {
+                f(dirty, clean);
+            }
         }
+        line = eol + 1;
+    }
+    return;
+}
 
-        clean = rawline.substr(0,thecolon);
-        dirty = rawline.substr(thecolon+1);
+// Reads a text lexicon or snapshot into 'lexicon' and (for snapshots) 'module_states', along with the lexicon's
+// indexes. Snapshots hold the indexes; they are built for text lexicons. Throws on failure.
+static void Read_Lexicon_File(const std::string &filename,
+                              std::map<std::string, std::string> &lexicon,
+                              std::map<uint64_t, std::pair<float, std::string>> &module_states,
+                              explicator_normalized_index &normalized_index,
+                              std::shared_ptr<const Exact_Index> &exact_index) {
+    // File syntax is: " clean string(s) : dirty string(s) "
+    // The purpose of this function is to read a '.lexicon' or '.lex' file to fill the lexicon map.
+    std::unique_ptr<Mapped_File> FI;
+    try {
+        FI.reset(new Mapped_File(filename));
+    } catch(const std::exception &) {
+        throw std::invalid_argument("Input lexicon '" + filename + "' could not be read");
+    }
+    const char *begin = FI->Data();
+    const char *end   = begin + FI->Size();
+
+    lexicon.clear();
+    module_states.clear();
+    normalized_index.clear();
+    exact_index.reset();
+    if((Snapshot_Header_Size <= FI->Size()) && (std::memcmp(begin, Snapshot_Magic, sizeof(Snapshot_Magic)) == 0)) {
+        try {
+            Snapshot_Reader header(begin + sizeof(Snapshot_Magic), Snapshot_Header_Size - sizeof(Snapshot_Magic));
+            if(header.Get<uint32_t>() != Snapshot_Version) {
+                throw std::runtime_error("unsupported version");
+            }
+            if(header.Get<uint32_t>() != Snapshot_Byte_Order) {
+                throw std::runtime_error("written on a host with a different byte order");
+            }
+            const auto payload_size = header.Get<uint64_t>();
+            const auto checksum     = header.Get<uint64_t>();
+            const char *payload     = begin + Snapshot_Header_Size;
+            if((FI->Size() - Snapshot_Header_Size) != payload_size) {
+                throw std::runtime_error("payload size does not match");
+            }
+            if(Snapshot_Checksum(payload, payload_size) != checksum) {
+                throw std::runtime_error("checksum does not match");
+            }
 
-        // Chomp off extra whitespace (all from front, all from back, shorten whitespace within to a single space.)
-        dirty = Canonicalize_String2(dirty, CANONICALIZE::TRIM | CANONICALIZE::TO_UPPER);
-        clean = Canonicalize_String2(clean, CANONICALIZE::TRIM); // Keys can have anything, so only trim excess space.
+            Snapshot_Reader r(payload, payload_size);
+            std::vector<std::string> cleans(r.Get_Count(sizeof(uint64_t)));
+            for(auto &clean : cleans) clean = r.Get_String();
+            for(auto N = r.Get_Count(sizeof(uint64_t) + sizeof(uint32_t)); N != 0; --N) {
+                auto dirty          = r.Get_String();
+                const auto clean_id = r.Get<uint32_t>();
+                if(cleans.size() <= clean_id) {
+                    throw std::runtime_error("invalid clean ID");
+                }
+                lexicon.emplace_hint(lexicon.end(), std::move(dirty), cleans[clean_id]);
+            }
+            exact_index = std::make_shared<const Exact_Index>(Exact_Index::Load(r, cleans));
+            if(exact_index->Size() != lexicon.size()) {
+                throw std::runtime_error("exact-match index does not match the lexicon");
+            }
+            normalized_index = Load_Normalized_Index(r, cleans);
+            r.Get<uint64_t>(); // The module mask used when writing. Informational only.
+            for(auto N = r.Get_Count(2 * sizeof(uint64_t)); N != 0; --N) {
+                const auto mod_id = r.Get<uint64_t>();
+                const auto thold  = r.Get<float>();
+                module_states[mod_id] = std::make_pair(thold, r.Get_String());
+            }
+        } catch(const std::exception &e) {
+            lexicon.clear();
+            module_states.clear();
+            normalized_index.clear();
+            exact_index.reset();
+            throw std::invalid_argument("Lexicon snapshot '" + filename + "' could not be read: " + e.what());
+        }
+        return;
+    }
 
-        // Push back the strings if they are valid (and sane...)
-        if(!clean.empty() && !dirty.empty()) {
+    // Clear the current lexicon and populate the new one. Later entries replace earlier entries with the same dirty.
+    const auto index_lexicon = [&](void) -> void {
+        normalized_index = Normalized_Index(lexicon);
+        exact_index      = std::make_shared<const Exact_Index>(lexicon);
+    };
+    const auto N_threads = static_cast<size_t>(std::thread::hardware_concurrency());
+    const auto N_chunks  = EXPLICATORMIN(N_threads, FI->Size() / Parallel_Lexicon_Threshold);
+    if(N_chunks < 2) {
+        Parse_Lexicon_Lines(begin, end, [&](const std::string &dirty, const std::string &clean) {
             lexicon[dirty] = clean;
-        }
+        });
+        index_lexicon();
+        return;
+    }
+
+    // Split the file at line boundaries, parse each chunk concurrently, and then merge the chunks in file order.
+    std::vector<const char *> bounds = {begin};
+    for(size_t i = 1; i < N_chunks; ++i) {
+        const char *nominal = begin + (FI->Size() / N_chunks) * i;
+        if(nominal < bounds.back()) nominal = bounds.back();
+        const char *eol = static_cast<const char *>(std::memchr(nominal, '\n', static_cast<size_t>(end - nominal)));
+        bounds.push_back((eol == nullptr) ? end : (eol + 1));
+    }
+    bounds.push_back(end);
+
+    std::vector<std::vector<std::pair<std::string, std::string>>> chunks(N_chunks);
+    std::vector<std::thread> workers;
+    for(size_t i = 0; i < N_chunks; ++i) {
+        workers.emplace_back([&, i](void) {
+            Parse_Lexicon_Lines(bounds[i], bounds[i + 1], [&](const std::string &dirty, const std::string &clean) {
+                chunks[i].emplace_back(dirty, clean);
+            });
+        });
+    }
+    for(auto &w : workers) w.join();
+    for(auto &chunk : chunks) {
+        for(auto &entry : chunk) lexicon[std::move(entry.first)] = std::move(entry.second);
     }
+    index_lexicon();
+    return;
+}
+
+void Explicator::ReReadFile(void) {
+    // Reads a '.lexicon' or '.lex' file (or a snapshot) to fill the this->lexicon map.
+    std::lock_guard<std::mutex> lock(this->mutation_mutex);
+    std::atomic_store(&this->generation, std::shared_ptr<const Explicator_Generation>());
+    Read_Lexicon_File(this->filename, this->lexicon, this->snapshot_module_states, this->normalized_index,
+                      this->exact_index);
+    this->lexicon_hash = Lexicon_Hash(this->lexicon);
+    this->Clear_Cache();
     return;
 }
 
 void Explicator::ReInitModules(std::map<uint64_t, float> mod_wghts, std::map<uint64_t, float> mod_tholds) {
+    std::lock_guard<std::mutex> lock(this->mutation_mutex);
+    // The lexicon may have been altered directly, so its hash and indexes are refreshed along with the modules. The
+    // indexes are only rebuilt if they were not built for the current lexicon (e.g., they are kept after ReReadFile()).
+    const auto current_hash = Lexicon_Hash(this->lexicon);
+    if(current_hash != this->lexicon_hash) {
+        this->lexicon_hash     = current_hash;
+        this->normalized_index = Normalized_Index(this->lexicon);
+        this->exact_index.reset();
+    }
+    if(this->exact_index == nullptr) this->exact_index = std::make_shared<const Exact_Index>(this->lexicon);
+
     // De-init modules which are currently loaded (even statically) Purge them after de-init.
     for(auto it = modules.begin(); it != modules.end(); ++it) { (std::get<2>(*it))(); }
     modules.clear();
@@ -176,57 +728,10 @@ void Explicator::ReInitModules(std::map<uint64_t, float> mod_wghts, std::map<uin
     // Otherwise it will be fixed to whatever you specify.
 
     // NOTE: [No modules] is valid. It means the user wants a strictly exact-match setup!
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::Levenshtein)) {
-        modules.push_back(std::make_tuple(Explicator_Module_Levenshtein_Init, Explicator_Module_Levenshtein_Query,
-                                          Explicator_Module_Levenshtein_Deinit, auto_thold, Ex_Mods::Levenshtein,
-                                          auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::DICOM_Hash)) {
-        modules.push_back(std::make_tuple(Explicator_Module_DICOM_Hash_Init, Explicator_Module_DICOM_Hash_Query,
-                                          Explicator_Module_DICOM_Hash_Deinit, auto_thold, Ex_Mods::DICOM_Hash,
-                                          auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::Emplacement)) {
-        modules.push_back(std::make_tuple(Explicator_Module_Emplacement_Init, Explicator_Module_Emplacement_Query,
-                                          Explicator_Module_Emplacement_Deinit, auto_thold, Ex_Mods::Emplacement,
-                                          auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::NGrams)) {
-        modules.push_back(std::make_tuple(Explicator_Module_NGrams_Init, Explicator_Module_NGrams_Query,
-                                          Explicator_Module_NGrams_Deinit, auto_thold, Ex_Mods::NGrams, auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::Soundex)) {
-        modules.push_back(std::make_tuple(Explicator_Module_Soundex_Init, Explicator_Module_Soundex_Query,
-                                          Explicator_Module_Soundex_Deinit, auto_thold, Ex_Mods::Soundex, auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::MRA)) {
-        modules.push_back(std::make_tuple(Explicator_Module_MRA_Init, Explicator_Module_MRA_Query,
-                                          Explicator_Module_MRA_Deinit, auto_thold, Ex_Mods::MRA, auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::Dbl_Metaphone)) {
-        modules.push_back(
-            std::make_tuple(Explicator_Module_Double_Metaphone_Init, Explicator_Module_Double_Metaphone_Query,
-                            Explicator_Module_Double_Metaphone_Deinit, auto_thold, Ex_Mods::Dbl_Metaphone, auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::DS_Head_Neck)) {
-        modules.push_back(
-            std::make_tuple(Explicator_Module_DS_Head_and_Neck_Init, Explicator_Module_DS_Head_and_Neck_Query,
-                            Explicator_Module_DS_Head_and_Neck_Deinit, auto_thold, Ex_Mods::DS_Head_Neck, auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::Subsequence)) {
-        modules.push_back(std::make_tuple(Explicator_Module_Subsequence_Init, Explicator_Module_Subsequence_Query,
-                                          Explicator_Module_Subsequence_Deinit, auto_thold, Ex_Mods::Subsequence,
-                                          auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::JaroWinkler)) {
-        modules.push_back(std::make_tuple(Explicator_Module_JaroWinkler_Init, Explicator_Module_JaroWinkler_Query,
-                                          Explicator_Module_JaroWinkler_Deinit, auto_thold, Ex_Mods::JaroWinkler,
-                                          auto_wght));
-    }
-    if(BITMASK_BITS_ARE_SET(this->modmask, Ex_Mods::Substrings)) {
-        modules.push_back(std::make_tuple(Explicator_Module_Substrings_Init, Explicator_Module_Substrings_Query,
-                                          Explicator_Module_Substrings_Deinit, auto_thold, Ex_Mods::Substrings,
-                                          auto_wght));
+    for(const auto &f : Module_Functions) {
+        if(BITMASK_BITS_ARE_SET(this->modmask, f.id)) {
+            modules.push_back(std::make_tuple(f.init, f.query, f.deinit, auto_thold, f.id, auto_wght));
+        }
     }
 
     // Load dynamic modules here. (None at the moment.)
@@ -270,56 +775,466 @@ void Explicator::ReInitModules(std::map<uint64_t, float> mod_wghts, std::map<uin
     }
 
     // Init all modules. A threadpool was originally used to speed this, but was more hassle than it was worth.
-    for(auto it = modules.begin(); it != modules.end(); ++it) { (std::get<0>(*it))(lexicon, std::get<3>(*it)); }
+    //
+    // If a snapshot was loaded, precomputed module state is restored instead where possible. The snapshot state is
+    // only used once because the lexicon could be altered afterward.
+    for(auto it = modules.begin(); it != modules.end(); ++it) {
+        const auto s_it = this->snapshot_module_states.find(std::get<4>(*it));
+        const auto f    = Find_Module_Functions(std::get<4>(*it));
+        if((s_it != this->snapshot_module_states.end()) && (f != nullptr) && (f->load != nullptr)
+           && (s_it->second.first == std::get<3>(*it))) {
+            try {
+                (f->load)(s_it->second.second);
+                continue;
+            } catch(const std::exception &e) {
+                FUNCEXPLICATORWARN("Unable to restore module state from snapshot (" << e.what() << "). Reinitializing");
+                (std::get<2>(*it))();
+            }
+        }
+        (std::get<0>(*it))(lexicon, std::get<3>(*it));
+    }
+    this->snapshot_module_states.clear();
 
+    // If a reloaded lexicon is in use, rebuild its module state so it reflects the new modules and thresholds.
+    if(auto g = std::atomic_load(&this->generation)) {
+        std::atomic_store(&this->generation, this->Build_Generation(g->lexicon, g->normalized_index, g->exact_index));
+    }
+    this->Clear_Cache();
     return;
 }
 
 std::string Explicator::operator()(const std::string &dirty) {
-    if(this->lexicon.empty())
-        throw std::runtime_error("Attempted to perform matching with an empty lexicon!");
+    auto t = this->Translate(dirty);
     if(this->last_results == nullptr)
         throw std::logic_error("this->last_results was a nullptr. Unable to continue");
 
-    this->last_results->clear();
-    this->last_best_score  = -1.0;
-    this->last_best_module = Ex_Mods::None;
+    this->last_results.swap(t.results);
+    this->last_best_score  = t.best_score;
+    this->last_best_module = t.best_module;
+    return t.clean;
+}
+
+// Fingerprints the settings, other than the lexicon and module state, which affect translations.
+static uint64_t Translation_Config_Fingerprint(const Explicator &X) {
+    Snapshot_Writer w;
+    w.Put(X.modmask);
+    w.Put(X.group_threshold);
+    w.Put_String(X.suspected_mistranslation);
+    w.Put(static_cast<uint64_t>(X.cascade_candidate_limit));
+    w.Put(static_cast<uint64_t>(X.cascade_min_candidates));
+    w.Put(X.cascade_min_candidate_score);
+    w.Put(X.fusion_early_termination);
+    w.Put(X.normalized_key_matching);
+    w.Put(static_cast<int64_t>(X.dicom_hash_search_radius));
+    for(auto it = X.modules.begin(); it != X.modules.end(); ++it) {
+        w.Put(std::get<4>(*it));
+        w.Put(std::get<3>(*it));
+        w.Put(std::get<5>(*it));
+    }
+    return Snapshot_Checksum(w.blob.data(), w.blob.size());
+}
+
+// Looks up an exact match, returning the clean or nullptr if there is none. The perfect hash index is used unless the
+// lexicon has been edited since it was built.
+const std::string *Explicator::Find_Exact(const Explicator_Generation *g, const std::string &dirty_chomped) const {
+    const auto &index = (g != nullptr) ? g->exact_index : this->exact_index;
+    if(index != nullptr) return index->Find(dirty_chomped);
+    const auto &lexicon = (g != nullptr) ? g->lexicon : this->lexicon;
+    const auto it       = lexicon.find(dirty_chomped);
+    return (it == lexicon.end()) ? nullptr : &(it->second);
+}
+
+// Looks up a unique match once separators are disregarded, returning the clean or nullptr if there is none (or several).
+const std::string *Explicator::Find_Normalized(const Explicator_Generation *g, const std::string &dirty_chomped) const {
+    const auto &index = (g != nullptr) ? g->normalized_index : this->normalized_index;
+    const auto it     = index.find(Normalized_Key(dirty_chomped));
+    if((it == index.end()) || (it->second.size() != 1)) return nullptr;
+    return &(it->second.begin()->first);
+}
+
+Explicator_Translation Explicator::Translate(const std::string &dirty) const {
+    return this->Translate_Cached(dirty, nullptr);
+}
 
-    std::string clean(this->suspected_mistranslation); // This is the string we will return.
+Explicator_Translation Explicator::Translate(const std::string &dirty,
+                                             std::chrono::steady_clock::time_point deadline) const {
+    return this->Translate_Cached(dirty, &deadline);
+}
+
+Explicator_Translation Explicator::Translate_Cached(const std::string &dirty,
+                                                    const std::chrono::steady_clock::time_point *deadline) const {
     const std::string dirty_chomped = Canonicalize_String2(dirty, CANONICALIZE::TRIM | CANONICALIZE::TO_UPPER);
+    if(this->cache == nullptr) return this->Translate_Uncached(dirty_chomped, deadline);
+
+    // The epoch must be read before the generation is (in Translate_Uncached()). See Explicator_Cache.
+    const auto epoch  = this->cache->epoch.load();
+    const auto config = Translation_Config_Fingerprint(*this);
+    Explicator_Translation out;
+    if(this->cache->Find(dirty_chomped, epoch, config, out)) {
+        this->cache->hits.fetch_add(1, std::memory_order_relaxed);
+        return out;
+    }
+    this->cache->misses.fetch_add(1, std::memory_order_relaxed);
+    out = this->Translate_Uncached(dirty_chomped, deadline);
+    if(this->Is_Reusable(out, deadline)) this->cache->Insert(dirty_chomped, epoch, config, out);
+    return out;
+}
+
+// Whether a translation may be cached or memoized, i.e., whether it is the one an untimed Translate() would make.
+// Translations with a deadline are made without cascaded matching, so they can differ even when they are complete.
+bool Explicator::Is_Reusable(const Explicator_Translation &out,
+                             const std::chrono::steady_clock::time_point *deadline) const {
+    return !out.partial && ((deadline == nullptr) || (this->cascade_candidate_limit == 0));
+}
+
+Explicator_Translation Explicator::Translate_Uncached(const std::string &dirty_chomped,
+                                                      const std::chrono::steady_clock::time_point *deadline) const {
+    // Hold a reference to the current generation (if any) so that a concurrent Reload() cannot free it mid-query.
+    const auto g        = std::atomic_load(&this->generation);
+    const auto &lexicon = (g != nullptr) ? g->lexicon : this->lexicon;
+
+    if(lexicon.empty())
+        throw std::runtime_error("Attempted to perform matching with an empty lexicon!");
+
+    Explicator_Translation out;
+    out.clean = this->suspected_mistranslation; // This is the string we will return.
+    out.results.reset(new std::map<std::string, float>());
 
     // Check if there is an exact match. If there is, we can skip evaluating any modules.
-    {
-        auto it = this->lexicon.find(dirty_chomped);
-        if(it != this->lexicon.end()) {
-            (*(this->last_results))[it->second] = 1.0;
-            this->last_best_score  = 1.0;
-            this->last_best_module = Ex_Mods::Exact;
-            return it->second;
+    if(const auto exact = this->Find_Exact(g.get(), dirty_chomped)) {
+        (*(out.results))[*exact] = 1.0;
+        out.best_score           = 1.0;
+        out.best_module          = Ex_Mods::Exact;
+        out.clean                = *exact;
+        out.completed_modules    = Ex_Mods::Exact;
+        return out;
+    }
+
+    // Check if there is a unique match once separators are disregarded.
+    if(this->normalized_key_matching) {
+        if(const auto normalized = this->Find_Normalized(g.get(), dirty_chomped)) {
+            (*(out.results))[*normalized] = 1.0;
+            out.best_score                = 1.0;
+            out.best_module               = Ex_Mods::Normalized;
+            out.clean                     = *normalized;
+            out.completed_modules         = Ex_Mods::Normalized;
+            return out;
         }
     }
     if(this->modules.empty()) {
-        return this->suspected_mistranslation;
+        return out;
+    }
+
+    // Consult the memo, if any, before scoring.
+    uint64_t stamp = 0;
+    if(this->memo != nullptr) {
+        Snapshot_Writer w;
+        w.Put((g != nullptr) ? g->lexicon_hash : this->lexicon_hash);
+        w.Put(Translation_Config_Fingerprint(*this));
+        stamp = Snapshot_Checksum(w.blob.data(), w.blob.size());
+
+        if(this->memo->Find(dirty_chomped, stamp, out.clean, out.best_score, out.best_module)) {
+            if(out.clean != this->suspected_mistranslation) (*(out.results))[out.clean] = out.best_score;
+            return out;
+        }
+    }
+
+    // The query is preprocessed lazily, and shared by all modules.
+    Explicator_Query q(dirty_chomped);
+    q.Set_Search_Radius(this->dicom_hash_search_radius);
+    if(deadline != nullptr) q.Set_Deadline(*deadline);
+    this->Score_With_Modules(g.get(), lexicon, q, out);
+    if((this->memo != nullptr) && this->Is_Reusable(out, deadline)) {
+        this->memo->Insert(dirty_chomped, stamp, out.clean, out.best_score, out.best_module);
+    }
+    return out;
+}
+
+std::vector<std::pair<std::string, float>> Explicator::Translate_Top_K(const std::string &dirty, size_t K) const {
+    const std::string dirty_chomped = Canonicalize_String2(dirty, CANONICALIZE::TRIM | CANONICALIZE::TO_UPPER);
+    const auto g        = std::atomic_load(&this->generation);
+    const auto &lexicon = (g != nullptr) ? g->lexicon : this->lexicon;
+
+    if(lexicon.empty())
+        throw std::runtime_error("Attempted to perform matching with an empty lexicon!");
+
+    std::vector<std::pair<std::string, float>> out;
+    if(K == 0) return out;
+    if(const auto exact = this->Find_Exact(g.get(), dirty_chomped)) {
+        out.emplace_back(*exact, 1.0);
+        return out;
+    }
+    if(this->normalized_key_matching) {
+        if(const auto normalized = this->Find_Normalized(g.get(), dirty_chomped)) {
+            out.emplace_back(*normalized, 1.0);
+            return out;
+        }
+    }
+    if(this->modules.empty()) {
+        return out;
+    }
+
+    float tot_wght(0.0);
+    for(auto it = this->modules.begin(); it != this->modules.end(); ++it) tot_wght += std::get<5>(*it);
+    if(tot_wght <= 0.0) {
+        return out;
     }
 
-    // Cycle through all the modules. Push the results back into the vector.
+    // Each module first reports only its own K' best cleans (and any tied), pruning as it goes. Modules which left
+    // cleans out scored each of them below the lowest score they reported, so a clean which no module reported scores
+    // below the weighted sum of those lowest scores (Fagin's threshold algorithm). The modules which left cleans out
+    // are re-run to score only the reported cleans, giving their exact combined scores. If the K-th best of them
+    // exceeds the bound, no other clean can displace it and the top K are exact. Otherwise every clean is scored, as
+    // Translate() would.
+    const size_t K_module = 2 * K;
+    std::vector<std::unique_ptr<std::map<std::string, float>>> results;
+    std::vector<size_t> pruned;
+    std::set<std::string> reported;
+    {
+        Explicator_Query q(dirty_chomped);
+        q.Set_Search_Radius(this->dicom_hash_search_radius);
+        q.Set_Top_K(K_module);
+        for(auto it = this->modules.begin(); it != this->modules.end(); ++it) {
+            results.push_back(this->Query_Module(g.get(), lexicon, *it, q));
+            for(const auto &r : *(results.back())) reported.insert(r.first);
+            const auto f = Find_Module_Functions(std::get<4>(*it));
+            if((f != nullptr) && f->top_k && (K_module <= results.back()->size())) {
+                pruned.push_back(results.size() - 1);
+            }
+        }
+    }
+
+    // The bound is summed exactly as combined scores are, so that rounding cannot carry a clean past it.
+    float bound(0.0);
+    for(const auto i : pruned) {
+        auto it = this->modules.begin();
+        std::advance(it, i);
+        float lowest = std::numeric_limits<float>::infinity();
+        for(const auto &r : *(results[i])) lowest = EXPLICATORMIN(lowest, r.second);
+        bound += (std::get<5>(*it) / tot_wght) * EXPLICATORMAX(0.0F, std::nextafter(lowest, 0.0F));
+    }
+
+    const auto fuse = [&](void) -> std::vector<std::pair<std::string, float>> {
+        std::map<std::string, float> fused;
+        size_t i = 0;
+        for(auto it = this->modules.begin(); it != this->modules.end(); ++it, ++i) {
+            const auto wght = std::get<5>(*it) / tot_wght;
+            for(const auto &r : *(results[i])) fused[r.first] += wght * r.second;
+        }
+        std::vector<std::pair<std::string, float>> ranked(fused.begin(), fused.end());
+        const auto N = EXPLICATORMIN(K, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + N, ranked.end(),
+                          [](const std::pair<std::string, float> &A, const std::pair<std::string, float> &B) -> bool {
+                              return (A.second > B.second) || ((A.second == B.second) && (A.first < B.first));
+                          });
+        ranked.resize(N);
+        return ranked;
+    };
+    const auto rescore = [&](const std::vector<std::string> *candidates) {
+        for(const auto i : pruned) {
+            Explicator_Query q(dirty_chomped);
+            q.Set_Search_Radius(this->dicom_hash_search_radius);
+            if(candidates != nullptr) {
+                std::vector<std::string> missing;
+                for(const auto &c : *candidates) {
+                    if(results[i]->count(c) == 0) missing.push_back(c);
+                }
+                q.Restrict_Candidates(std::move(missing));
+            }
+            auto it = this->modules.begin();
+            std::advance(it, i);
+            auto rest = this->Query_Module(g.get(), lexicon, *it, q);
+            results[i]->insert(rest->begin(), rest->end());
+        }
+    };
+    if(pruned.empty()) return fuse();
+
+    const std::vector<std::string> candidates(reported.begin(), reported.end());
+    rescore(&candidates);
+    out = fuse();
+
+    if((out.size() == K) && (bound < out.back().second)) return out;
+    rescore(nullptr);
+    return fuse();
+}
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator::Query_Module(const Explicator_Generation *g,
+                         const std::map<std::string, std::string> &lexicon,
+                         const std::tuple<explicator_module_func_init,
+                                          explicator_module_func_query,
+                                          explicator_module_func_deinit,
+                                          float,
+                                          uint64_t,
+                                          float> &m,
+                         const Explicator_Query &q) const {
+    const auto thethold = std::get<3>(m);
+    const auto f_query  = std::get<1>(m);
+
+    // Modules which only provide the original interface are passed the plain query string.
+    const auto f    = Find_Module_Functions(std::get<4>(m));
+    const auto f_v2 = (f != nullptr) ? f->query_v2 : nullptr;
+    if(g != nullptr) {
+        const auto &state = g->module_states.at(std::get<4>(m));
+        if(f_v2 != nullptr) {
+            return f_v2(state.second.get(), lexicon, q, thethold);
+        }
+        return (state.first)(state.second.get(), lexicon, q.Text(), thethold);
+    }
+    if(f_v2 != nullptr) {
+        return f_v2(nullptr, lexicon, q, thethold);
+    }
+    return f_query(lexicon, q.Text(), thethold);
+}
+
+void Explicator::Score_With_Modules(const Explicator_Generation *g,
+                                    const std::map<std::string, std::string> &lexicon,
+                                    Explicator_Query &q,
+                                    Explicator_Translation &out) const {
+    const auto query_module = [&](const decltype(this->modules)::value_type &m) {
+        return this->Query_Module(g, lexicon, m, q);
+    };
+
+    // Results are kept in module order regardless of the order in which the modules are run.
     float tot_wght(0.0);
-    std::vector<std::pair<std::unique_ptr<std::map<std::string, float>>, float>> result_vector;
+    std::vector<std::pair<std::unique_ptr<std::map<std::string, float>>, float>> result_vector(this->modules.size());
+    std::vector<uint64_t> result_modules(this->modules.size());
+    bool has_cheap = false, has_expensive = false;
+    {
+        size_t i = 0;
+        for(auto it = this->modules.begin(); it != this->modules.end(); ++it, ++i) {
+            result_modules[i]       = std::get<4>(*it);
+            result_vector[i].second = std::get<5>(*it);
+            tot_wght += std::get<5>(*it);
+            if(result_modules[i] & Ex_Mods::Cascade_Expensive) {
+                has_expensive = true;
+            } else {
+                has_cheap = true;
+            }
+        }
+    }
+    const bool timed   = q.Has_Deadline();
+    const bool cascade = (this->cascade_candidate_limit != 0) && has_cheap && has_expensive && !timed;
+
+    // Shortlists the cleans scored highest by the cheap modules, so the expensive modules only score those.
+    const auto restrict_to_shortlist = [&](void) {
+        float cheap_wght(0.0);
+        std::map<std::string, float> cheap_scores;
+        for(size_t i = 0; i < result_vector.size(); ++i) {
+            if(result_modules[i] & Ex_Mods::Cascade_Expensive) continue;
+            cheap_wght += result_vector[i].second;
+            for(const auto &r : *(result_vector[i].first)) cheap_scores[r.first] += result_vector[i].second * r.second;
+        }
 
+        std::vector<std::pair<std::string, float>> ranked(cheap_scores.begin(), cheap_scores.end());
+        const auto N_shortlist = EXPLICATORMIN(ranked.size(), this->cascade_candidate_limit);
+        std::partial_sort(ranked.begin(), ranked.begin() + N_shortlist, ranked.end(),
+                          [](const std::pair<std::string, float> &A, const std::pair<std::string, float> &B) -> bool {
+                              return (A.second > B.second) || ((A.second == B.second) && (A.first < B.first));
+                          });
+
+        // Recall safeguards: an unconvincing shortlist is discarded in favour of scoring the whole lexicon.
+        if((cheap_wght > 0.0) && (N_shortlist != 0) && (this->cascade_min_candidates <= ranked.size())
+           && (this->cascade_min_candidate_score <= (ranked.front().second / cheap_wght))) {
+            std::vector<std::string> shortlist;
+            shortlist.reserve(N_shortlist);
+            for(size_t i = 0; i < N_shortlist; ++i) shortlist.push_back(std::move(ranked[i].first));
+            q.Restrict_Candidates(std::move(shortlist));
+        }
+    };
+
+    // Decide the order in which modules are run. When cascading, the cheap modules are run first. When terminating
+    // early, the cheapest modules are run first so the result is decided as cheaply as possible. With a deadline, the
+    // modules are run in priority order.
+    std::vector<decltype(this->modules)::const_iterator> module_its;
+    for(auto it = this->modules.begin(); it != this->modules.end(); ++it) module_its.push_back(it);
+    std::vector<size_t> order(module_its.size());
+    for(size_t i = 0; i < order.size(); ++i) order[i] = i;
+
+    bool early = this->fusion_early_termination && (tot_wght > 0.0);
     for(auto it = this->modules.begin(); it != this->modules.end(); ++it) {
-        const auto thethold = std::get<3>(*it);
-        const auto thewght  = std::get<5>(*it);
-        const auto f_query  = std::get<1>(*it);
+        if((std::get<3>(*it) < 0.0) || (std::get<5>(*it) < 0.0)) early = false; // The bounds need scores in [0:1].
+    }
+    if(early) {
+        std::stable_sort(order.begin(), order.end(), [&](size_t A, size_t B) -> bool {
+            return Module_Cost_Rank(result_modules[A]) < Module_Cost_Rank(result_modules[B]);
+        });
+    }
+    if(cascade) {
+        std::stable_partition(order.begin(), order.end(), [&](size_t i) -> bool {
+            return !(result_modules[i] & Ex_Mods::Cascade_Expensive);
+        });
+    }
+    if(timed) {
+        const auto &priority = this->deadline_module_priority;
+        const auto rank      = [&](uint64_t mod) -> size_t {
+            const auto p_it = std::find(priority.begin(), priority.end(), mod);
+            if(p_it != priority.end()) return static_cast<size_t>(std::distance(priority.begin(), p_it));
+            return priority.size() + static_cast<size_t>(Module_Cost_Rank(mod));
+        };
+        std::stable_sort(order.begin(), order.end(), [&](size_t A, size_t B) -> bool {
+            return rank(result_modules[A]) < rank(result_modules[B]);
+        });
+    }
+
+    // Cycle through the modules. When terminating early, the (normalized) weighted scores accumulated so far give each
+    // clean a lower bound on its final score, and adding the weight of the modules yet to run gives an upper bound.
+    // Once the leading clean's lower bound meets the group threshold and exceeds every other clean's upper bound, or
+    // no clean's upper bound reaches the group threshold, the remaining modules cannot change the outcome. A small
+    // margin guards against rounding, since scores are summed in another order below.
+    const float margin = 1.0E-5;
+    float remaining_wght(1.0);
+    std::map<std::string, float> partial_scores;
+    bool shortlisted = false;
+    for(const auto i : order) {
+        if(timed && q.Past_Deadline()) break;
+        if(cascade && !shortlisted && (result_modules[i] & Ex_Mods::Cascade_Expensive)) {
+            restrict_to_shortlist();
+            shortlisted = true;
+        }
+        result_vector[i].first = query_module(*(module_its[i]));
+        if(q.Interrupted()) {
+            result_vector[i].first.reset(); // Incomplete scores would skew the fusion.
+            break;
+        }
+        out.completed_modules |= result_modules[i];
+        if(!early) continue;
+
+        const auto wght = result_vector[i].second / tot_wght;
+        for(const auto &r : *(result_vector[i].first)) partial_scores[r.first] += wght * r.second;
+        remaining_wght -= wght;
+
+        float leader = 0.0, runner_up = 0.0; // Cleans without any score so far have a lower bound of zero.
+        for(const auto &p : partial_scores) {
+            if(leader < p.second) {
+                runner_up = leader;
+                leader    = p.second;
+            } else if(runner_up < p.second) {
+                runner_up = p.second;
+            }
+        }
+        const bool leader_decided
+            = (this->group_threshold <= (leader - margin)) && ((runner_up + remaining_wght) < (leader - margin));
+        const bool none_can_pass = ((leader + remaining_wght + margin) < this->group_threshold);
+        if(leader_decided || none_can_pass) break;
+    }
 
-        auto themap = f_query(this->lexicon, dirty_chomped, thethold);
-        result_vector.push_back(std::make_pair(std::move(themap), thewght));
-        tot_wght += thewght;
+    // Modules which were not run contribute nothing. If the deadline passed, the completed modules are weighted as
+    // though they were the only ones enabled.
+    out.partial = q.Interrupted();
+    if(out.partial) tot_wght = 0.0;
+    for(auto &r : result_vector) {
+        if(r.first == nullptr) {
+            r.first.reset(new std::map<std::string, float>());
+            if(out.partial) r.second = 0.0;
+        }
+        if(out.partial) tot_wght += r.second;
     }
 
     // Normalize the weighting in the output vector.
     if(tot_wght <= 0.0) {
         // FUNCEXPLICATORWARN("No plausible output. Consider increasing the threshold");
-        return this->suspected_mistranslation;
+        return;
     }
     for(auto v_it = result_vector.begin(); v_it != result_vector.end(); ++v_it) { v_it->second /= tot_wght; }
 
@@ -332,27 +1247,28 @@ std::string Explicator::operator()(const std::string &dirty) {
         const auto wght = v_it->second;
         for(auto s_it = v_it->first->begin(); s_it != v_it->first->end(); ++s_it) {
             const auto score = wght * s_it->second;
-            (*(this->last_results))[s_it->first] += score;
+            (*(out.results))[s_it->first] += score;
         }
     }
 
-    for(auto it = this->last_results->begin(); it != this->last_results->end(); ++it) {
+    for(auto it = out.results->begin(); it != out.results->end(); ++it) {
         const auto final_score = it->second;
-        if(this->last_best_score < final_score) {
-            this->last_best_score = final_score;
+        if(out.best_score < final_score) {
+            out.best_score = final_score;
         }
     }
 
     // Verify that there is at least one plausible output. It is not an error to have none, but it may indicate that the
     // user has set unreasonable thresholds.
-    if(this->last_results->empty()) {
+    if(out.results->empty()) {
         // FUNCEXPLICATORWARN("No plausible output. Consider increasing the threshold");
-        return this->suspected_mistranslation;
+        return;
     }
 
     // Find the highest score and associated suspected clean string.           ----ISN'T THIS WHAT 'last_best_score' is?
     float max_score = -std::numeric_limits<float>::infinity();
-    for(auto it = this->last_results->begin(); it != this->last_results->end(); ++it) {
+    std::string clean;
+    for(auto it = out.results->begin(); it != out.results->end(); ++it) {
         if(it->second > max_score) {
             max_score = it->second;
             clean     = it->first;
@@ -362,9 +1278,296 @@ std::string Explicator::operator()(const std::string &dirty) {
     // If the highest-scoring score was not above the threshold, we indicate that we have no prediction.
     // NOTE: We do not use '<=' in case the user genuinely wants no threshold.
     if(max_score < this->group_threshold) {
-        return this->suspected_mistranslation;
+        return;
+    }
+    out.clean = clean;
+
+    // The best module is the one which contributed the most to the winning score.
+    float best_contribution = -std::numeric_limits<float>::infinity();
+    for(size_t i = 0; i < result_vector.size(); ++i) {
+        const auto s_it = result_vector[i].first->find(clean);
+        if(s_it == result_vector[i].first->end()) continue;
+        const auto contribution = result_vector[i].second * s_it->second;
+        if(best_contribution < contribution) {
+            best_contribution = contribution;
+            out.best_module   = result_modules[i];
+        }
     }
-    return clean;
+    return;
+}
+
+void Explicator::Edit_Modules(const std::string &dirty, const std::string &clean, bool added) {
+    for(auto it = modules.begin(); it != modules.end(); ++it) {
+        const auto f      = Find_Module_Functions(std::get<4>(*it));
+        const auto f_edit = (f == nullptr) ? nullptr : (added ? f->add : f->remove);
+        if(f_edit == nullptr) {
+            (std::get<2>(*it))();
+            (std::get<0>(*it))(this->lexicon, std::get<3>(*it));
+        } else {
+            f_edit(this->lexicon, dirty, clean);
+        }
+    }
+    return;
+}
+
+// Applies an edit to a copy of a generation. The lexicon and indexes are edited as the members are, and each module's
+// state is replaced by an edited copy where supported, or otherwise rebuilt.
+void Explicator::Edit_Generation(Explicator_Generation &g,
+                                 const std::string &dirty,
+                                 const std::string &clean,
+                                 bool added) const {
+    if(added) {
+        g.lexicon.emplace(dirty, clean);
+        g.lexicon_hash += Lexicon_Entry_Hash(dirty, clean);
+    } else {
+        g.lexicon.erase(dirty);
+        g.lexicon_hash -= Lexicon_Entry_Hash(dirty, clean);
+    }
+    Normalized_Index_Edit(g.normalized_index, dirty, clean, added);
+    g.exact_index.reset();
+
+    for(auto it = this->modules.begin(); it != this->modules.end(); ++it) {
+        const auto mod_id = std::get<4>(*it);
+        auto &state       = g.module_states.at(mod_id).second;
+        const auto f      = Find_Module_Functions(mod_id);
+        const auto f_edit = added ? f->add_state : f->remove_state;
+        if(f_edit == nullptr) {
+            state = (f->build)(g.lexicon, std::get<3>(*it));
+        } else {
+            state = f_edit(state, g.lexicon, dirty, clean);
+        }
+    }
+    return;
+}
+
+void Explicator::Add_Entry(const std::string &dirty, const std::string &clean) {
+    const auto dirty_chomped = Canonicalize_String2(dirty, CANONICALIZE::TRIM | CANONICALIZE::TO_UPPER);
+    const auto clean_chomped = Canonicalize_String2(clean, CANONICALIZE::TRIM);
+    if(dirty_chomped.empty() || clean_chomped.empty()) {
+        throw std::invalid_argument("Lexicon entries cannot be empty");
+    }
+    if(clean_chomped == this->suspected_mistranslation) {
+        FUNCEXPLICATORWARN("The added 'clean' string collides with the string used to signal a suspected "
+                           "mistranslation: '"
+                           << this->suspected_mistranslation << "'");
+    }
+
+    std::lock_guard<std::mutex> lock(this->mutation_mutex);
+    if(auto g = std::atomic_load(&this->generation)) {
+        const auto it = g->lexicon.find(dirty_chomped);
+        if((it != g->lexicon.end()) && (it->second == clean_chomped)) return;
+        auto edited = std::make_shared<Explicator_Generation>(*g);
+        if(it != g->lexicon.end()) this->Edit_Generation(*edited, dirty_chomped, it->second, false);
+        this->Edit_Generation(*edited, dirty_chomped, clean_chomped, true);
+        std::atomic_store(&this->generation, std::shared_ptr<const Explicator_Generation>(std::move(edited)));
+        this->Clear_Cache();
+        return;
+    }
+
+    auto it = this->lexicon.find(dirty_chomped);
+    if(it != this->lexicon.end()) {
+        if(it->second == clean_chomped) return;
+        const std::string old_clean = it->second;
+        this->lexicon.erase(it);
+        this->lexicon_hash -= Lexicon_Entry_Hash(dirty_chomped, old_clean);
+        Normalized_Index_Edit(this->normalized_index, dirty_chomped, old_clean, false);
+        this->Edit_Modules(dirty_chomped, old_clean, false);
+    }
+    this->lexicon.emplace(dirty_chomped, clean_chomped);
+    this->lexicon_hash += Lexicon_Entry_Hash(dirty_chomped, clean_chomped);
+    Normalized_Index_Edit(this->normalized_index, dirty_chomped, clean_chomped, true);
+    this->exact_index.reset();
+    this->Edit_Modules(dirty_chomped, clean_chomped, true);
+    this->Clear_Cache();
+    return;
+}
+
+bool Explicator::Remove_Entry(const std::string &dirty) {
+    const auto dirty_chomped = Canonicalize_String2(dirty, CANONICALIZE::TRIM | CANONICALIZE::TO_UPPER);
+
+    std::lock_guard<std::mutex> lock(this->mutation_mutex);
+    if(auto g = std::atomic_load(&this->generation)) {
+        const auto it = g->lexicon.find(dirty_chomped);
+        if(it == g->lexicon.end()) return false;
+        auto edited = std::make_shared<Explicator_Generation>(*g);
+        this->Edit_Generation(*edited, dirty_chomped, it->second, false);
+        std::atomic_store(&this->generation, std::shared_ptr<const Explicator_Generation>(std::move(edited)));
+        this->Clear_Cache();
+        return true;
+    }
+
+    auto it = this->lexicon.find(dirty_chomped);
+    if(it == this->lexicon.end()) return false;
+    const std::string clean = it->second;
+    this->lexicon.erase(it);
+    this->lexicon_hash -= Lexicon_Entry_Hash(dirty_chomped, clean);
+    Normalized_Index_Edit(this->normalized_index, dirty_chomped, clean, false);
+    this->exact_index.reset();
+    this->Edit_Modules(dirty_chomped, clean, false);
+    this->Clear_Cache();
+    return true;
+}
+
+std::shared_ptr<const Explicator_Generation>
+Explicator::Build_Generation(std::map<std::string, std::string> new_lexicon,
+                             explicator_normalized_index normalized_index,
+                             std::shared_ptr<const Exact_Index> exact_index) const {
+    auto g              = std::make_shared<Explicator_Generation>();
+    g->lexicon          = std::move(new_lexicon);
+    g->lexicon_hash     = Lexicon_Hash(g->lexicon);
+    g->normalized_index = std::move(normalized_index);
+    g->exact_index      = std::move(exact_index);
+    if(g->exact_index == nullptr) g->exact_index = std::make_shared<const Exact_Index>(g->lexicon);
+    for(auto it = g->lexicon.begin(); it != g->lexicon.end(); ++it) {
+        if(it->second == this->suspected_mistranslation) {
+            FUNCEXPLICATORWARN("The reloaded lexicon contains a 'clean' string which collides with the string used to "
+                               "signal a suspected mistranslation: '"
+                               << this->suspected_mistranslation << "'");
+            break;
+        }
+    }
+
+    // Build the state for each loaded module using its current threshold.
+    for(auto it = this->modules.begin(); it != this->modules.end(); ++it) {
+        const auto mod_id = std::get<4>(*it);
+        const auto f      = Find_Module_Functions(mod_id);
+        if((f == nullptr) || (f->build == nullptr) || (f->query_state == nullptr)) {
+            throw std::logic_error("Module " + std::to_string(mod_id) + " does not support reloading");
+        }
+        auto state               = (f->build)(g->lexicon, std::get<3>(*it));
+        g->module_states[mod_id] = std::make_pair(f->query_state, std::move(state));
+    }
+    return g;
+}
+
+void Explicator::Reload(void) {
+    // Module state saved in snapshots is not used here because restoring it replaces the module's global state, which
+    // in-flight queries may be using. The state is rebuilt instead. The lexicon's indexes are not shared, so they are
+    // used as read.
+    std::map<std::string, std::string> new_lexicon;
+    std::map<uint64_t, std::pair<float, std::string>> module_states;
+    explicator_normalized_index new_normalized_index;
+    std::shared_ptr<const Exact_Index> new_exact_index;
+    Read_Lexicon_File(this->filename, new_lexicon, module_states, new_normalized_index, new_exact_index);
+
+    std::lock_guard<std::mutex> lock(this->mutation_mutex);
+    std::atomic_store(&this->generation, this->Build_Generation(std::move(new_lexicon), std::move(new_normalized_index),
+                                                                std::move(new_exact_index)));
+    this->Clear_Cache();
+    return;
+}
+
+std::shared_ptr<const Explicator_Generation> Explicator::Get_Generation(void) const {
+    return std::atomic_load(&this->generation);
+}
+
+void Explicator::Watch_File(bool enable) {
+#ifdef __linux__
+    if(!enable) {
+        if(!this->watcher.joinable()) return;
+        const char c = 0;
+        while((write(this->watcher_stop_fd, &c, 1) < 0) && (errno == EINTR)) {
+        }
+        this->watcher.join();
+        close(this->watcher_stop_fd);
+        this->watcher_stop_fd = -1;
+        return;
+    }
+    if(this->watcher.joinable()) return; // Already watching.
+
+    // Watch the directory rather than the file, so that replacing the file (e.g., writing a temporary file and then
+    // renaming it over the lexicon) is noticed.
+    const std::filesystem::path path(this->filename);
+    const std::string dir  = path.has_parent_path() ? path.parent_path().string() : std::string(".");
+    const std::string base = path.filename().string();
+
+    const int inotify_fd = inotify_init1(IN_CLOEXEC);
+    if(inotify_fd < 0) {
+        throw std::runtime_error("Unable to watch lexicon '" + this->filename + "'");
+    }
+    int stop_fds[2];
+    if((inotify_add_watch(inotify_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+       || (pipe2(stop_fds, O_CLOEXEC) != 0)) {
+        close(inotify_fd);
+        throw std::runtime_error("Unable to watch lexicon '" + this->filename + "'");
+    }
+    this->watcher_stop_fd = stop_fds[1];
+
+    this->watcher = std::thread([this, inotify_fd, stop_fd = stop_fds[0], base](void) {
+        // Changes are coalesced until the file has been quiet for this long, so a burst of writes causes one reload.
+        const int quiet_ms = 100;
+        bool pending       = false;
+        alignas(struct inotify_event) char buf[4096];
+        while(true) {
+            struct pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+            const int n          = poll(fds, 2, pending ? quiet_ms : -1);
+            if(n < 0) {
+                if(errno == EINTR) continue;
+                FUNCEXPLICATORWARN("Unable to wait for changes to lexicon '" << this->filename << "'. Stopping");
+                break;
+            }
+            if(fds[1].revents != 0) break;
+
+            if(n == 0) {
+                pending = false;
+                try {
+                    this->Reload();
+                } catch(const std::exception &e) {
+                    FUNCEXPLICATORWARN("Unable to reload lexicon: " << e.what());
+                }
+                continue;
+            }
+
+            const ssize_t len = read(inotify_fd, buf, sizeof(buf));
+            for(ssize_t offset = 0; offset < len;) {
+                const auto *event = reinterpret_cast<const struct inotify_event *>(buf + offset);
+                if((event->len != 0) && (base == event->name)) pending = true;
+                offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+            }
+        }
+        close(inotify_fd);
+        close(stop_fd);
+    });
+#else
+    if(enable) throw std::runtime_error("Watching lexicon files is not supported on this platform");
+#endif
+    return;
+}
+
+void Explicator::Set_Cache_Capacity(size_t entries) {
+    this->cache.reset((entries == 0) ? nullptr : new Explicator_Cache(entries));
+    return;
+}
+
+void Explicator::Clear_Cache(void) {
+    if(this->cache != nullptr) this->cache->Invalidate();
+    return;
+}
+
+uint64_t Explicator::Get_Cache_Hits(void) const {
+    return (this->cache == nullptr) ? 0 : this->cache->hits.load();
+}
+
+uint64_t Explicator::Get_Cache_Misses(void) const {
+    return (this->cache == nullptr) ? 0 : this->cache->misses.load();
+}
+
+void Explicator::Attach_Memo(const std::string &file_name) {
+    this->memo.reset(new Translation_Memo(file_name));
+    return;
+}
+
+void Explicator::Detach_Memo(void) {
+    this->memo.reset();
+    return;
+}
+
+uint64_t Explicator::Get_Memo_Hits(void) const {
+    return (this->memo == nullptr) ? 0 : this->memo->hits.load();
+}
+
+uint64_t Explicator::Get_Memo_Misses(void) const {
+    return (this->memo == nullptr) ? 0 : this->memo->misses.load();
 }
 
 std::unique_ptr<std::map<std::string, float>> Explicator::Get_Last_Results(void) {
@@ -402,7 +1605,9 @@ std::tuple<float, float, float, float> Explicator::Cross_Verify(float chunks,
                                                                 long int runs,
                                                                 bool verbose_dump,
                                                                 std::map<uint64_t, float> mod_wghts,
-                                                                std::map<uint64_t, float> mod_tholds) const {
+                                                                std::map<uint64_t, float> mod_tholds,
+                                                                float *cascade_delta) const {
+    if(cascade_delta != nullptr) *cascade_delta = -1.0;
     if(!isininc(0.001, chunks, 1.0) || (runs <= 0)) {
         FUNCEXPLICATORWARN("Invalid input. chunks = " << chunks << " and runs = " << runs << ". Bailing");
         return std::make_tuple(-1.0, -1.0, -1.0, -1.0);
@@ -455,6 +1660,7 @@ std::tuple<float, float, float, float> Explicator::Cross_Verify(float chunks,
     std::mt19937 gen(rd());
 
     long int number_correct = 0, number_false_neg = 0, number_false_pos = 0;
+    long int number_exhaustive_correct = 0; // Correct translations when cascaded matching is bypassed.
     auto ltcomp = [](const std::pair<std::string, float> &A, const std::pair<std::string, float> &B) -> bool {
         return A.second < B.second;
     };
@@ -476,7 +1682,13 @@ std::tuple<float, float, float, float> Explicator::Cross_Verify(float chunks,
         // Now create a new Explicator instance with this data. Duplicate everything except the lexicon. The module
         // thresholds will not be duplicated - pass on the thresholds passed in.
         Explicator scant(sub_lexicon, this->modmask, mod_wghts, mod_tholds);
-        scant.group_threshold = this->group_threshold;
+        scant.group_threshold             = this->group_threshold;
+        scant.cascade_candidate_limit     = this->cascade_candidate_limit;
+        scant.cascade_min_candidates      = this->cascade_min_candidates;
+        scant.cascade_min_candidate_score = this->cascade_min_candidate_score;
+        scant.dicom_hash_search_radius    = this->dicom_hash_search_radius;
+        scant.fusion_early_termination    = this->fusion_early_termination;
+        scant.normalized_key_matching     = this->normalized_key_matching;
 
         // Now cycle through every element in the (complete) lexicon. Ask the spawned explicator to translate the entry.
         // Compare whether or not it is correct.
@@ -487,6 +1699,12 @@ std::tuple<float, float, float, float> Explicator::Cross_Verify(float chunks,
 
             ++TOT;
 
+            if((cascade_delta != nullptr) && (this->cascade_candidate_limit != 0)) {
+                scant.cascade_candidate_limit = 0;
+                if(scant.Translate(dirty).clean == clean) ++number_exhaustive_correct;
+                scant.cascade_candidate_limit = this->cascade_candidate_limit;
+            }
+
             if(output == clean) {
                 if(verbose_dump)
                     FUNCEXPLICATORINFO("Correctly translated (dirty) '" << dirty << "' to (clean) '" << clean << "'");
@@ -557,6 +1775,11 @@ std::tuple<float, float, float, float> Explicator::Cross_Verify(float chunks,
     const float frac_correct   = static_cast<float>(number_correct) / static_cast<float>(TOT);
     const float frac_false_neg = static_cast<float>(number_false_neg) / static_cast<float>(TOT);
     const float frac_false_pos = static_cast<float>(number_false_pos) / static_cast<float>(TOT);
+    if(cascade_delta != nullptr) {
+        *cascade_delta = (this->cascade_candidate_limit == 0)
+                             ? 0.0
+                             : static_cast<float>(number_correct - number_exhaustive_correct) / static_cast<float>(TOT);
+    }
     return std::make_tuple(frac_correct, theo_best, frac_false_neg, frac_false_pos);
 }
 
@@ -593,3 +1816,63 @@ void Explicator::Dump_Translated_Lexicon(void) {
     }
     return;
 }
+
+void Explicator::Write_Snapshot(const std::string &file_name) const {
+    std::lock_guard<std::mutex> lock(this->mutation_mutex);
+    Snapshot_Writer w;
+
+    // Cleans are typically shared by many dirties, so they are stored once and referred to by ID.
+    std::map<std::string, uint32_t> clean_ids;
+    for(const auto &entry : this->lexicon) clean_ids.emplace(entry.second, 0);
+    w.Put(static_cast<uint64_t>(clean_ids.size()));
+    uint32_t next_id = 0;
+    for(auto &clean : clean_ids) {
+        clean.second = next_id++;
+        w.Put_String(clean.first);
+    }
+    w.Put(static_cast<uint64_t>(this->lexicon.size()));
+    for(const auto &entry : this->lexicon) {
+        w.Put_String(entry.first);
+        w.Put(clean_ids[entry.second]);
+    }
+
+    // The exact-match index is discarded when the lexicon is edited, in which case it is rebuilt here.
+    const auto exact_index
+        = (this->exact_index != nullptr) ? this->exact_index : std::make_shared<const Exact_Index>(this->lexicon);
+    exact_index->Save(w, clean_ids);
+    Save_Normalized_Index(w, this->normalized_index, clean_ids);
+
+    // Module state. Note that module state is shared by all Explicator instances, so it reflects whichever instance
+    // most recently initialized the modules.
+    w.Put(this->modmask);
+    std::vector<std::tuple<uint64_t, float, std::string>> states;
+    for(const auto &m : this->modules) {
+        const auto f = Find_Module_Functions(std::get<4>(m));
+        if((f == nullptr) || (f->save == nullptr)) continue;
+        std::string state;
+        (f->save)(state);
+        states.emplace_back(std::get<4>(m), std::get<3>(m), std::move(state));
+    }
+    w.Put(static_cast<uint64_t>(states.size()));
+    for(const auto &s : states) {
+        w.Put(std::get<0>(s));
+        w.Put(std::get<1>(s));
+        w.Put_String(std::get<2>(s));
+    }
+
+    Snapshot_Writer header;
+    header.blob.append(Snapshot_Magic, sizeof(Snapshot_Magic));
+    header.Put(Snapshot_Version);
+    header.Put(Snapshot_Byte_Order);
+    header.Put(static_cast<uint64_t>(w.blob.size()));
+    header.Put(Snapshot_Checksum(w.blob.data(), w.blob.size()));
+
+    std::ofstream FO(file_name, std::ios::out | std::ios::binary | std::ios::trunc);
+    FO.write(header.blob.data(), static_cast<std::streamsize>(header.blob.size()));
+    FO.write(w.blob.data(), static_cast<std::streamsize>(w.blob.size()));
+    FO.close();
+    if(FO.fail()) {
+        throw std::runtime_error("Unable to write lexicon snapshot '" + file_name + "'");
+    }
+    return;
+}
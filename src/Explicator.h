@@ -7,12 +7,19 @@
 // scope of this file has been reduced somewhat - all 'tough' processing has been offloaded into external modules. This
 // file simply parses a lexicon file and provides a base for the modules.
 
+#include <stddef.h>
 #include <stdint.h>
+#include <chrono>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 // These are the functions (signatures) each module must contain. The initialization function, which is called when the
 // module is dynamically loaded OR upon creation of a explicator instance.
@@ -28,10 +35,49 @@ typedef std::unique_ptr<std::map<std::string, float>> (*explicator_module_func_q
 // The de-initialization routine. Used for typical destructor tasks.
 typedef void (*explicator_module_func_deinit)(void);
 
+// Optional routines. A module X provides them as Explicator_Module_X_Save(), Explicator_Module_X_Build(), etc., and
+// lists those it provides in its entry of the module table in Explicator.cc; absent routines are null there.
+//
+// Save and Load store and restore the state computed by the initialization routine. They are used to keep precomputed
+// module state in lexicon snapshots. Load throws std::runtime_error if the state is malformed or cannot be used.
+typedef void (*explicator_module_func_save)(std::string &);
+typedef void (*explicator_module_func_load)(const std::string &);
+
+// Build computes the state for a lexicon without touching the module's global state, and Query_State queries against
+// such a state. They are used to swap lexicons while queries are in flight (see Explicator::Reload()). A built state
+// is never modified afterward; edits are applied to a copy of it (see below).
+typedef std::shared_ptr<const void> (*explicator_module_func_build)(const std::map<std::string, std::string> &, float);
+typedef std::unique_ptr<std::map<std::string, float>> (*explicator_module_func_query_state)(
+    const void *, const std::map<std::string, std::string> &, const std::string &, float);
+
+// Query_V2 is the second-generation query routine. Rather than the raw string, it receives a preprocessed query (see
+// Explicator_Query.h) which is shared by all modules in a translation, so derived forms of the query are computed only
+// once. The state is as per Build, or nullptr to use the state computed by the initialization routine. Modules
+// without this routine are queried through Query or Query_State, and the original query routine of modules which have
+// it is typically an adapter for it.
+class Explicator_Query;
+typedef std::unique_ptr<std::map<std::string, float>> (*explicator_module_func_query_v2)(
+    const void *, const std::map<std::string, std::string> &, const Explicator_Query &, float);
+
+// Add and Remove apply the addition or removal of a single <dirty, clean> entry to the state computed by the
+// initialization routine, so that small edits (see Explicator::Add_Entry()) do not require re-initialization. The
+// lexicon passed in already reflects the edit.
+typedef void (*explicator_module_func_edit)(const std::map<std::string, std::string> &,
+                                            const std::string &,
+                                            const std::string &);
+
+// Add_State and Remove_State apply such an edit to a copy of a state from Build, leaving the original intact, and
+// return the copy. They are used to edit a lexicon published by Explicator::Reload() without rebuilding the state.
+typedef std::shared_ptr<const void> (*explicator_module_func_edit_state)(const std::shared_ptr<const void> &,
+                                                                         const std::map<std::string, std::string> &,
+                                                                         const std::string &,
+                                                                         const std::string &);
+
 namespace Ex_Mods {
     // Custom signals.
-    const uint64_t None  = 1 << 1; // Signals an error or indicates a problem.
-    const uint64_t Exact = 1 << 2;
+    const uint64_t Normalized = 1 << 0; // Loose exact match. See Explicator::normalized_key_matching.
+    const uint64_t None       = 1 << 1; // Signals an error or indicates a problem.
+    const uint64_t Exact      = 1 << 2;
 
     // Edit measures.
     const uint64_t Levenshtein = 1 << 3;
@@ -64,11 +110,127 @@ namespace Ex_Mods {
 
     // Default to a good general set.
     const uint64_t Sane_Defaults = Substrings | JaroWinkler | Levenshtein;
+
+    // Modules which compare the query against every lexicon entry at some expense. See
+    // Explicator::cascade_candidate_limit.
+    const uint64_t Cascade_Expensive = Substrings | JaroWinkler | Levenshtein;
+
+    // A short, human-readable name for a single module or signal. Unknown values are named "Unknown".
+    inline const char *Name(uint64_t mod) {
+        switch(mod) {
+            case None: return "None";
+            case Exact: return "Exact";
+            case Normalized: return "Normalized";
+            case Levenshtein: return "Levenshtein";
+            case JaroWinkler: return "JaroWinkler";
+            case Soundex: return "Soundex";
+            case Dbl_Metaphone: return "Dbl_Metaphone";
+            case MRA: return "MRA";
+            case NGrams: return "NGrams";
+            case Subsequence: return "Subsequence";
+            case Emplacement: return "Emplacement";
+            case DICOM_Hash: return "DICOM_Hash";
+            case DS_Head_Neck: return "DS_Head_Neck";
+            case Substrings: return "Substrings";
+            default: return "Unknown";
+        }
+    }
 }
 
+// The outcome of a single translation. See Explicator::Translate().
+struct Explicator_Translation {
+    std::string clean;                    // The translation, or the suspected mistranslation string.
+    float best_score     = -1.0;          // The highest combined score of any clean.
+    uint64_t best_module = Ex_Mods::None; // The module which contributed most to the translation, if there is one.
+    std::unique_ptr<std::map<std::string, float>> results; // Combined scores of all cleans considered.
+
+    // Bitwise OR of the Ex_Mods of the modules whose scores are reflected in the results. Exact matches report
+    // Ex_Mods::Exact, and translations found in the memo report zero. When a deadline passed before every module
+    // completed (see Translate()), the translation is marked partial and only reflects the completed modules.
+    uint64_t completed_modules = 0;
+    bool partial               = false;
+};
+
+class Explicator_Cache; // Defined in Explicator.cc. See Explicator::Set_Cache_Capacity().
+namespace explicator_internals {
+class Translation_Memo; // See Memo.h and Explicator::Attach_Memo().
+class Exact_Index;      // See Perfect_Hash.h.
+}
+
+// The cleans of a lexicon keyed on a looser canonicalization of their dirty strings, with the number of dirty strings
+// for each: <key, <clean, count>>. See Explicator::normalized_key_matching.
+typedef std::unordered_map<std::string, std::map<std::string, size_t>> explicator_normalized_index;
+
+// An immutable lexicon along with the module states built for it. See Explicator::Reload().
+struct Explicator_Generation {
+    std::map<std::string, std::string> lexicon;
+    uint64_t lexicon_hash = 0; // Identifies the lexicon contents. See Explicator::Attach_Memo().
+    explicator_normalized_index normalized_index;
+    std::shared_ptr<const explicator_internals::Exact_Index> exact_index;
+    std::map<uint64_t, std::pair<explicator_module_func_query_state, std::shared_ptr<const void>>> module_states;
+};
+
 class Explicator {
+  private:
+    // The lexicon most recently published by Reload(), or nullptr if the lexicon and module state above are current.
+    // It is only accessed via std::atomic_load() and std::atomic_store().
+    std::shared_ptr<const Explicator_Generation> generation;
+
+    // Held by the member functions which alter the lexicon, module state, or generation (ReReadFile(),
+    // ReInitModules(), Reload(), Add_Entry(), Remove_Entry()) and by Write_Snapshot(), so that the file watcher cannot
+    // interleave with them.
+    mutable std::mutex mutation_mutex;
+
+    // File watcher used for automatic reloading.
+    std::thread watcher;
+    int watcher_stop_fd = -1; // Write end of a pipe used to wake and stop the watcher.
+
+    // Optional cache of recent translations, or nullptr if caching is disabled.
+    std::unique_ptr<Explicator_Cache> cache;
+
+    // Optional persistent memo of translations, or nullptr if none is attached.
+    std::unique_ptr<explicator_internals::Translation_Memo> memo;
+
+    // Identifies the contents of 'lexicon'. It is maintained by the member functions which alter the lexicon.
+    uint64_t lexicon_hash = 0;
+
+    // Indexes 'lexicon' for normalized_key_matching, and for exact matches. They are maintained along with
+    // 'lexicon_hash', except that the exact-match index cannot be edited, so adding or removing an entry discards it
+    // until the next ReInitModules(). Exact matches are looked up in 'lexicon' meanwhile.
+    explicator_normalized_index normalized_index;
+    std::shared_ptr<const explicator_internals::Exact_Index> exact_index;
+
+    // The indexes must have been built for the lexicon, except that a null exact-match index is rebuilt.
+    std::shared_ptr<const Explicator_Generation>
+    Build_Generation(std::map<std::string, std::string> new_lexicon,
+                     explicator_normalized_index normalized_index,
+                     std::shared_ptr<const explicator_internals::Exact_Index> exact_index) const;
+    const std::string *Find_Exact(const Explicator_Generation *g, const std::string &dirty_chomped) const;
+    const std::string *Find_Normalized(const Explicator_Generation *g, const std::string &dirty_chomped) const;
+    Explicator_Translation Translate_Cached(const std::string &dirty,
+                                           const std::chrono::steady_clock::time_point *deadline) const;
+    Explicator_Translation Translate_Uncached(const std::string &dirty_chomped,
+                                             const std::chrono::steady_clock::time_point *deadline) const;
+    bool Is_Reusable(const Explicator_Translation &out, const std::chrono::steady_clock::time_point *deadline) const;
+    void Score_With_Modules(const Explicator_Generation *g,
+                            const std::map<std::string, std::string> &lexicon,
+                            Explicator_Query &q,
+                            Explicator_Translation &out) const;
+    std::unique_ptr<std::map<std::string, float>> Query_Module(const Explicator_Generation *g,
+                                                               const std::map<std::string, std::string> &lexicon,
+                                                               const std::tuple<explicator_module_func_init,
+                                                                                explicator_module_func_query,
+                                                                                explicator_module_func_deinit,
+                                                                                float,
+                                                                                uint64_t,
+                                                                                float> &m,
+                                                               const Explicator_Query &q) const;
+    void Edit_Modules(const std::string &dirty, const std::string &clean, bool added);
+    void Edit_Generation(Explicator_Generation &g, const std::string &dirty, const std::string &clean, bool added) const;
+
   public:
-    // The lexicon filename which was used as the dictionary.
+    // The lexicon filename which was used as the dictionary. This can be either a text lexicon or a binary snapshot
+    // written by Write_Snapshot().
     std::string filename;
 
     // A collection of the raw entries in the lexicon: <dirty:clean>.
@@ -92,10 +254,48 @@ class Explicator {
     // not fixed and may be automatically regenerated so as to not match any lexicon entries.
     std::string suspected_mistranslation;
 
+    // Module state read from a snapshot, used in place of module initialization by the next ReInitModules() call when
+    // the module's threshold matches: <module ID, <threshold, state>>.
+    std::map<uint64_t, std::pair<float, std::string>> snapshot_module_states;
+
     // Global threshold. It does not apply to individual modules, but rather the total (final) output score. This
     // threshold should be somewhat higher than the individual module thresholds on average.
     float group_threshold;
 
+    // Cheap-first cascaded matching. When enabled, the modules not in Ex_Mods::Cascade_Expensive (e.g., phonetic key,
+    // N-gram, and DICOM_Hash lookups) are run first, and their combined scores select a shortlist of at most
+    // 'cascade_candidate_limit' cleans. The expensive modules then only score lexicon entries for shortlisted cleans.
+    // As recall safeguards, the expensive modules score the whole lexicon instead if fewer than
+    // 'cascade_min_candidates' cleans were found, or if none scored at least 'cascade_min_candidate_score' (weighted
+    // as the final score is, but over the cheap modules alone). Cascading has no effect unless both cheap and expensive
+    // modules are enabled. A limit of zero (the default) disables it. See Cross_Verify() for its effect on accuracy.
+    size_t cascade_candidate_limit;
+    size_t cascade_min_candidates;
+    float cascade_min_candidate_score;
+
+    // Early termination of score fusion. When enabled, modules are run cheapest first, and the remaining modules are
+    // skipped as soon as they cannot change the translation: either one clean is guaranteed to have the highest final
+    // score (and meet the group threshold) whatever they report, or no clean can reach the group threshold. The
+    // translation is the same as without early termination, but the results, best score, and best module then only
+    // reflect the modules which were run. It is only applied when module weights and thresholds are non-negative.
+    bool fusion_early_termination;
+
+    // Normalized-key matching. When enabled, a query with no exact match is canonicalized more aggressively (all
+    // whitespace, punctuation, and underscores removed) and looked up among the lexicon's dirty strings canonicalized
+    // the same way. If they all belong to a single clean, it is the translation, with a score of one and
+    // Ex_Mods::Normalized as the best module, and no modules are run. Otherwise the query is translated as usual.
+    bool normalized_key_matching;
+
+    // The order in which modules are run when translating with a deadline (see Translate()), most important first.
+    // Modules which are not listed are run afterward, cheapest first. Empty (the default) runs every module cheapest
+    // first.
+    std::vector<uint64_t> deadline_module_priority;
+
+    // The Hamming radius within which the DICOM_Hash module looks for matches. When negative (the default), it scans
+    // the lexicon exhaustively. Otherwise it uses a sub-linear multi-index hashing search which only considers lexicon
+    // entries within the radius of the query, and so can miss matches the exhaustive scan would find.
+    long int dicom_hash_search_radius;
+
     //------- Constructors/Destructor --------
     Explicator(const std::string &file_name);
     Explicator(const std::string &file_name, uint64_t modulemask);
@@ -108,7 +308,7 @@ class Explicator {
 
     //------- Member functions --------
     void ResetDefaults(void); // Resets non-module things to default values.
-    void ReReadFile(void);    // Discards the lexicon and reloads from original filename.
+    void ReReadFile(void);    // Discards the lexicon and reloads from original filename (text lexicon or snapshot).
     void ReInitModules(std::map<uint64_t, float> mod_wghts = {},
                        std::map<uint64_t, float> mod_tholds
                        = {}); // Deinits existing modules, inits new modules according to the modmask.
@@ -116,6 +316,88 @@ class Explicator {
     // This is the most important function for the user. Perform translation of given string.
     std::string operator()(const std::string &);
 
+    // Performs a translation without recording it in the 'last_...' members. Unlike operator(), this can be called
+    // concurrently from multiple threads, provided the lexicon and modules are not altered meanwhile (Reload() is fine).
+    Explicator_Translation Translate(const std::string &) const;
+
+    // Performs a translation which stops scoring once the deadline has passed, and returns the best translation of the
+    // modules which completed by then (see Explicator_Translation::completed_modules and deadline_module_priority).
+    // The clock is checked between modules and periodically during the long scans of modules which support it, and
+    // the scores of an interrupted module are discarded. The weights of the completed modules are renormalized, so a
+    // partial translation is judged against the group threshold as a full one would be. Cascaded matching is not used,
+    // so while it is enabled no timed translation is cached or memoized; otherwise only partial ones are excluded. Like
+    // Translate(), this can be called concurrently.
+    Explicator_Translation Translate(const std::string &, std::chrono::steady_clock::time_point deadline) const;
+
+    // Returns the (at most) K cleans with the highest combined scores (as in the results of Translate()), best first,
+    // with ties in clean order. The group threshold is not applied. Modules which support it first report only their
+    // own best few cleans, pruning as they go, and every clean is only scored if that does not settle the top K. An
+    // exact match, or a unique normalized-key match when normalized_key_matching is enabled, is returned alone with a
+    // score of one. Like Translate(), this can be called concurrently. The translation cache, memo, cascaded matching,
+    // and early termination are not used.
+    std::vector<std::pair<std::string, float>> Translate_Top_K(const std::string &, size_t K) const;
+
+    //------- Lexicon editing --------
+    // Adds a <dirty, clean> entry, replacing any existing entry for the dirty string. Both strings are canonicalized as
+    // they are when reading a lexicon. Module state is updated incrementally where supported, and otherwise the module
+    // is re-initialized. Throws std::invalid_argument if either string is empty after canonicalization.
+    //
+    // If a lexicon published by Reload() is in use, the edit is instead applied to a copy of its generation (updating
+    // module state incrementally where supported, as above), which then replaces it.
+    void Add_Entry(const std::string &dirty, const std::string &clean);
+
+    // Removes the entry for the dirty string. Returns false if there is no such entry.
+    bool Remove_Entry(const std::string &dirty);
+
+    //------- Hot reloading --------
+    // Re-reads the lexicon file (text lexicon or snapshot) and builds fresh module state for it off to the side, then
+    // publishes both with a single atomic pointer swap. Module thresholds and weights are kept. If reading fails, an
+    // exception is thrown and the current lexicon remains in use.
+    //
+    // Reload() may be called from another thread (e.g., the file watcher) while a single thread performs queries.
+    // In-flight queries finish against the generation they started with, and the old generation is freed when the last
+    // of them completes. Reload() and the other member functions which alter the lexicon or modules are serialized, so
+    // an edit is applied to whichever generation is current when it runs, and is not discarded by a reload which was
+    // building the next generation meanwhile. Other members (e.g., 'lexicon', Cross_Verify(), Write_Snapshot())
+    // continue to reflect the last ReReadFile(); calling ReReadFile() adopts the file's current contents everywhere.
+    void Reload(void);
+
+    // Returns the generation published by the most recent Reload(), or nullptr if there has been none since the last
+    // ReReadFile().
+    std::shared_ptr<const Explicator_Generation> Get_Generation(void) const;
+
+    // Starts (or stops) a background thread which calls Reload() whenever the lexicon file is rewritten or replaced.
+    // Bursts of changes are coalesced, and failed reloads only emit a warning. Only available on Linux; throws
+    // std::runtime_error elsewhere or if the file cannot be watched.
+    void Watch_File(bool enable);
+
+    //------- Translation cache --------
+    // Enables a bounded, least-recently-used cache of complete translations keyed on the canonicalized dirty string.
+    // The cache is sharded so that concurrent Translate() calls rarely contend. It is emptied automatically whenever
+    // the lexicon or modules change via member functions (ReReadFile(), ReInitModules(), Reload(), Add_Entry(), etc.)
+    // and whenever the module weights or thresholds, the group threshold, or the module mask differ from those the
+    // cached translations were made with. Call Clear_Cache() after editing the 'lexicon' member directly.
+    //
+    // A capacity of zero (the default) disables the cache. Changing the capacity empties the cache and resets the
+    // counters, and must not be done concurrently with translation.
+    void Set_Cache_Capacity(size_t entries);
+    void Clear_Cache(void);
+    uint64_t Get_Cache_Hits(void) const;
+    uint64_t Get_Cache_Misses(void) const;
+
+    //------- Persistent memo --------
+    // Attaches a memo file (created if it does not exist) which records translations so they can be reused by later
+    // runs and other processes, skipping scoring entirely. Entries are stamped with a hash of the lexicon contents and
+    // of the settings covered by the translation cache, so entries made with another lexicon or configuration are
+    // ignored. Exact matches are not recorded. Translations read from the memo carry only the winning clean (if any)
+    // in their results. Throws std::runtime_error if the file cannot be used.
+    //
+    // Attaching or detaching must not be done concurrently with translation.
+    void Attach_Memo(const std::string &file_name);
+    void Detach_Memo(void);
+    uint64_t Get_Memo_Hits(void) const;
+    uint64_t Get_Memo_Misses(void) const;
+
     // Retrieval of info from most recent translation.
     std::unique_ptr<std::map<std::string, float>> Get_Last_Results(void); // Can only be called once per query!
     float Get_Last_Best_Score(void) const;
@@ -123,16 +405,25 @@ class Explicator {
 
     //------- Measurement routines --------
     // Perform folding cross-validation. Returns frac of correct translations, maximum theoretical frac of correct, frac
-    // of false negs, frac of false pos. Also used internally for optimization.
+    // of false negs, frac of false pos. Also used internally for optimization. If provided, cascade_delta receives the
+    // change in frac of correct due to cascaded matching (i.e., relative to translating the same queries exhaustively;
+    // zero if cascading is disabled).
     std::tuple<float, float, float, float> Cross_Verify(float chunks,
                                                         long int runs,
                                                         bool verbose_dump,
                                                         std::map<uint64_t, float> mod_wghts  = {},
-                                                        std::map<uint64_t, float> mod_tholds = {}) const;
+                                                        std::map<uint64_t, float> mod_tholds = {},
+                                                        float *cascade_delta                 = nullptr) const;
 
     std::map<uint64_t, float> Get_Module_Thresholds(void) const;
     std::map<uint64_t, float> Get_Module_Weights(void) const;
 
     void Dump_Translated_Lexicon(
         void); // Run through lexicon to see if it will properly translate itself. Useful for module checking.
+
+    //------- Snapshots --------
+    // Writes the canonicalized lexicon, its exact-match and normalized-key indexes, and the precomputed state of the
+    // loaded modules to a versioned, checksummed binary snapshot. Passing the snapshot to a constructor in place of a
+    // lexicon file skips parsing, indexing, and (for modules which support it) module initialization.
+    void Write_Snapshot(const std::string &file_name) const;
 };
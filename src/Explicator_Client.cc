@@ -0,0 +1,159 @@
+// Explicator_Client.cc - Client for the explicator daemon.
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Daemon_Protocol.h"
+#include "Explicator_Client.h"
+#include "Snapshot.h"
+
+namespace explicator_internals {
+
+// Reads exactly N bytes. Returns the number of bytes read before the peer closed the connection.
+static size_t Read_Fully(int fd, char *buf, size_t N) {
+    size_t done = 0;
+    while(done < N) {
+        const auto n = read(fd, buf + done, N - done);
+        if(n == 0) break;
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            throw std::runtime_error(std::string("Unable to read from socket: ") + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+    return done;
+}
+
+bool Read_Frame(int fd, std::string &payload) {
+    uint32_t size = 0;
+    const auto n = Read_Fully(fd, reinterpret_cast<char *>(&size), sizeof(size));
+    if(n == 0) return false;
+    if(n != sizeof(size)) throw std::runtime_error("Connection closed mid-frame");
+    if(Daemon_Max_Frame < size) throw std::runtime_error("Frame exceeds the maximum size");
+
+    payload.resize(size);
+    if(Read_Fully(fd, &payload[0], size) != size) throw std::runtime_error("Connection closed mid-frame");
+    return true;
+}
+
+void Write_Frame(int fd, const std::string &payload) {
+    if(Daemon_Max_Frame < payload.size()) throw std::runtime_error("Frame exceeds the maximum size");
+    const auto size = static_cast<uint32_t>(payload.size());
+    std::string frame(reinterpret_cast<const char *>(&size), sizeof(size));
+    frame += payload;
+
+    size_t done = 0;
+    while(done < frame.size()) {
+        const auto n = send(fd, frame.data() + done, frame.size() - done, MSG_NOSIGNAL);
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            throw std::runtime_error(std::string("Unable to write to socket: ") + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+}
+
+std::string Encode_Translate_Request(const std::string &lexicon, const std::vector<std::string> &dirties) {
+    Snapshot_Writer w;
+    w.Put(Daemon_Op_Translate);
+    w.Put_String(lexicon);
+    w.Put(static_cast<uint64_t>(dirties.size()));
+    for(const auto &dirty : dirties) w.Put_String(dirty);
+    return std::move(w.blob);
+}
+
+void Decode_Translate_Request(const std::string &payload, std::string &lexicon, std::vector<std::string> &dirties) {
+    Snapshot_Reader r(payload);
+    if(r.Get<uint8_t>() != Daemon_Op_Translate) throw std::runtime_error("Unrecognized request");
+    lexicon = r.Get_String();
+    dirties.resize(r.Get_Count(sizeof(uint64_t)));
+    for(auto &dirty : dirties) dirty = r.Get_String();
+    if(!r.Empty()) throw std::runtime_error("Request has trailing data");
+}
+
+std::string Encode_Translate_Response(const std::vector<Explicator_Client_Result> &results, uint64_t daemon_ns) {
+    Snapshot_Writer w;
+    w.Put(Daemon_Status_OK);
+    w.Put(daemon_ns);
+    w.Put(static_cast<uint64_t>(results.size()));
+    for(const auto &res : results) {
+        w.Put_String(res.clean);
+        w.Put(res.score);
+        w.Put(res.module);
+    }
+    return std::move(w.blob);
+}
+
+std::string Encode_Error_Response(const std::string &message, uint64_t daemon_ns) {
+    Snapshot_Writer w;
+    w.Put(Daemon_Status_Error);
+    w.Put(daemon_ns);
+    w.Put_String(message);
+    return std::move(w.blob);
+}
+
+} //namespace explicator_internals
+
+using namespace explicator_internals;
+
+Explicator_Client::Explicator_Client(const std::string &socket_path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(sizeof(addr.sun_path) <= socket_path.size()) {
+        throw std::runtime_error("Socket path '" + socket_path + "' is too long");
+    }
+    std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+    this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if(this->fd < 0) {
+        throw std::runtime_error(std::string("Unable to create socket: ") + std::strerror(errno));
+    }
+    if(connect(this->fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0) {
+        const std::string err = std::strerror(errno);
+        close(this->fd);
+        throw std::runtime_error("Unable to connect to daemon at '" + socket_path + "': " + err);
+    }
+}
+
+Explicator_Client::~Explicator_Client() {
+    close(this->fd);
+}
+
+void Explicator_Client::Send(const std::string &lexicon, const std::vector<std::string> &dirties) {
+    Write_Frame(this->fd, Encode_Translate_Request(lexicon, dirties));
+}
+
+std::vector<Explicator_Client_Result> Explicator_Client::Receive(uint64_t *daemon_ns) {
+    std::string payload;
+    if(!Read_Frame(this->fd, payload)) throw std::runtime_error("The daemon closed the connection");
+
+    Snapshot_Reader r(payload);
+    const auto status = r.Get<uint8_t>();
+    const auto ns     = r.Get<uint64_t>();
+    if(daemon_ns != nullptr) *daemon_ns = ns;
+    if(status != Daemon_Status_OK) {
+        throw std::runtime_error("The daemon reported an error: " + r.Get_String());
+    }
+
+    std::vector<Explicator_Client_Result> results(r.Get_Count(sizeof(uint64_t) + sizeof(float) + sizeof(uint64_t)));
+    for(auto &res : results) {
+        res.clean  = r.Get_String();
+        res.score  = r.Get<float>();
+        res.module = r.Get<uint64_t>();
+    }
+    return results;
+}
+
+std::vector<Explicator_Client_Result> Explicator_Client::Translate(const std::string &lexicon,
+                                                                   const std::vector<std::string> &dirties,
+                                                                   uint64_t *daemon_ns) {
+    this->Send(lexicon, dirties);
+    return this->Receive(daemon_ns);
+}
@@ -0,0 +1,48 @@
+// Explicator_Client.h - Client for the explicator daemon.
+//
+// The daemon (see examples/Daemon.cc) loads lexicons once and serves translations over a Unix domain socket, so short-
+// lived processes need not pay for lexicon loading and module initialization.
+//
+// Requests on a connection are handled in order, so a client can pipeline several batches before reading the replies.
+// Replies then arrive in the same order. Keep the number of outstanding batches modest (e.g., a few dozen), otherwise
+// both peers can block writing into full socket buffers.
+//
+// The wire protocol is internal to this library and the daemon (see Daemon_Protocol.h).
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct Explicator_Client_Result {
+    std::string clean;
+    float score     = -1.0;
+    uint64_t module = 0;
+};
+
+class Explicator_Client {
+  public:
+    // Connects to a daemon. Throws std::runtime_error if the connection fails.
+    explicit Explicator_Client(const std::string &socket_path);
+    ~Explicator_Client();
+
+    Explicator_Client(const Explicator_Client &) = delete;
+    Explicator_Client &operator=(const Explicator_Client &) = delete;
+
+    // Sends a batch of strings for translation with the named lexicon, without waiting for the reply.
+    void Send(const std::string &lexicon, const std::vector<std::string> &dirties);
+
+    // Receives the reply to the oldest outstanding batch. The time the daemon spent on the batch is stored in
+    // 'daemon_ns' if provided. Throws std::runtime_error if the daemon reports an error or the connection fails.
+    std::vector<Explicator_Client_Result> Receive(uint64_t *daemon_ns = nullptr);
+
+    // Sends a batch and waits for its reply.
+    std::vector<Explicator_Client_Result> Translate(const std::string &lexicon,
+                                                    const std::vector<std::string> &dirties,
+                                                    uint64_t *daemon_ns = nullptr);
+
+  private:
+    int fd;
+};
@@ -2,20 +2,55 @@
 //
 
 #include <stddef.h>
-#include <bitset>
-#include <iterator>
-#include <list>
+#include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <map>
 #include <memory>
-#include <sstream>
+#include <set>
+#include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "Explicator_Query.h"
 #include "Misc.h"
+#include "Snapshot.h"
 
-typedef std::bitset<70> feature_space_vec;
+using namespace explicator_internals;
 
-static std::list<std::pair<std::string, feature_space_vec>> hashed_lexicon; // clean string,  hash(dirty string).
+// Only 55 features are used, so a hash fits within a single machine word. Bit i of the word is feature i.
+typedef uint64_t feature_space_vec;
+
+// The hashed lexicon is held in a dicom_hash_state (below), which is shared by the Init function and by hot-reloaded
+// generations. Its entries are the unique hashes of the dirty strings, kept in a contiguous array so that scoring can
+// stream over them, along with the cleans of each entry (dirty strings with identical hashes, which are very common
+// after case folding, are collapsed into a single entry) and the multi-index hash tables described next.
+
+// Multi-index hashing. The (used portion of the) hash is split into MIH_Chunks disjoint substrings, and the entries are
+// indexed by each substring separately. By the pigeonhole principle, any entry within Hamming distance r of a query
+// must agree with the query to within floor(r/MIH_Chunks) bits on at least one substring. So the candidates can be
+// enumerated by probing only the nearby buckets, without touching the rest of the lexicon.
+//
+// Each table is stored in compressed form: the entries in bucket b are mih_ids[k][mih_offsets[k][b] ...
+// mih_offsets[k][b+1]).
+static const unsigned int MIH_Chunks     = 5;
+static const unsigned int MIH_Chunk_Bits = 11; // MIH_Chunks * MIH_Chunk_Bits must cover all 55 features.
+
+struct dicom_hash_state {
+    std::vector<feature_space_vec> hashed_lexicon;        // Unique hash(dirty string)s.
+    std::vector<std::vector<std::string>> hashed_cleans; // clean strings, in the same order as hashed_lexicon.
+    std::array<std::vector<uint32_t>, MIH_Chunks> mih_offsets; // Multi-index hash tables, one per chunk.
+    std::array<std::vector<uint32_t>, MIH_Chunks> mih_ids;
+};
+
+static std::shared_ptr<dicom_hash_state> current_state = std::make_shared<dicom_hash_state>();
+
+// Masks which select each group of features.
+static const feature_space_vec Chars_Present_Mask = (static_cast<feature_space_vec>(1) << 26) - 1;   // Bits [0,25].
+static const feature_space_vec Word_Firsts_Mask   = Chars_Present_Mask << 26;                       // Bits [26,51].
+static const feature_space_vec First_L_or_R_Mask  = static_cast<feature_space_vec>(0x3) << 52;       // Bits [52,53].
+static const feature_space_vec Multi_Word_Mask    = static_cast<feature_space_vec>(1) << 54;         // Bit [54].
 
 // This file provides a hash function which is geared toward matching similar strings.
 // specifically for DICOM-ish (medical) tags and strings. Emphasis is placed on
@@ -48,80 +83,74 @@ static std::list<std::pair<std::string, feature_space_vec>> hashed_lexicon; // c
 
 feature_space_vec DICOM_Hash(const std::string &in) {
     feature_space_vec out(0);
-    size_t found;
 
-    //-----------------------------------------------Let the hashing
-    // begin-------------------------------------------------
-    //----BITS [0,25]: Denote characters present.
-    for(unsigned int i = 0; i < 26; ++i) { // A (65) - Z (90)  ((ascii codes)).
-        found = in.find(static_cast<unsigned char>(i + 65));
-        if(found != std::string::npos) {
-            out.set(i);
-        }
-    }
-    for(unsigned int i = 0; i < 26; ++i) { // a (97) - z (122)  ((ascii codes)).
-        found = in.find(static_cast<unsigned char>(i + 97));
-        if(found != std::string::npos) {
-            out.set(i);
+    // The hash is computed in a single pass. Words are delimited as per the default behaviour of a stream: any of
+    // ' ', '\t', '\n', '\v', '\f', or '\r'. Word-based features stop at an embedded null, which is where a C-string
+    // copy would end.
+    const auto is_ws = [](char c) -> bool {
+        return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\v') || (c == '\f') || (c == '\r');
+    };
+    const auto bit = [](unsigned int i) -> feature_space_vec { return static_cast<feature_space_vec>(1) << i; };
+
+    bool words_ended    = false; // Whether an embedded null has been encountered.
+    bool firsts_ended   = false; // Whether a word which does not begin with [A-Za-z] has been encountered.
+    bool in_word        = false;
+    bool first_nonspace = true;
+    size_t wrd_cnt      = 0;
+    for(const char c : in) {
+        unsigned int index = 26; // Letter index, or 26 if not a letter.
+        if(isininc('A', c, 'Z')) {
+            index = static_cast<unsigned int>(c - 'A');
+        } else if(isininc('a', c, 'z')) {
+            index = static_cast<unsigned int>(c - 'a');
         }
-    }
 
-    //----BITS [26,51]: Denote ASCII Characters present at beginning of words.
-    {
-        std::istringstream inss(in.c_str());
-        std::string temp;
-        bool wasgood;
-        while(inss.good()) {
-            wasgood = inss.good();
-            inss >> temp;
-            if(wasgood && (temp.size() > 0)) {
-                const char *char_out = temp.c_str();
-                if(char_out[0] == '\0') {
-                    break;
-                }
+        //----BITS [0,25]: Denote characters present.
+        if(index < 26) {
+            out |= bit(index);
+        }
 
-                unsigned int ascii_code = static_cast<unsigned int>(char_out[0]);
-                unsigned int index;
-                if(isininc(65, ascii_code, 90)) { // This is what we want. Lowercase.
-                    index = ascii_code - 65;
-                } else if(isininc(97, ascii_code, 122)) { // Uppercase
-                    index = ascii_code - 65 - 32;
-                } else {
-                    break;
-                }
-                // std::cout << "First letter was '" << static_cast<unsigned char>(ascii_code) << "', converted to index
-                // (" << index << ")" << std::endl;
-                out.set(index + 26);
+        //----BIT [52]: If the first non-space char is 'L' or 'l'.
+        //----BIT [53]: If the first non-space char is 'r' or 'R'.
+        if(first_nonspace && (c != ' ')) {
+            first_nonspace = false;
+            if(index == static_cast<unsigned int>('L' - 'A')) {
+                out |= bit(52);
+            } else if(index == static_cast<unsigned int>('R' - 'A')) {
+                out |= bit(53);
             }
         }
-    }
 
-    //----BIT [52]: If the first non-space char is 'L' or 'l'.
-    found = in.find_first_not_of(' ');
-    if((found != std::string::npos) && ((in[found] == 'l') || (in[found] == 'L'))) {
-        out.set(52);
-    }
+        if(c == '\0') {
+            words_ended = true;
+        }
+        if(words_ended) {
+            continue;
+        }
+        if(is_ws(c)) {
+            in_word = false;
+            continue;
+        }
+        if(in_word) {
+            continue;
+        }
+        in_word = true;
+        ++wrd_cnt;
 
-    //----BIT [53]: If the first non-space char is 'r' or 'R'.
-    found = in.find_first_not_of(' ');
-    if((found != std::string::npos) && ((in[found] == 'r') || (in[found] == 'R'))) {
-        out.set(53);
+        //----BITS [26,51]: Denote ASCII Characters present at beginning of words.
+        // Stop looking at words as soon as one begins with a non-letter.
+        if(!firsts_ended) {
+            if(index < 26) {
+                out |= bit(index + 26);
+            } else {
+                firsts_ended = true;
+            }
+        }
     }
 
     //----BIT [54]: If the string is one word or multiple words.
-    //    (Here we make use of how strngstreams iterators break up streams into strings (separated by any amount of
-    //     whitespace.))
-    {
-        std::istringstream inss(in.c_str());
-        std::istream_iterator<std::string> it(inss);
-        std::istream_iterator<std::string> end; // Default constructor is 'End of Stream.'
-        size_t wrd_cnt = 0;
-        while((it++) != end) {
-            ++wrd_cnt; // NOTE: Won't work with ++it!
-        }
-        if(wrd_cnt > 1) {
-            out.set(54);
-        }
+    if(wrd_cnt > 1) {
+        out |= bit(54);
     }
 
     return out;
@@ -134,92 +163,107 @@ long int DICOM_Hash_dist(const feature_space_vec &A, const feature_space_vec &B)
     //
     // NOTE: That this metric differs significantly than the DICOM_Hash_score(...) metric.
     // For instance: for the score, higher is better. For the distance, lower is better!
-    if(A.size() != B.size())
-        FUNCEXPLICATORERR("Attempting to compare hashes of different lengths");
-    long int res = 0;
-    for(unsigned int i = 0; i < A.size(); ++i) {
-        if(A[i] != B[i]) {
-            ++res;
-        }
-    }
-    return res;
+    return static_cast<long int>(EXPLICATORPOPCOUNT(A ^ B));
 }
 
 // This score function returns low values for bad matches and high values for good matches.
+//
+// The score is a weighted sum of the number of agreeing bits in each group of features, so it reduces to a handful of
+// masked popcounts.
 long int DICOM_Hash_score(const feature_space_vec &A, const feature_space_vec &B) {
-    if(A.size() != B.size())
-        FUNCEXPLICATORERR("Attempting to compare hashes of different lengths");
-    long int res = 0;
+    const feature_space_vec same = ~(A ^ B);
 
     // To increase the flexibility of weighting, each basic token of 'score' is 6000.
     // This allows us to multiply it, divide it, and break it into reasonable units.
     const long int unit = 6000;
-    for(long int i = 0; i < static_cast<long int>(A.size()); ++i) {
-        //----BITS [0,25]: Denote characters present.
-        // We penalize a small amount for being off. We increase unit score for matching bits.
-        if(isininc(0, i, 25)) {
-            if(A[i] == B[i]) {
-                res += unit;
-            } else {
-                res -= unit / 3;
-            }
-        }
 
-        //----BITS [26,51]: Denote Characters present at beginning of words.
-        // We doubly-value first-of-word letters. They rarely seem to get dropped upon shortening.
-        if(isininc(26, i, 51)) {
-            if(A[i] == B[i]) {
-                res += 2 * unit;
-            }
-        }
+    //----BITS [0,25]: Denote characters present.
+    // We penalize a small amount for being off. We increase unit score for matching bits.
+    const auto chars_same = static_cast<long int>(EXPLICATORPOPCOUNT(same & Chars_Present_Mask));
+    long int res          = unit * chars_same - (unit / 3) * (26 - chars_same);
 
-        //----BIT [52]: If the first non-space char is 'L' or 'l'.
-        // We highly value preceeding 'l' or 'L's They are unlikely to EVER be lost upon shortening.
-        if(isininc(52, i, 52)) {
-            if(A[i] == B[i]) {
-                res += 4 * unit;
-            }
-        }
+    //----BITS [26,51]: Denote Characters present at beginning of words.
+    // We doubly-value first-of-word letters. They rarely seem to get dropped upon shortening.
+    res += 2 * unit * static_cast<long int>(EXPLICATORPOPCOUNT(same & Word_Firsts_Mask));
 
-        //----BIT [53]: If the first non-space char is 'R' or 'r'.
-        // We highly value preceeding 'r' or 'R's They are unlikely to EVER be lost upon shortening.
-        if(isininc(53, i, 53)) {
-            if(A[i] == B[i]) {
-                res += 4 * unit;
-            }
-        }
+    //----BIT [52]: If the first non-space char is 'L' or 'l'.
+    //----BIT [53]: If the first non-space char is 'R' or 'r'.
+    // We highly value preceeding 'l', 'L', 'r', or 'R's They are unlikely to EVER be lost upon shortening.
+    res += 4 * unit * static_cast<long int>(EXPLICATORPOPCOUNT(same & First_L_or_R_Mask));
 
-        //----BIT [54]: If the string is one word or multiple words.
-        // I am contemplating even leaving this one in here...
-        if(isininc(54, i, 54)) {
-            if(A[i] == B[i]) {
-                res += unit / 2;
-            }
-        }
-    }
+    //----BIT [54]: If the string is one word or multiple words.
+    // I am contemplating even leaving this one in here...
+    res += (unit / 2) * static_cast<long int>(EXPLICATORPOPCOUNT(same & Multi_Word_Mask));
     return res;
 }
 
-// Initializor function.
-void Explicator_Module_DICOM_Hash_Init(const std::map<std::string, std::string> &lexicon,
-                                       float threshold) { // The lexicon looks like: < dirty : clean >.
+static feature_space_vec MIH_Chunk(feature_space_vec h, unsigned int k) {
+    return (h >> (k * MIH_Chunk_Bits)) & ((static_cast<feature_space_vec>(1) << MIH_Chunk_Bits) - 1);
+}
+
+// Visits every chunk value within Hamming distance 'radius' of 'value', flipping bits at positions >= 'from'.
+template <class F>
+static void MIH_Enumerate_Neighbours(feature_space_vec value, unsigned int from, long int radius, F &&visit) {
+    visit(value);
+    if(radius <= 0) return;
+    for(unsigned int b = from; b < MIH_Chunk_Bits; ++b) {
+        MIH_Enumerate_Neighbours(value ^ (static_cast<feature_space_vec>(1) << b), b + 1, radius - 1, visit);
+    }
+}
+
+static std::shared_ptr<dicom_hash_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    // The lexicon looks like: < dirty : clean >.
     // We run through the data and compute a hash of each (dirty) string. Upon a query, we compute the hash and compare
     // hashes.
-    hashed_lexicon.clear();
-    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
-        hashed_lexicon.push_back(std::pair<std::string, feature_space_vec>(it->second, DICOM_Hash(it->first)));
+    std::map<feature_space_vec, std::set<std::string>> unique_hashes;
+    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) { unique_hashes[DICOM_Hash(it->first)].insert(it->second); }
+
+    auto state           = std::make_shared<dicom_hash_state>();
+    auto &hashed_lexicon = state->hashed_lexicon;
+    auto &hashed_cleans  = state->hashed_cleans;
+    hashed_lexicon.reserve(unique_hashes.size());
+    hashed_cleans.reserve(unique_hashes.size());
+    for(auto &h : unique_hashes) {
+        hashed_lexicon.push_back(h.first);
+        hashed_cleans.emplace_back(h.second.begin(), h.second.end());
     }
+
+    // Build the multi-index hash tables using a counting sort on each chunk.
+    const size_t N = hashed_lexicon.size();
+    for(unsigned int k = 0; k < MIH_Chunks; ++k) {
+        auto &offsets = state->mih_offsets[k];
+        auto &ids     = state->mih_ids[k];
+        offsets.assign((static_cast<size_t>(1) << MIH_Chunk_Bits) + 1, 0);
+        ids.resize(N);
+        for(size_t i = 0; i < N; ++i) ++offsets[MIH_Chunk(hashed_lexicon[i], k) + 1];
+        for(size_t b = 1; b < offsets.size(); ++b) offsets[b] += offsets[b - 1];
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t i = 0; i < N; ++i) ids[fill[MIH_Chunk(hashed_lexicon[i], k)]++] = static_cast<uint32_t>(i);
+    }
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_DICOM_Hash_Build(const std::map<std::string, std::string> &lexicon,
+                                                               float threshold) {
+    return Build_State(lexicon);
+}
+
+// Initializor function.
+void Explicator_Module_DICOM_Hash_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
 }
 
-// Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_DICOM_Hash_Query(const std::map<std::string, std::string> &lexicon,
-                                   const std::string &in,
-                                   float threshold) {
+Explicator_Module_DICOM_Hash_Query_V2(const void *state,
+                                      const std::map<std::string, std::string> &lexicon,
+                                      const Explicator_Query &q,
+                                      float threshold) {
+    if(state == nullptr) state = current_state.get();
     // Remember: The lexicon looks like: < dirty : clean >
     std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
-    const feature_space_vec in_hashed      = DICOM_Hash(in);
-    const feature_space_vec inverse_hashed = feature_space_vec(in_hashed).flip();
+    const auto &S = *static_cast<const dicom_hash_state *>(state);
+    const feature_space_vec in_hashed      = DICOM_Hash(q.Text());
+    const feature_space_vec inverse_hashed = ~in_hashed;
 
     const float theobest = static_cast<float>(
         DICOM_Hash_score(in_hashed, in_hashed)); // Perfect match. This score will be the highest possible.
@@ -237,22 +281,235 @@ Explicator_Module_DICOM_Hash_Query(const std::map<std::string, std::string> &lex
         return output;
     }
 
-    for(auto it = hashed_lexicon.begin(); it != hashed_lexicon.end(); ++it) {
-        const float score  = static_cast<float>(DICOM_Hash_score(it->second, in_hashed));
-        const float scaled = (score - theoworst) / (theobest - theoworst);
+    // The build uses -ffast-math, under which the original per-entry division was compiled as a multiplication by the
+    // reciprocal of the range. Whether the optimizer still does so depends on how this function is structured, and an
+    // ulp of difference can flip threshold comparisons, so the multiplication is spelled out to keep scores
+    // bit-identical.
+    const float inv_range = 1.0F / (theobest - theoworst);
 
-        if((scaled > threshold) && (!(output->find(it->first) != output->end())
-                                    || ((*output)[it->first] < scaled))) { // If this score is higher.
-            (*output)[it->first] = scaled;
-            // Do not break on an exact match. This is not a very exact module and this is detrimental to mixing with
-            // other modules.
-            // if(score == theobest) break; //This is an exact match - no need to look further.
+    const auto consider = [&](size_t i, long int raw_score) -> void {
+        const float score  = static_cast<float>(raw_score);
+        const float scaled = (score - theoworst) * inv_range;
+        if(!(scaled > threshold)) return;
+        for(const auto &clean : S.hashed_cleans[i]) {
+            if(!(output->find(clean) != output->end()) || ((*output)[clean] < scaled)) { // If this score is higher.
+                (*output)[clean] = scaled;
+                // Do not break on an exact match. This is not a very exact module and this is detrimental to mixing
+                // with other modules.
+                // if(score == theobest) break; //This is an exact match - no need to look further.
+            }
+        }
+    };
+
+    // A negative search radius means the lexicon is scanned exhaustively, which exactly honours the threshold.
+    // Otherwise only entries within the radius are considered, which is faster but may miss some matches.
+    const size_t N                  = S.hashed_lexicon.size();
+    const feature_space_vec *hashes = S.hashed_lexicon.data();
+    const long int search_radius    = q.Search_Radius();
+    if(search_radius < 0) {
+        // Score every entry first. This loop has no branches or allocations, so it can be vectorized by the compiler.
+        std::vector<long int> scores(N);
+        for(size_t i = 0; i < N; ++i) { scores[i] = DICOM_Hash_score(hashes[i], in_hashed); }
+        for(size_t i = 0; i < N; ++i) consider(i, scores[i]);
+
+    } else {
+        // Enumerate the candidates within the search radius using the multi-index hash tables. The visited marks are
+        // per-thread scratch space, so concurrent queries (e.g., against different generations) do not interfere.
+        thread_local std::vector<uint64_t> mih_visited; // Query generation during which each entry was last visited.
+        thread_local uint64_t mih_generation = 0;
+        if(mih_visited.size() != N) mih_visited.assign(N, 0);
+        const uint64_t gen = ++mih_generation;
+        const long int sub_radius = search_radius / static_cast<long int>(MIH_Chunks);
+        for(unsigned int k = 0; k < MIH_Chunks; ++k) {
+            const auto &offsets = S.mih_offsets[k];
+            const auto &ids     = S.mih_ids[k];
+            if(offsets.empty()) break;
+            MIH_Enumerate_Neighbours(MIH_Chunk(in_hashed, k), 0, sub_radius, [&](feature_space_vec b) -> void {
+                for(uint32_t j = offsets[b]; j < offsets[b + 1]; ++j) {
+                    const uint32_t i = ids[j];
+                    if(mih_visited[i] == gen) continue;
+                    mih_visited[i] = gen;
+                    if(DICOM_Hash_dist(hashes[i], in_hashed) <= search_radius) {
+                        consider(i, DICOM_Hash_score(hashes[i], in_hashed));
+                    }
+                }
+            });
         }
     }
     return output;
 }
 
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DICOM_Hash_Query_State(const void *state,
+                                         const std::map<std::string, std::string> &lexicon,
+                                         const std::string &in,
+                                         float threshold) {
+    return Explicator_Module_DICOM_Hash_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+// Query function.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DICOM_Hash_Query(const std::map<std::string, std::string> &lexicon,
+                                   const std::string &in,
+                                   float threshold) {
+    return Explicator_Module_DICOM_Hash_Query_State(current_state.get(), lexicon, in, threshold);
+}
+
+// Snapshot functions.
+void Explicator_Module_DICOM_Hash_Save(std::string &state) {
+    const auto &S = *current_state;
+    Snapshot_Writer w;
+    w.Put(static_cast<uint32_t>(MIH_Chunks));
+    w.Put(static_cast<uint32_t>(MIH_Chunk_Bits));
+    w.Put_Vector(S.hashed_lexicon);
+    for(const auto &cleans : S.hashed_cleans) {
+        w.Put(static_cast<uint64_t>(cleans.size()));
+        for(const auto &clean : cleans) w.Put_String(clean);
+    }
+    for(unsigned int k = 0; k < MIH_Chunks; ++k) {
+        w.Put_Vector(S.mih_offsets[k]);
+        w.Put_Vector(S.mih_ids[k]);
+    }
+    state = std::move(w.blob);
+}
+
+void Explicator_Module_DICOM_Hash_Load(const std::string &state) {
+    Snapshot_Reader r(state);
+    if((r.Get<uint32_t>() != MIH_Chunks) || (r.Get<uint32_t>() != MIH_Chunk_Bits)) {
+        throw std::runtime_error("Snapshot multi-index hashing layout does not match");
+    }
+    auto loaded          = std::make_shared<dicom_hash_state>();
+    auto &hashed_lexicon = loaded->hashed_lexicon;
+    auto &mih_offsets    = loaded->mih_offsets;
+    auto &mih_ids        = loaded->mih_ids;
+    hashed_lexicon       = r.Get_Vector<feature_space_vec>();
+    loaded->hashed_cleans.assign(hashed_lexicon.size(), {});
+    for(auto &cleans : loaded->hashed_cleans) {
+        cleans.resize(r.Get_Count(sizeof(uint64_t)));
+        for(auto &clean : cleans) clean = r.Get_String();
+    }
+    const size_t N = hashed_lexicon.size();
+    for(unsigned int k = 0; k < MIH_Chunks; ++k) {
+        mih_offsets[k] = r.Get_Vector<uint32_t>();
+        mih_ids[k]     = r.Get_Vector<uint32_t>();
+        if((mih_offsets[k].size() != ((static_cast<size_t>(1) << MIH_Chunk_Bits) + 1)) || (mih_ids[k].size() != N)
+           || (mih_offsets[k].back() != N)) {
+            throw std::runtime_error("Snapshot multi-index hashing tables are malformed");
+        }
+    }
+    current_state = loaded;
+}
+
+// Multi-index hash table maintenance for incremental edits. Each costs O(N) for moving the bucket contents.
+static void MIH_Insert(dicom_hash_state &S, uint32_t i) {
+    for(unsigned int k = 0; k < MIH_Chunks; ++k) {
+        auto &offsets = S.mih_offsets[k];
+        auto &ids     = S.mih_ids[k];
+        if(offsets.empty()) offsets.assign((static_cast<size_t>(1) << MIH_Chunk_Bits) + 1, 0);
+        const auto b = MIH_Chunk(S.hashed_lexicon[i], k);
+        ids.insert(ids.begin() + offsets[b + 1], i);
+        for(size_t bb = b + 1; bb < offsets.size(); ++bb) ++offsets[bb];
+    }
+}
+
+static void MIH_Erase(dicom_hash_state &S, uint32_t i) {
+    for(unsigned int k = 0; k < MIH_Chunks; ++k) {
+        auto &offsets = S.mih_offsets[k];
+        auto &ids     = S.mih_ids[k];
+        const auto b  = MIH_Chunk(S.hashed_lexicon[i], k);
+        ids.erase(std::find(ids.begin() + offsets[b], ids.begin() + offsets[b + 1], i));
+        for(size_t bb = b + 1; bb < offsets.size(); ++bb) --offsets[bb];
+    }
+}
+
+static void MIH_Renumber(dicom_hash_state &S, uint32_t from, uint32_t to) {
+    for(unsigned int k = 0; k < MIH_Chunks; ++k) {
+        auto &offsets = S.mih_offsets[k];
+        auto &ids     = S.mih_ids[k];
+        const auto b  = MIH_Chunk(S.hashed_lexicon[from], k);
+        *std::find(ids.begin() + offsets[b], ids.begin() + offsets[b + 1], from) = to;
+    }
+}
+
+// Incremental lexicon edits. New hashes are appended rather than kept in sorted order, which does not affect scoring.
+static void Add_To_State(dicom_hash_state &S,
+                         const std::map<std::string, std::string> &lexicon,
+                         const std::string &dirty,
+                         const std::string &clean) {
+    const auto h = DICOM_Hash(dirty);
+    const auto i = std::find(S.hashed_lexicon.begin(), S.hashed_lexicon.end(), h) - S.hashed_lexicon.begin();
+    if(static_cast<size_t>(i) != S.hashed_lexicon.size()) {
+        auto &cleans   = S.hashed_cleans[i];
+        const auto pos = std::lower_bound(cleans.begin(), cleans.end(), clean);
+        if((pos == cleans.end()) || (*pos != clean)) cleans.insert(pos, clean);
+        return;
+    }
+    S.hashed_lexicon.push_back(h);
+    S.hashed_cleans.push_back({clean});
+    MIH_Insert(S, static_cast<uint32_t>(S.hashed_lexicon.size() - 1));
+}
+
+static void Remove_From_State(dicom_hash_state &S,
+                              const std::map<std::string, std::string> &lexicon,
+                              const std::string &dirty,
+                              const std::string &clean) {
+    // The clean stays with the hash if any of its remaining dirty strings share it.
+    const auto h = DICOM_Hash(dirty);
+    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
+        if((it->second == clean) && (DICOM_Hash(it->first) == h)) return;
+    }
+    const auto i = std::find(S.hashed_lexicon.begin(), S.hashed_lexicon.end(), h) - S.hashed_lexicon.begin();
+    if(static_cast<size_t>(i) == S.hashed_lexicon.size()) return;
+    auto &cleans   = S.hashed_cleans[i];
+    const auto pos = std::lower_bound(cleans.begin(), cleans.end(), clean);
+    if((pos == cleans.end()) || (*pos != clean)) return;
+    cleans.erase(pos);
+    if(!cleans.empty()) return;
+
+    // Drop the now-empty entry, moving the last entry into its place.
+    const auto last = static_cast<uint32_t>(S.hashed_lexicon.size() - 1);
+    MIH_Erase(S, static_cast<uint32_t>(i));
+    if(static_cast<uint32_t>(i) != last) {
+        MIH_Renumber(S, last, static_cast<uint32_t>(i));
+        S.hashed_lexicon[i] = S.hashed_lexicon[last];
+        S.hashed_cleans[i]  = std::move(S.hashed_cleans[last]);
+    }
+    S.hashed_lexicon.pop_back();
+    S.hashed_cleans.pop_back();
+}
+
+void Explicator_Module_DICOM_Hash_Add(const std::map<std::string, std::string> &lexicon,
+                                      const std::string &dirty,
+                                      const std::string &clean) {
+    Add_To_State(*current_state, lexicon, dirty, clean);
+}
+
+void Explicator_Module_DICOM_Hash_Remove(const std::map<std::string, std::string> &lexicon,
+                                         const std::string &dirty,
+                                         const std::string &clean) {
+    Remove_From_State(*current_state, lexicon, dirty, clean);
+}
+
+std::shared_ptr<const void> Explicator_Module_DICOM_Hash_Add_State(const std::shared_ptr<const void> &state,
+                                                                   const std::map<std::string, std::string> &lexicon,
+                                                                   const std::string &dirty,
+                                                                   const std::string &clean) {
+    auto S = std::make_shared<dicom_hash_state>(*static_cast<const dicom_hash_state *>(state.get()));
+    Add_To_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_DICOM_Hash_Remove_State(const std::shared_ptr<const void> &state,
+                                          const std::map<std::string, std::string> &lexicon,
+                                          const std::string &dirty,
+                                          const std::string &clean) {
+    auto S = std::make_shared<dicom_hash_state>(*static_cast<const dicom_hash_state *>(state.get()));
+    Remove_From_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_DICOM_Hash_Deinit(void) {
-    hashed_lexicon.clear();
+    current_state = std::make_shared<dicom_hash_state>();
 }
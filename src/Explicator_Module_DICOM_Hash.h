@@ -5,9 +5,48 @@
 //#include <utility>
 #include <memory>
 
+class Explicator_Query;
+
 void Explicator_Module_DICOM_Hash_Init(const std::map<std::string, std::string> &, float threshold);
 
 std::unique_ptr<std::map<std::string, float> >
 Explicator_Module_DICOM_Hash_Query(const std::map<std::string, std::string> &, const std::string &, float threshold);
 
 void Explicator_Module_DICOM_Hash_Deinit(void);
+
+std::shared_ptr<const void>
+Explicator_Module_DICOM_Hash_Build(const std::map<std::string, std::string> &, float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DICOM_Hash_Query_State(const void *state,
+                                         const std::map<std::string, std::string> &,
+                                         const std::string &,
+                                         float threshold);
+
+// Explicator_Query::Search_Radius() selects between an exhaustive scan of the lexicon (radius < 0, the default) and a
+// sub-linear multi-index hashing search which only considers lexicon entries within the radius of the query. The latter
+// can miss matches the exhaustive scan would find.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DICOM_Hash_Query_V2(const void *state,
+                                      const std::map<std::string, std::string> &,
+                                      const Explicator_Query &,
+                                      float threshold);
+
+void Explicator_Module_DICOM_Hash_Save(std::string &state);
+void Explicator_Module_DICOM_Hash_Load(const std::string &state);
+
+void Explicator_Module_DICOM_Hash_Add(const std::map<std::string, std::string> &,
+                                      const std::string &dirty,
+                                      const std::string &clean);
+void Explicator_Module_DICOM_Hash_Remove(const std::map<std::string, std::string> &,
+                                         const std::string &dirty,
+                                         const std::string &clean);
+std::shared_ptr<const void> Explicator_Module_DICOM_Hash_Add_State(const std::shared_ptr<const void> &state,
+                                                                   const std::map<std::string, std::string> &,
+                                                                   const std::string &dirty,
+                                                                   const std::string &clean);
+std::shared_ptr<const void>
+Explicator_Module_DICOM_Hash_Remove_State(const std::shared_ptr<const void> &state,
+                                          const std::map<std::string, std::string> &,
+                                          const std::string &dirty,
+                                          const std::string &clean);
@@ -4,47 +4,153 @@
 // In a sense, this is a way to 'cheat' a small/incomplete lexicon. On the other
 // hand, we cannot anticipate *every* incoming string, so it is probably best to
 // utilize as much data as we can.
+//
+// NOTE: The rules were originally an if/else cascade. They are now expressed as data and compiled into a single
+// multi-pattern automaton at initialization, so each query makes one pass over the string.
 
 #include <stddef.h>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "Explicator_Query.h"
+#include "Rules.h"
 #include "String.h"
 
 using namespace explicator_internals;
 
+// The rules, in priority order: the first rule satisfied determines the output. See Rules.h for the syntax. Inputs are
+// canonicalized (all spaces removed and upper-cased) prior to matching.
+static const std::vector<std::pair<std::string, std::string>> Head_and_Neck_Rules = {
+    // JUNK - stuff which can easily be picked out.
+    {"JUNK", "OPTI$"},
+    {"JUNK", "+ & MM|CM|MARGIN"},
+    {"JUNK", "LOBES"},
+    {"JUNK", "EYES"},
+    {"JUNK", "PAROTIDS"},
+
+    // Body. Should not be many surprises here.
+    {"Body", "^BODY"},
+
+    // Brainstem.
+    {"Brainstem", "STEM$"},
+    {"Brainstem", "^BSTEM"},
+
+    // Chiasm.
+    {"Chiasm", "IASM"},
+
+    // Cord.
+    {"Cord", "CORD$"},
+    {"Cord", "SPINAL"},
+
+    // CTV.
+    {"CTV", "^CTV"},
+    {"CTV", "CLINICAL & TARGET|VOL"},
+
+    // GTV.
+    {"GTV", "^GTV"},
+    {"GTV", "GROSS & TARGET|VOL"},
+
+    // Larynx.
+    {"Larynx", "LARYNX"},
+    {"Larynx", "VOICE"},
+
+    // Left Eye.
+    {"Left Eye", "^L & EYE$"},
+
+    // Left Optic Nerve.
+    {"Left Optic Nerve", "L & NERVE"},
+    {"Left Optic Nerve", "L & NRV"},
+    {"Left Optic Nerve", "L & OPTIC"},
+
+    // Left Parotid.
+    {"Left Parotid", "L & PAR"},
+    {"Left Parotid", "^LPAR"},
+    {"Left Parotid", "^LTPA"},
+    {"Left Parotid", "^LEFTPAR"},
+
+    // Right Submandibular.
+    {"Right Submand", "^R|@3:R & SUB"},
+    {"Right Submand", "^R|@3:R & SMGLAND"},
+    {"Right Submand", "RSUB"},
+
+    // Left Submandibular.
+    {"Left Submand", "^L|@3:L & SUB"},
+    {"Left Submand", "^L|@3:L & SMGLAND"},
+    {"Left Submand", "LSUB"},
+
+    // Right Temp Lobe.
+    {"Right Temp Lobe", "^R|@3:R & TEMP"},
+    {"Right Temp Lobe", "RTEMPORAL"},
+    {"Right Temp Lobe", "RTEMP"},
+
+    // Left Temp Lobe.
+    {"Left Temp Lobe", "^L|@3:L & TEMP"},
+    {"Left Temp Lobe", "LTEMPORAL"},
+    {"Left Temp Lobe", "LTEMP"},
+
+    // Right Eye.
+    {"Right Eye", "^R & EYE$"},
+
+    // Right Optic Nerve.
+    {"Right Optic Nerve", "R & NERVE"},
+    {"Right Optic Nerve", "R & NRV"},
+    {"Right Optic Nerve", "R & OPTIC"},
+
+    // Right Parotid.
+    {"Right Parotid", "R & PAR"},
+    {"Right Parotid", "^RPAR"},
+    {"Right Parotid", "^RTPA"},
+    {"Right Parotid", "^RIGHTPAR"},
+};
+
+static std::shared_ptr<const Rule_Cascade> current_state = std::make_shared<Rule_Cascade>();
+
+std::shared_ptr<const void> Explicator_Module_DS_Head_and_Neck_Build(const std::map<std::string, std::string> &lexicon,
+                                                                     float threshold) {
+    return std::make_shared<Rule_Cascade>(Head_and_Neck_Rules);
+}
+
 // Initializor function.
 void Explicator_Module_DS_Head_and_Neck_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = std::make_shared<Rule_Cascade>(Head_and_Neck_Rules);
     return;
 }
 
-static std::string Last(const std::string &in, size_t N) { // Gets the last N characters from a string, if possible.
-    if(in.size() <= N) {
-        return in;
-    }
-    return in.substr(in.size() - N, N); // Need the -1 because size() is 1-based, but operator[] is 0-based.
-}
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DS_Head_and_Neck_Query_V2(const void *state,
+                                            const std::map<std::string, std::string> &lexicon,
+                                            const Explicator_Query &q,
+                                            float threshold) {
+    if(state == nullptr) state = current_state.get();
+    // Remember: The lexicon looks like: < dirty : clean >
+    std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
+    const auto &head_and_neck_cascade = *static_cast<const Rule_Cascade *>(state);
+    const std::string &X = q.Spaceless(); // All spaces removed.
 
-static std::string First(const std::string &in, size_t N) { // Gets the first N characters from a string, if possible.
-    if(in.size() <= N) {
-        return in;
+    const auto rule = head_and_neck_cascade.Match(X);
+    if(rule >= 0) {
+        (*output)[head_and_neck_cascade.Output(rule)] = 1.0;
     }
-    return in.substr(0, N);
-}
 
-static std::string Position(const std::string &in, size_t N) { // Gets the character at position N, if possible.
-    if(in.size() <= N) {
-        return in;
+    //--------------------------------------------------------------------------------------------
+    //---- Is it OK to call the rest junk? Is it smart to? (I think probably not! - probably creates lots of extra false
+    // positives...)
+    if(output->empty()) {
+        (*output)["JUNK"] = 1.0;
     }
-    std::string temp;
-    temp += in[N];
-    return temp;
+
+    return output;
 }
-static bool Contains(const std::string &in, const std::string &pattern) {
-    auto it = in.find(pattern);
-    return (it != std::string::npos);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DS_Head_and_Neck_Query_State(const void *state,
+                                               const std::map<std::string, std::string> &lexicon,
+                                               const std::string &in,
+                                               float threshold) {
+    return Explicator_Module_DS_Head_and_Neck_Query_V2(state, lexicon, Explicator_Query(in), threshold);
 }
 
 // Query function.
@@ -52,156 +158,40 @@ std::unique_ptr<std::map<std::string, float>>
 Explicator_Module_DS_Head_and_Neck_Query(const std::map<std::string, std::string> &lexicon,
                                          const std::string &in,
                                          float threshold) {
-    // Remember: The lexicon looks like: < dirty : clean >
-    std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
-    const std::string X
-        = Canonicalize_String2(in, CANONICALIZE::TRIM_ALL | CANONICALIZE::TO_UPPER); // Remove all spaces.
-    // FUNCEXPLICATORINFO("X is now " << X); //Show that this string has correctly been canonicalized. Do not be confused by the
-    // Cross_Verify output!
-
-    //--------------------------------------------------------------------------------------------
-    // JUNK - stuff which can easily be picked out.
-    if(Last(X, 4) == "OPTI") {
-        (*output)["JUNK"] = 1.0;
-
-    } else if(Contains(X, "+") && (Contains(X, "MM") || Contains(X, "CM") || Contains(X, "MARGIN"))) {
-        (*output)["JUNK"] = 1.0;
-
-    } else if(Contains(X, "LOBES")) {
-        (*output)["JUNK"] = 1.0;
-
-    } else if(Contains(X, "EYES")) {
-        (*output)["JUNK"] = 1.0;
+    return Explicator_Module_DS_Head_and_Neck_Query_State(current_state.get(), lexicon, in, threshold);
+}
 
-    } else if(Contains(X, "PAROTIDS")) {
-        (*output)["JUNK"] = 1.0;
+// Incremental lexicon edits. The rules do not depend on the lexicon, so there is nothing to update.
+void Explicator_Module_DS_Head_and_Neck_Add(const std::map<std::string, std::string> &lexicon,
+                                            const std::string &dirty,
+                                            const std::string &clean) {
+    return;
+}
 
-        // Body. Should not be many surprises here.
-    } else if(First(X, 4) == "BODY") {
-        (*output)["Body"] = 1.0;
-
-        // Brainstem.
-    } else if(Last(X, 4) == "STEM") {
-        (*output)["Brainstem"] = 1.0;
-    } else if(First(X, 5) == "BSTEM") {
-        (*output)["Brainstem"] = 1.0;
-
-        // Chiasm.
-    } else if(Contains(X, "IASM")) {
-        (*output)["Chiasm"] = 1.0;
-
-        // Cord.
-    } else if(Last(X, 4) == "CORD") {
-        (*output)["Cord"] = 1.0;
-    } else if(Contains(X, "SPINAL")) {
-        (*output)["Cord"] = 1.0;
-
-        // CTV.
-    } else if(First(X, 3) == "CTV") {
-        (*output)["CTV"] = 1.0;
-    } else if(Contains(X, "CLINICAL") && (Contains(X, "TARGET") || Contains(X, "VOL"))) {
-        (*output)["CTV"] = 1.0;
-
-        // GTV.
-    } else if(First(X, 3) == "GTV") {
-        (*output)["GTV"] = 1.0;
-    } else if(Contains(X, "GROSS") && (Contains(X, "TARGET") || Contains(X, "VOL"))) {
-        (*output)["GTV"] = 1.0;
-
-        // Larynx.
-    } else if(Contains(X, "LARYNX")) {
-        (*output)["Larynx"] = 1.0;
-    } else if(Contains(X, "VOICE")) {
-        (*output)["Larynx"] = 1.0;
-
-        // Left Eye.
-    } else if((First(X, 1) == "L") && (Last(X, 3) == "EYE")) {
-        (*output)["Left Eye"] = 1.0;
-
-        // Left Optic Nerve.
-    } else if(Contains(X, "L") && Contains(X, "NERVE")) {
-        (*output)["Left Optic Nerve"] = 1.0;
-    } else if(Contains(X, "L") && Contains(X, "NRV")) {
-        (*output)["Left Optic Nerve"] = 1.0;
-    } else if(Contains(X, "L") && Contains(X, "OPTIC")) {
-        (*output)["Left Optic Nerve"] = 1.0;
-
-        // Left Parotid.
-    } else if(Contains(X, "L") && Contains(X, "PAR")) {
-        (*output)["Left Parotid"] = 1.0;
-    } else if(X.substr(0, 4) == "LPAR") {
-        (*output)["Left Parotid"] = 1.0;
-    } else if(X.substr(0, 4) == "LTPA") {
-        (*output)["Left Parotid"] = 1.0;
-    } else if(X.substr(0, 7) == "LEFTPAR") {
-        (*output)["Left Parotid"] = 1.0;
-
-        // Right Submandibular.
-    } else if(((First(X, 1) == "R") || (Position(X, 3) == "R")) && Contains(X, "SUB")) {
-        (*output)["Right Submand"] = 1.0;
-    } else if(((First(X, 1) == "R") || (Position(X, 3) == "R")) && Contains(X, "SMGLAND")) {
-        (*output)["Right Submand"] = 1.0;
-    } else if(Contains(X, "RSUB")) {
-        (*output)["Right Submand"] = 1.0;
-
-        // Left Submandibular.
-    } else if(((First(X, 1) == "L") || (Position(X, 3) == "L")) && Contains(X, "SUB")) {
-        (*output)["Left Submand"] = 1.0;
-    } else if(((First(X, 1) == "L") || (Position(X, 3) == "L")) && Contains(X, "SMGLAND")) {
-        (*output)["Left Submand"] = 1.0;
-    } else if(Contains(X, "LSUB")) {
-        (*output)["Left Submand"] = 1.0;
-
-        // Right Temp Lobe.
-    } else if(((First(X, 1) == "R") || (Position(X, 3) == "R")) && Contains(X, "TEMP")) {
-        (*output)["Right Temp Lobe"] = 1.0;
-    } else if(Contains(X, "RTEMPORAL")) {
-        (*output)["Right Temp Lobe"] = 1.0;
-    } else if(Contains(X, "RTEMP")) {
-        (*output)["Right Temp Lobe"] = 1.0;
-
-        // Left Temp Lobe.
-    } else if(((First(X, 1) == "L") || (Position(X, 3) == "L")) && Contains(X, "TEMP")) {
-        (*output)["Left Temp Lobe"] = 1.0;
-    } else if(Contains(X, "LTEMPORAL")) {
-        (*output)["Left Temp Lobe"] = 1.0;
-    } else if(Contains(X, "LTEMP")) {
-        (*output)["Left Temp Lobe"] = 1.0;
-
-        // Right Eye.
-    } else if((First(X, 1) == "R") && (Last(X, 3) == "EYE")) {
-        (*output)["Right Eye"] = 1.0;
-
-        // Right Optic Nerve.
-    } else if(Contains(X, "R") && Contains(X, "NERVE")) {
-        (*output)["Right Optic Nerve"] = 1.0;
-    } else if(Contains(X, "R") && Contains(X, "NRV")) {
-        (*output)["Right Optic Nerve"] = 1.0;
-    } else if(Contains(X, "R") && Contains(X, "OPTIC")) {
-        (*output)["Right Optic Nerve"] = 1.0;
-
-        // Right Parotid.
-    } else if(Contains(X, "R") && (Contains(X, "PAR"))) {
-        (*output)["Right Parotid"] = 1.0;
-    } else if(X.substr(0, 4) == "RPAR") {
-        (*output)["Right Parotid"] = 1.0;
-    } else if(X.substr(0, 4) == "RTPA") {
-        (*output)["Right Parotid"] = 1.0;
-    } else if(X.substr(0, 8) == "RIGHTPAR") {
-        (*output)["Right Parotid"] = 1.0;
-    }
+void Explicator_Module_DS_Head_and_Neck_Remove(const std::map<std::string, std::string> &lexicon,
+                                               const std::string &dirty,
+                                               const std::string &clean) {
+    return;
+}
 
-    //--------------------------------------------------------------------------------------------
-    //---- Is it OK to call the rest junk? Is it smart to? (I think probably not! - probably creates lots of extra false
-    // positives...)
-    if(output->empty()) {
-        (*output)["JUNK"] = 1.0;
-    }
+std::shared_ptr<const void>
+Explicator_Module_DS_Head_and_Neck_Add_State(const std::shared_ptr<const void> &state,
+                                             const std::map<std::string, std::string> &lexicon,
+                                             const std::string &dirty,
+                                             const std::string &clean) {
+    return state;
+}
 
-    return output;
+std::shared_ptr<const void>
+Explicator_Module_DS_Head_and_Neck_Remove_State(const std::shared_ptr<const void> &state,
+                                                const std::map<std::string, std::string> &lexicon,
+                                                const std::string &dirty,
+                                                const std::string &clean) {
+    return state;
 }
 
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_DS_Head_and_Neck_Deinit(void) {
+    current_state = std::make_shared<Rule_Cascade>();
     return;
 }
@@ -9,6 +9,8 @@
 #include <utility>
 #include <memory>
 
+class Explicator_Query;
+
 void Explicator_Module_DS_Head_and_Neck_Init(const std::map<std::string, std::string> &, float threshold);
 
 std::unique_ptr<std::map<std::string, float> >
@@ -17,3 +19,34 @@ Explicator_Module_DS_Head_and_Neck_Query(const std::map<std::string, std::string
                                          float threshold);
 
 void Explicator_Module_DS_Head_and_Neck_Deinit(void);
+
+std::shared_ptr<const void>
+Explicator_Module_DS_Head_and_Neck_Build(const std::map<std::string, std::string> &, float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DS_Head_and_Neck_Query_State(const void *state,
+                                               const std::map<std::string, std::string> &,
+                                               const std::string &,
+                                               float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_DS_Head_and_Neck_Query_V2(const void *state,
+                                            const std::map<std::string, std::string> &,
+                                            const Explicator_Query &,
+                                            float threshold);
+
+void Explicator_Module_DS_Head_and_Neck_Add(const std::map<std::string, std::string> &,
+                                            const std::string &dirty,
+                                            const std::string &clean);
+void Explicator_Module_DS_Head_and_Neck_Remove(const std::map<std::string, std::string> &,
+                                               const std::string &dirty,
+                                               const std::string &clean);
+std::shared_ptr<const void> Explicator_Module_DS_Head_and_Neck_Add_State(const std::shared_ptr<const void> &state,
+                                                                         const std::map<std::string, std::string> &,
+                                                                         const std::string &dirty,
+                                                                         const std::string &clean);
+std::shared_ptr<const void>
+Explicator_Module_DS_Head_and_Neck_Remove_State(const std::shared_ptr<const void> &state,
+                                                const std::map<std::string, std::string> &,
+                                                const std::string &dirty,
+                                                const std::string &clean);
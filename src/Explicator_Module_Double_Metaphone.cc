@@ -13,18 +13,24 @@
 // dealing with (poorly) translated text, or things like people's names
 // (which it was designed for).
 
+#include <array>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
-#include <vector>
-#include <array>
 
+#include "Explicator_Query.h"
 #include "String.h" //Needed for Canonicalize_String(...)
 
 using namespace explicator_internals;
 
-static std::vector<std::pair<std::string, std::string>> DM_lexicon;
+struct double_metaphone_state {
+    std::unordered_map<std::string, std::set<std::string>> index; // Condensed phonetic key -> cleans.
+};
+
+static std::shared_ptr<double_metaphone_state> current_state = std::make_shared<double_metaphone_state>();
 
 namespace DOUBLEMETAPHONE {
     const unsigned char VOWEL = 0x1;
@@ -41,52 +47,49 @@ static char DM_at(const std::string &word, int index) {
     }
     return word[index];
 }
+
+// This table holds info about each letter, e.g., A, B, C, ..., Z. Both cases are populated so that a single lookup
+// suffices. All other characters (including the null returned by DM_at) have no properties.
+static constexpr std::array<unsigned char, 256> Make_DM_Table(void) {
+    const unsigned char alpha[26] = {DOUBLEMETAPHONE::VOWEL,
+                                     DOUBLEMETAPHONE::NOGHF,
+                                     DOUBLEMETAPHONE::V_SND,
+                                     DOUBLEMETAPHONE::NOGHF,
+                                     DOUBLEMETAPHONE::VOWEL | DOUBLEMETAPHONE::F_VOW,
+                                     DOUBLEMETAPHONE::SAME,
+                                     DOUBLEMETAPHONE::V_SND,
+                                     DOUBLEMETAPHONE::NOGHF,
+                                     DOUBLEMETAPHONE::VOWEL | DOUBLEMETAPHONE::F_VOW,
+                                     DOUBLEMETAPHONE::SAME,
+                                     0,
+                                     DOUBLEMETAPHONE::SAME,
+                                     DOUBLEMETAPHONE::SAME,
+                                     DOUBLEMETAPHONE::SAME,
+                                     DOUBLEMETAPHONE::VOWEL,
+                                     DOUBLEMETAPHONE::V_SND,
+                                     0,
+                                     DOUBLEMETAPHONE::SAME,
+                                     DOUBLEMETAPHONE::V_SND,
+                                     DOUBLEMETAPHONE::V_SND,
+                                     DOUBLEMETAPHONE::VOWEL,
+                                     0,
+                                     0,
+                                     0,
+                                     DOUBLEMETAPHONE::F_VOW,
+                                     0};
+    std::array<unsigned char, 256> t{};
+    for(int i = 0; i < 26; ++i) {
+        t['A' + i] = alpha[i];
+        t['a' + i] = alpha[i];
+    }
+    return t;
+}
+static constexpr std::array<unsigned char, 256> DM_Table = Make_DM_Table();
+
 static bool DM_is(char ch, const unsigned char flag) {
-    // Check if the given character (a-z) has the given property associated with it.
-    //
-    // Note that this function is a bit tortuous. There are several 'gotchas' associated with converting the char,
-    // locales, and the (remote!) possibility of non-contiguous alphabet causing an out-of-bounds memory access if I
-    // were to use std::isupper/std::islower/std::isalpha.
-
-    // This array holds info about each letter, e.g., A, B, C, ..., Z.
-    const std::array<char,26> alpha = {{ DOUBLEMETAPHONE::VOWEL,
-                                         DOUBLEMETAPHONE::NOGHF,
-                                         DOUBLEMETAPHONE::V_SND,
-                                         DOUBLEMETAPHONE::NOGHF,
-                                         DOUBLEMETAPHONE::VOWEL | DOUBLEMETAPHONE::F_VOW,
-                                         DOUBLEMETAPHONE::SAME,
-                                         DOUBLEMETAPHONE::V_SND,
-                                         DOUBLEMETAPHONE::NOGHF,
-                                         DOUBLEMETAPHONE::VOWEL | DOUBLEMETAPHONE::F_VOW,
-                                         DOUBLEMETAPHONE::SAME,
-                                         static_cast<char>(0),
-                                         DOUBLEMETAPHONE::SAME,
-                                         DOUBLEMETAPHONE::SAME,
-                                         DOUBLEMETAPHONE::SAME,
-                                         DOUBLEMETAPHONE::VOWEL,
-                                         DOUBLEMETAPHONE::V_SND,
-                                         static_cast<char>(0),
-                                         DOUBLEMETAPHONE::SAME,
-                                         DOUBLEMETAPHONE::V_SND,
-                                         DOUBLEMETAPHONE::V_SND,
-                                         DOUBLEMETAPHONE::VOWEL,
-                                         static_cast<char>(0),
-                                         static_cast<char>(0),
-                                         static_cast<char>(0),
-                                         DOUBLEMETAPHONE::F_VOW,
-                                         static_cast<char>(0) }};
-
-    const int ch_int = static_cast<int>(ch);
-    const int a_int = static_cast<int>('a');
-    const int z_int = static_cast<int>('z');
-    const int A_int = static_cast<int>('A');
-    const int Z_int = static_cast<int>('Z');
-    const int offset_from_a = ch_int - a_int;
-    const int offset_from_A = ch_int - A_int;
-    const bool inside_AZ = (A_int <= ch_int) && (ch_int <= Z_int);
-    const bool inside_az = (a_int <= ch_int) && (ch_int <= z_int);
-    return inside_AZ ? static_cast<bool>(alpha.at(offset_from_A) & flag) :
-           inside_az ? static_cast<bool>(alpha.at(offset_from_a) & flag) : false;
+    // Check if the given character (a-z) has the given property associated with it. The lookup is done on the unsigned
+    // value to avoid locale-dependent std::isupper/std::islower/std::isalpha and negative indices.
+    return (DM_Table[static_cast<unsigned char>(ch)] & flag) != 0;
 }
 
 std::string Double_Metaphone_To_Condensed_Phonetic(const std::string &input) {
@@ -238,43 +241,121 @@ std::string Double_Metaphone_To_Condensed_Phonetic(const std::string &input) {
     return key;
 }
 
-// Initializor function.
-void Explicator_Module_Double_Metaphone_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
-    DM_lexicon.clear();
+static std::shared_ptr<double_metaphone_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    auto state = std::make_shared<double_metaphone_state>();
 
-    // Transform each (dirty) string in the lexicon into the double metaphone format.
+    // Transform each (dirty) string in the lexicon into the double metaphone format and index the cleans by it.
     for(auto i = lexicon.begin(); i != lexicon.end(); ++i) {
-        DM_lexicon.push_back(
-            std::pair<std::string, std::string>(Double_Metaphone_To_Condensed_Phonetic(i->first), i->second));
+        state->index[Double_Metaphone_To_Condensed_Phonetic(i->first)].insert(i->second);
     }
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_Double_Metaphone_Build(const std::map<std::string, std::string> &lexicon,
+                                                                     float threshold) {
+    return Build_State(lexicon);
+}
+
+// Initializor function.
+void Explicator_Module_Double_Metaphone_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
 }
 
-// Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_Double_Metaphone_Query(const std::map<std::string, std::string> &lexicon,
-                                         const std::string &in,
-                                         float threshold) {
+Explicator_Module_Double_Metaphone_Query_V2(const void *state,
+                                            const std::map<std::string, std::string> &lexicon,
+                                            const Explicator_Query &q,
+                                            float threshold) {
+    if(state == nullptr) state = current_state.get();
     std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
+    const auto &DM_index = static_cast<const double_metaphone_state *>(state)->index;
 
     // If the threshold completely disallows (perfect) matches, then honor it by bailing gracefully.
     if(threshold > 1.0) {
         return output;
     }
 
-    // Compute the double metaphone format of this string. Compare it to those previously computed.
-    const std::string condensed(Double_Metaphone_To_Condensed_Phonetic(in));
-
-    // Cycle over the condensed elements in the lexicon, looking for precise matches.
-    for(auto it = DM_lexicon.begin(); it != DM_lexicon.end(); ++it) {
-        if(it->first == condensed) {
-            (*output)[it->second] = 1.0;
-        }
+    // Compute the double metaphone format of this string. Only precise matches with those previously computed count.
+    const auto it = DM_index.find(q.Key(Double_Metaphone_To_Condensed_Phonetic));
+    if(it != DM_index.end()) {
+        for(const auto &clean : it->second) { (*output)[clean] = 1.0; }
     }
 
     return output;
 }
 
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Double_Metaphone_Query_State(const void *state,
+                                               const std::map<std::string, std::string> &lexicon,
+                                               const std::string &in,
+                                               float threshold) {
+    return Explicator_Module_Double_Metaphone_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+// Query function.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Double_Metaphone_Query(const std::map<std::string, std::string> &lexicon,
+                                         const std::string &in,
+                                         float threshold) {
+    return Explicator_Module_Double_Metaphone_Query_State(current_state.get(), lexicon, in, threshold);
+}
+
+// Incremental lexicon edits.
+static void Add_To_State(double_metaphone_state &S,
+                         const std::map<std::string, std::string> &lexicon,
+                         const std::string &dirty,
+                         const std::string &clean) {
+    S.index[Double_Metaphone_To_Condensed_Phonetic(dirty)].insert(clean);
+}
+
+static void Remove_From_State(double_metaphone_state &S,
+                              const std::map<std::string, std::string> &lexicon,
+                              const std::string &dirty,
+                              const std::string &clean) {
+    // The clean stays indexed under the key if any of its remaining dirty strings share it.
+    const auto key = Double_Metaphone_To_Condensed_Phonetic(dirty);
+    for(auto i = lexicon.begin(); i != lexicon.end(); ++i) {
+        if((i->second == clean) && (Double_Metaphone_To_Condensed_Phonetic(i->first) == key)) return;
+    }
+    auto it = S.index.find(key);
+    if(it == S.index.end()) return;
+    it->second.erase(clean);
+    if(it->second.empty()) S.index.erase(it);
+}
+
+void Explicator_Module_Double_Metaphone_Add(const std::map<std::string, std::string> &lexicon,
+                                            const std::string &dirty,
+                                            const std::string &clean) {
+    Add_To_State(*current_state, lexicon, dirty, clean);
+}
+
+void Explicator_Module_Double_Metaphone_Remove(const std::map<std::string, std::string> &lexicon,
+                                               const std::string &dirty,
+                                               const std::string &clean) {
+    Remove_From_State(*current_state, lexicon, dirty, clean);
+}
+
+std::shared_ptr<const void>
+Explicator_Module_Double_Metaphone_Add_State(const std::shared_ptr<const void> &state,
+                                             const std::map<std::string, std::string> &lexicon,
+                                             const std::string &dirty,
+                                             const std::string &clean) {
+    auto S = std::make_shared<double_metaphone_state>(*static_cast<const double_metaphone_state *>(state.get()));
+    Add_To_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_Double_Metaphone_Remove_State(const std::shared_ptr<const void> &state,
+                                                const std::map<std::string, std::string> &lexicon,
+                                                const std::string &dirty,
+                                                const std::string &clean) {
+    auto S = std::make_shared<double_metaphone_state>(*static_cast<const double_metaphone_state *>(state.get()));
+    Remove_From_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_Double_Metaphone_Deinit(void) {
-    DM_lexicon.clear();
+    current_state = std::make_shared<double_metaphone_state>();
 }
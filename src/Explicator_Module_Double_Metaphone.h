@@ -7,6 +7,8 @@
 #include <utility>
 #include <memory>
 
+class Explicator_Query;
+
 void Explicator_Module_Double_Metaphone_Init(const std::map<std::string, std::string> &, float threshold);
 
 std::unique_ptr<std::map<std::string, float> >
@@ -15,3 +17,34 @@ Explicator_Module_Double_Metaphone_Query(const std::map<std::string, std::string
                                          float threshold);
 
 void Explicator_Module_Double_Metaphone_Deinit(void);
+
+std::shared_ptr<const void>
+Explicator_Module_Double_Metaphone_Build(const std::map<std::string, std::string> &, float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Double_Metaphone_Query_State(const void *state,
+                                               const std::map<std::string, std::string> &,
+                                               const std::string &,
+                                               float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Double_Metaphone_Query_V2(const void *state,
+                                            const std::map<std::string, std::string> &,
+                                            const Explicator_Query &,
+                                            float threshold);
+
+void Explicator_Module_Double_Metaphone_Add(const std::map<std::string, std::string> &,
+                                            const std::string &dirty,
+                                            const std::string &clean);
+void Explicator_Module_Double_Metaphone_Remove(const std::map<std::string, std::string> &,
+                                               const std::string &dirty,
+                                               const std::string &clean);
+std::shared_ptr<const void> Explicator_Module_Double_Metaphone_Add_State(const std::shared_ptr<const void> &state,
+                                                                         const std::map<std::string, std::string> &,
+                                                                         const std::string &dirty,
+                                                                         const std::string &clean);
+std::shared_ptr<const void>
+Explicator_Module_Double_Metaphone_Remove_State(const std::shared_ptr<const void> &state,
+                                                const std::map<std::string, std::string> &,
+                                                const std::string &dirty,
+                                                const std::string &clean);
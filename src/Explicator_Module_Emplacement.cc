@@ -4,16 +4,18 @@
 //
 
 #include <stddef.h>
-#include <algorithm> //Needed for set_intersection(..);
-#include <iterator>
+#include <stdint.h>
+#include <array>
 #include <map>
 #include <memory>
-#include <set>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
-#include "Misc.h"   //Needed for FUNCEXPLICATORINFO, FUNCEXPLICATORERR, etc..
+#include "Explicator_Query.h"
+#include "Misc.h"   //Needed for FUNCEXPLICATORINFO, FUNCEXPLICATORERR, EXPLICATORPOPCOUNT, etc..
+#include "Snapshot.h"
 #include "String.h" //Needed for Canonicalization().
 
 using namespace explicator_internals;
@@ -26,92 +28,141 @@ using namespace explicator_internals;
 //----------------------------------------------------------------------------------------------------------------
 //#define EXPLICATOR_OPTION_B
 
-static std::vector<std::pair<std::string, std::set<std::string>>> lexicon_emplacements;
+// The set of emplacements (ordered pairs of relevant characters, lhs appearing somewhere before rhs) is stored as a
+// bit matrix. Bit (rhs * N + lhs) is set if the pair is present, where N is the number of relevant characters (at most
+// 26). The matrix is packed into 64-bit words so that set operations reduce to a handful of bitwise ops and popcounts.
+static const size_t Max_Relevant      = 26;
+static const size_t Emplacement_Words = (Max_Relevant * Max_Relevant + 63) / 64;
+typedef std::array<uint64_t, Emplacement_Words> emplacement_mat;
+
 static const std::string
     Most_Freq_English("eainorstldumcphgkvbfzywjqx"); // Most frequent first. [e-t] comprises 63% of character frequency.
 static const std::string Least_Freq_English("xqjwyzfbvkghpcmudltsroniae"); // Most frequent last.
-static std::string Relevant; // This holds the list of characters we will consider.
+static std::array<int8_t, 256> Make_Empty_Relevant_Index(void) {
+    std::array<int8_t, 256> out;
+    out.fill(-1);
+    return out;
+}
+
+struct emplacement_state {
+    std::vector<std::pair<std::string, emplacement_mat>> lexicon_emplacements;
+    std::string Relevant; // This holds the list of characters we will consider.
+    std::array<int8_t, 256> Relevant_Index
+        = Make_Empty_Relevant_Index(); // Position of each character within Relevant, or -1 if not relevant.
 #ifdef EXPLICATOR_OPTION_B
-static float largestsetsize; // Used to compute theoworst.
+    float largestsetsize = 0.0; // Used to compute theoworst.
 #endif
+};
 
-std::set<std::string> Emplacement(const std::string &thestring) {
-    std::set<std::string> output;
-
-    // Trim ALL whitespace, leaving a single, long sequence of letters.
-    const std::string nowhitespace = Canonicalize_String2(thestring, CANONICALIZE::TRIM_ALL);
-
-    // Now cycle through the characters, pushing back those pairs that define the placement of characters.
-    for(size_t rhs = 0; rhs < nowhitespace.size(); ++rhs) {
-        // Check if rhs_it is in the string of relevant characters.
-        if((Relevant.find(nowhitespace[rhs]) != std::string::npos)) {
-            for(size_t lhs = 0; lhs < rhs; ++lhs) {
-                // Check if lhs_it is in the string of relevant characters.
-                if((Relevant.find(nowhitespace[lhs]) != std::string::npos)) {
-                    std::string temp;
-                    temp.push_back(nowhitespace[lhs]);
-                    temp.push_back(nowhitespace[rhs]);
-                    output.insert(temp);
-                }
-            }
-        }
-    }
-    return output;
+static std::shared_ptr<emplacement_state> current_state = std::make_shared<emplacement_state>();
+
+static long int Emplacement_Count(const emplacement_mat &A) {
+    long int n = 0;
+    for(const auto w : A) n += EXPLICATORPOPCOUNT(w);
+    return n;
 }
 
-std::set<std::string> Emplacement_Matches(const std::set<std::string> &A, const std::set<std::string> &B) {
-    std::set<std::string> output;
-    std::set_intersection(A.cbegin(), A.cend(), B.cbegin(), B.cend(), std::inserter(output, output.begin()));
-    return output;
+// Counts the emplacements present in B but absent from A.
+static long int Emplacement_Count_Extra(const emplacement_mat &A, const emplacement_mat &B) {
+    long int n = 0;
+    for(size_t i = 0; i < Emplacement_Words; ++i) n += EXPLICATORPOPCOUNT(B[i] & ~A[i]);
+    return n;
 }
 
-std::set<std::string> Emplacement_Differences(const std::set<std::string> &A, const std::set<std::string> &B) {
-    std::set<std::string> output;
-    std::set_symmetric_difference(A.cbegin(), A.cend(), B.cbegin(), B.cend(), std::inserter(output, output.begin()));
+static emplacement_mat Emplacement(const emplacement_state &state, const std::string &thestring) {
+    emplacement_mat output{};
+    const auto &Relevant_Index = state.Relevant_Index;
+    const auto N               = static_cast<uint64_t>(EXPLICATORMIN(state.Relevant.size(), Max_Relevant));
+
+    // Cycle through the characters, recording the pairs that define the placement of characters. A running mask of
+    // the relevant characters seen so far provides all the lhs characters for each rhs character at once. Whitespace
+    // is not relevant, so it is simply skipped.
+    uint64_t seen = 0;
+    for(const char c : thestring) {
+        const int8_t rhs = Relevant_Index[static_cast<unsigned char>(c)];
+        if(rhs < 0) continue;
+
+        const uint64_t bit   = static_cast<uint64_t>(rhs) * N;
+        const uint64_t word  = bit / 64;
+        const uint64_t shift = bit % 64;
+        output[word] |= (seen << shift);
+        if((shift != 0) && (word + 1 < Emplacement_Words)) {
+            output[word + 1] |= (seen >> (64 - shift));
+        }
+        seen |= (static_cast<uint64_t>(1) << rhs);
+    }
     return output;
 }
 
-// Initializor function.
-void Explicator_Module_Emplacement_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+// Selects the relevant characters. This does not depend on the lexicon.
+static void Select_Relevant(emplacement_state &state) {
     // Choose which characters are considered 'relevant.' Choosing overly popular characters waters down the
-    // efficiency (large amounts of memory used,) and choosing overtly obscure characters waters down the
+    // efficiency (more pairs to consider,) and choosing overtly obscure characters waters down the
     // efficacy (matches all words without 'q' and 'z', for example.)
 
     // Least_Freq_English.substr(0,18) --> [x-l] --> 37% of all characters in (standard) English.
     // Relevant = Least_Freq_English.substr(0,18);
 
-    // Alternatively, use ALL characters. This will produce more (many more) items, and will thus
-    // be very slow (and hard on memory.) Being more selective (including as many characters as possible
-    // seems to work better, though!
-    Relevant = Canonicalize_String2(Least_Freq_English, CANONICALIZE::TO_UPPER);
+    // Alternatively, use ALL characters. This used to be slow and hard on memory, but since the emplacements are now
+    // stored as a fixed-size bit matrix, there is no real cost. Being more selective (including as many characters as
+    // possible seems to work better, though!
+    state.Relevant = Canonicalize_String2(Least_Freq_English, CANONICALIZE::TO_UPPER);
+    state.Relevant_Index.fill(-1);
+    for(size_t i = 0; (i < state.Relevant.size()) && (i < Max_Relevant); ++i) {
+        state.Relevant_Index[static_cast<unsigned char>(state.Relevant[i])] = static_cast<int8_t>(i);
+    }
+}
+
+#ifdef EXPLICATOR_OPTION_B
+static void Find_Largest_Set_Size(emplacement_state &state) {
+    // Determine the largest set size for theoretical maximum score.
+    state.largestsetsize = 0.0;
+    for(auto it = state.lexicon_emplacements.begin(); it != state.lexicon_emplacements.end(); ++it) {
+        const float setsize = static_cast<float>(Emplacement_Count(it->second));
+        if(setsize > state.largestsetsize)
+            state.largestsetsize = setsize;
+    }
+}
+#endif
+
+static std::shared_ptr<emplacement_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    auto state = std::make_shared<emplacement_state>();
+    Select_Relevant(*state);
 
     // Cycle through the lexicon and generate emplacements for each 'dirty' string.
-    lexicon_emplacements.clear();
+    state->lexicon_emplacements.reserve(lexicon.size());
     for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
-        const auto theset = Emplacement(it->first);
-        lexicon_emplacements.push_back(std::pair<std::string, std::set<std::string>>(it->second, theset));
+        state->lexicon_emplacements.emplace_back(it->second, Emplacement(*state, it->first));
     }
 
 #ifdef EXPLICATOR_OPTION_B
-    // Determine the largest set size for theoretical maximum score.
-    largestsetsize = 0.0;
-    for(auto it = lexicon_emplacements.begin(); it != lexicon_emplacements.end(); ++it) {
-        const float setsize = static_cast<float>(it->second.size());
-        if(setsize > largestsetsize)
-            largestsetsize = setsize;
-    }
+    Find_Largest_Set_Size(*state);
 #endif
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_Emplacement_Build(const std::map<std::string, std::string> &lexicon,
+                                                                float threshold) {
+    return Build_State(lexicon);
+}
+
+// Initializor function.
+void Explicator_Module_Emplacement_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
 }
 
-// Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_Emplacement_Query(const std::map<std::string, std::string> &lexicon,
-                                    const std::string &in,
-                                    float threshold) {
+Explicator_Module_Emplacement_Query_V2(const void *state,
+                                       const std::map<std::string, std::string> &lexicon,
+                                       const Explicator_Query &q,
+                                       float threshold) {
+    if(state == nullptr) state = current_state.get();
     std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
-    const std::set<std::string> in_emplacements = Emplacement(in);
+    const auto &S                         = *static_cast<const emplacement_state *>(state);
+    const emplacement_mat in_emplacements = Emplacement(S, q.Text());
+    const long int in_count                = Emplacement_Count(in_emplacements);
 
-    if(in_emplacements.size() == 0) {
+    if(in_count == 0) {
         // This is not really so much of a problem. Often - it just means we have a highly selective criteria or a short
         // string.
         // Since we precompute the emplacements, it would be a pain to switch to a more lax criteria on-the-fly. It is
@@ -123,9 +174,9 @@ Explicator_Module_Emplacement_Query(const std::map<std::string, std::string> &le
     const float theoperfect = 0.0;
 
 #ifndef EXPLICATOR_OPTION_B
-    const float theoworst = static_cast<float>(in_emplacements.size()); // Size of the set produced by incoming string.
+    const float theoworst = static_cast<float>(in_count); // Size of the set produced by incoming string.
 #else
-    const float theoworst = largestsetsize; // Size of the largest set.
+    const float theoworst = S.largestsetsize; // Size of the largest set.
 #endif
 
     if(theoworst <= theoperfect) {
@@ -135,32 +186,31 @@ Explicator_Module_Emplacement_Query(const std::map<std::string, std::string> &le
 
     auto deviations_to_score = [=](float x) -> float { return 1.0 - ((x - theoperfect) / (theoworst - theoperfect)); };
 
-    // std::vector<std::pair<std::string, std::set<std::string>>> lexicon_emplacements;
-    for(auto it = lexicon_emplacements.begin(); it != lexicon_emplacements.end(); ++it) {
-        const std::string clean(it->first);
+    size_t scanned = 0;
+    for(auto it = S.lexicon_emplacements.begin(); it != S.lexicon_emplacements.end(); ++it) {
+        if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+        const std::string &clean = it->first;
         // We want to find the number of explicit deviations in the input from those in the lexicon.
         // This does NOT count simple absenses. It only counts the presence of previously unseen emplacements.
         //    deviationcount =  INTERSECTION( DIFF( SET(lexicon string), SET(input string) ), SET(input string) )'s
         //    size;
         //                   =  INTERSECTION( DIFF( A                  , B                 ), B                 )'s
         //                   size;
-        //                   =  INTERSECTION( C                                             , B                 )'s
-        //                   size;
-        //                   =  D's size;
-        const std::set<std::string> A = it->second;
-        const std::set<std::string> B = in_emplacements;
-        const std::set<std::string> C = Emplacement_Differences(A, B);
+        //                   =  | B \ A |
+        //                   =  popcount( B & ~A );
+        const emplacement_mat &A = it->second;
+        const emplacement_mat &B = in_emplacements;
 
 #ifndef EXPLICATOR_OPTION_B
         // OPTION A: Gives us the extra pieces from the *query* (good if query is an abbreviation of lexicon string.)
-        const std::set<std::string> D = Emplacement_Matches(C, B);
+        const long int D = Emplacement_Count_Extra(A, B);
 #else
         // OPTION B: Gives us the extra pieces from the *lexicon string* (good if lexicon string is an abbreviation of
         // query string.)
-        const std::set<std::string> D = Emplacement_Matches(C, A);
+        const long int D = Emplacement_Count_Extra(B, A);
 #endif
 
-        const float deviationcount = static_cast<float>(D.size());
+        const float deviationcount = static_cast<float>(D);
         const float score = deviations_to_score(deviationcount); // Score = 1.0 is perfect, score = 0.0 is no match.
         if((score > threshold)
            && (!(output->find(clean) != output->end())
@@ -174,11 +224,111 @@ Explicator_Module_Emplacement_Query(const std::map<std::string, std::string> &le
     return output;
 }
 
-// De-initializor function. Ensure this function can be called both after AND before the init function.
-void Explicator_Module_Emplacement_Deinit(void) {
-    lexicon_emplacements.clear();
-    Relevant.clear();
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Emplacement_Query_State(const void *state,
+                                          const std::map<std::string, std::string> &lexicon,
+                                          const std::string &in,
+                                          float threshold) {
+    return Explicator_Module_Emplacement_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+// Query function.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Emplacement_Query(const std::map<std::string, std::string> &lexicon,
+                                    const std::string &in,
+                                    float threshold) {
+    return Explicator_Module_Emplacement_Query_State(current_state.get(), lexicon, in, threshold);
+}
+
+// Snapshot functions.
+void Explicator_Module_Emplacement_Save(std::string &state) {
+    Snapshot_Writer w;
+    w.Put_String(current_state->Relevant);
+    w.Put(static_cast<uint64_t>(current_state->lexicon_emplacements.size()));
+    for(const auto &e : current_state->lexicon_emplacements) {
+        w.Put_String(e.first);
+        w.Put(e.second);
+    }
+    state = std::move(w.blob);
+}
+
+void Explicator_Module_Emplacement_Load(const std::string &state) {
+    Snapshot_Reader r(state);
+    auto loaded = std::make_shared<emplacement_state>();
+    Select_Relevant(*loaded);
+    if(r.Get_String() != loaded->Relevant) throw std::runtime_error("Snapshot relevant characters do not match");
+    loaded->lexicon_emplacements.resize(r.Get_Count(sizeof(uint64_t) + sizeof(emplacement_mat)));
+    for(auto &e : loaded->lexicon_emplacements) {
+        e.first  = r.Get_String();
+        e.second = r.Get<emplacement_mat>();
+    }
+#ifdef EXPLICATOR_OPTION_B
+    Find_Largest_Set_Size(*loaded);
+#endif
+    current_state = loaded;
+}
+
+// Incremental lexicon edits. Entries are unordered, so edits append or swap-remove.
+static void Add_To_State(emplacement_state &S,
+                         const std::map<std::string, std::string> &lexicon,
+                         const std::string &dirty,
+                         const std::string &clean) {
+    S.lexicon_emplacements.emplace_back(clean, Emplacement(S, dirty));
 #ifdef EXPLICATOR_OPTION_B
-    largestsetsize = 0.0;
+    Find_Largest_Set_Size(S);
 #endif
 }
+
+static void Remove_From_State(emplacement_state &S,
+                              const std::map<std::string, std::string> &lexicon,
+                              const std::string &dirty,
+                              const std::string &clean) {
+    // Entries with the same clean and emplacements are interchangeable, so any one of them can be removed.
+    const auto dirty_mat = Emplacement(S, dirty);
+    for(auto it = S.lexicon_emplacements.begin(); it != S.lexicon_emplacements.end(); ++it) {
+        if((it->first == clean) && (it->second == dirty_mat)) {
+            *it = std::move(S.lexicon_emplacements.back());
+            S.lexicon_emplacements.pop_back();
+            break;
+        }
+    }
+#ifdef EXPLICATOR_OPTION_B
+    Find_Largest_Set_Size(S);
+#endif
+}
+
+void Explicator_Module_Emplacement_Add(const std::map<std::string, std::string> &lexicon,
+                                       const std::string &dirty,
+                                       const std::string &clean) {
+    Add_To_State(*current_state, lexicon, dirty, clean);
+}
+
+void Explicator_Module_Emplacement_Remove(const std::map<std::string, std::string> &lexicon,
+                                          const std::string &dirty,
+                                          const std::string &clean) {
+    Remove_From_State(*current_state, lexicon, dirty, clean);
+}
+
+std::shared_ptr<const void> Explicator_Module_Emplacement_Add_State(const std::shared_ptr<const void> &state,
+                                                                    const std::map<std::string, std::string> &lexicon,
+                                                                    const std::string &dirty,
+                                                                    const std::string &clean) {
+    auto S = std::make_shared<emplacement_state>(*static_cast<const emplacement_state *>(state.get()));
+    Add_To_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_Emplacement_Remove_State(const std::shared_ptr<const void> &state,
+                                           const std::map<std::string, std::string> &lexicon,
+                                           const std::string &dirty,
+                                           const std::string &clean) {
+    auto S = std::make_shared<emplacement_state>(*static_cast<const emplacement_state *>(state.get()));
+    Remove_From_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
+// De-initializor function. Ensure this function can be called both after AND before the init function.
+void Explicator_Module_Emplacement_Deinit(void) {
+    current_state = std::make_shared<emplacement_state>();
+}
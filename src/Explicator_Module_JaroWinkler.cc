@@ -3,11 +3,16 @@
 
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Explicator_Query.h"
 #include "Misc.h"
+#include "Snapshot.h"
+
+using namespace explicator_internals;
 
 #define NOTNUM(c) (((c) > 57) || ((c) < 48))
 #define INRANGE(c) (((c) > 0) && ((c) < 91))
@@ -116,29 +121,147 @@ double JaroWinkler(const std::string &A, const std::string &B) {
     return out;
 }
 
+struct jarowinkler_state {
+    Clean_Families<Clean_Family_Entry> families;
+};
+
+static std::shared_ptr<jarowinkler_state> current_state = std::make_shared<jarowinkler_state>();
+
+static std::shared_ptr<jarowinkler_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    auto state      = std::make_shared<jarowinkler_state>();
+    state->families = Clean_Families<Clean_Family_Entry>(lexicon);
+    return state;
+}
+
+// An upper bound on the score of a string of the given length, sharing at most 'common' characters with the query and
+// at most 'prefix' leading characters. At most all shared characters are common (and none transposed), and the prefix
+// adjustment closes at most 10% of the remaining gap per shared leading character.
+static float JaroWinkler_Bound(double A_len, double B_len, double common, double prefix) {
+    common          = EXPLICATORMIN(common, B_len);
+    const auto jaro = (common / A_len + common / B_len + 1.0) / 3.0;
+    return static_cast<float>(jaro + 0.1 * EXPLICATORMIN(prefix, 4.0) * (1.0 - jaro) + 1.0E-6);
+}
+
 void Explicator_Module_JaroWinkler_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
     return;
 }
 
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_JaroWinkler_Query(const std::map<std::string, std::string> &lexicon,
-                                    const std::string &in,
-                                    float threshold) {
+Explicator_Module_JaroWinkler_Query_V2(const void *state,
+                                       const std::map<std::string, std::string> &lexicon,
+                                       const Explicator_Query &q,
+                                       float threshold) {
+    if(state == nullptr) state = current_state.get();
     // Remember: The lexicon looks like: < dirty : clean >
-    std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
+    Top_K_Cleans best(q.Top_K(), threshold);
+    const auto &in = q.Text();
+    const auto &S  = *static_cast<const jarowinkler_state *>(state);
 
-    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
-        const float score = static_cast<float>(JaroWinkler(it->first, in));
+    // Only the query characters which appear in some dirty string of a clean can be common to it, and only the leading
+    // characters shared by all of them can count towards the prefix adjustment. The bound is highest for dirty strings
+    // as long as the number of such characters, so only those with lengths near it which could score well enough to be
+    // kept are visited, and whole families are skipped if none could.
+    size_t scanned = 0;
+    for(const auto &f : S.families) {
+        if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+        if(!q.Is_Candidate(f.clean)) continue;
 
-        if(score > threshold) { // If not present, insert it. If present, keep highest score.
-            if(!(output->find(it->second) != output->end()) || ((*output)[it->second] < score)) {
-                (*output)[it->second] = score;
-            }
+        const bool bounded = !in.empty() && (f.summary.min_length != 0);
+        const auto A_len   = static_cast<double>(in.size());
+        const auto present = in.size() - f.summary.Absent_Count(in);
+        const auto prefix  = static_cast<double>(f.summary.Shared_Prefix_Bound(in));
+
+        const auto could_keep = [&](size_t length) -> bool {
+            const auto B_len = static_cast<double>(length);
+            return !bounded || best.Could_Keep(JaroWinkler_Bound(A_len, B_len, static_cast<double>(present), prefix));
+        };
+        if(!could_keep(f.summary.Nearest_Length(present))) continue;
+
+        const auto window = f.Feasible_Window(present, could_keep);
+        for(auto e_it = window.first; e_it != window.second; ++e_it) {
+            if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+            if(!could_keep(e_it->dirty.size())) continue;
+
+            // If not present, insert it. If present, keep highest score.
+            const auto score = static_cast<float>(JaroWinkler(e_it->dirty, in));
+            best.Insert(f.clean, score);
+            if(1.0F <= score) break; // No other dirty string of the family can score higher.
         }
+        if(q.Interrupted()) break;
     }
-    return output;
+    return best.Release();
+}
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_JaroWinkler_Query(const std::map<std::string, std::string> &lexicon,
+                                    const std::string &in,
+                                    float threshold) {
+    return Explicator_Module_JaroWinkler_Query_V2(current_state.get(), lexicon, Explicator_Query(in), threshold);
 }
 
 void Explicator_Module_JaroWinkler_Deinit(void) {
+    current_state = std::make_shared<jarowinkler_state>();
     return;
 }
+
+// Stateful variants.
+std::shared_ptr<const void> Explicator_Module_JaroWinkler_Build(const std::map<std::string, std::string> &lexicon,
+                                                                float threshold) {
+    return Build_State(lexicon);
+}
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_JaroWinkler_Query_State(const void *state,
+                                          const std::map<std::string, std::string> &lexicon,
+                                          const std::string &in,
+                                          float threshold) {
+    return Explicator_Module_JaroWinkler_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+void Explicator_Module_JaroWinkler_Save(std::string &state) {
+    Snapshot_Writer w;
+    current_state->families.Save(w);
+    state = std::move(w.blob);
+}
+
+void Explicator_Module_JaroWinkler_Load(const std::string &state) {
+    Snapshot_Reader r(state);
+    auto loaded      = std::make_shared<jarowinkler_state>();
+    loaded->families = Clean_Families<Clean_Family_Entry>::Load(r);
+    current_state    = loaded;
+}
+
+// Incremental lexicon edits.
+void Explicator_Module_JaroWinkler_Add(const std::map<std::string, std::string> &lexicon,
+                                       const std::string &dirty,
+                                       const std::string &clean) {
+    current_state->families.Add(dirty, clean);
+    return;
+}
+
+void Explicator_Module_JaroWinkler_Remove(const std::map<std::string, std::string> &lexicon,
+                                          const std::string &dirty,
+                                          const std::string &clean) {
+    current_state->families.Remove(dirty, clean);
+    return;
+}
+
+std::shared_ptr<const void> Explicator_Module_JaroWinkler_Add_State(const std::shared_ptr<const void> &state,
+                                                                    const std::map<std::string, std::string> &lexicon,
+                                                                    const std::string &dirty,
+                                                                    const std::string &clean) {
+    auto S = std::make_shared<jarowinkler_state>(*static_cast<const jarowinkler_state *>(state.get()));
+    S->families.Add(dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_JaroWinkler_Remove_State(const std::shared_ptr<const void> &state,
+                                           const std::map<std::string, std::string> &lexicon,
+                                           const std::string &dirty,
+                                           const std::string &clean) {
+    auto S = std::make_shared<jarowinkler_state>(*static_cast<const jarowinkler_state *>(state.get()));
+    S->families.Remove(dirty, clean);
+    return S;
+}
@@ -5,21 +5,35 @@
 // first if something goes wrong.
 
 #include <algorithm> //Needed for min()
+#include <limits>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Explicator_Query.h"
 #include "Misc.h"
+#include "Snapshot.h"
 
-static float Longest_String_Length;
+using namespace explicator_internals;
+
+struct levenshtein_state {
+    float longest_string_length = 0.0; // The maximum (dirty) string length. Used to determine upper bound on score.
+    Clean_Families<Clean_Family_Entry> families;
+};
+
+static std::shared_ptr<levenshtein_state> current_state = std::make_shared<levenshtein_state>();
 
 // This was originally found online at http://www.merriampark.com/ldcpp.htm on May 27th 2012. The title and author are:
 // "Levenshtein Distance Algorithm: C++ Implementation" by Anders Sewerin Johansen. There is no copyright information
 // explicitly stated (which I could find). I believe the present usage is allowed as fair use. Some modifications
 // have been made and it is not a verbatim copy.
-int Levenshtein_Damerau_Dist(const std::string &source, const std::string &target) {
+// If the distance exceeds 'bound', computation may stop early and some distance exceeding 'bound' is returned.
+int Levenshtein_Damerau_Dist(const std::string &source,
+                             const std::string &target,
+                             int bound = std::numeric_limits<int>::max()) {
     const int n(source.length()), m(target.length());
     if(n == 0) {
         return m;
@@ -34,8 +48,12 @@ int Levenshtein_Damerau_Dist(const std::string &source, const std::string &targe
     for(int i = 0; i <= n; ++i) { matrix[i][0] = i; }
     for(int j = 0; j <= m; ++j) { matrix[0][j] = j; }
 
+    // Every cell is derived from the previous two rows, so once both rows exceed the bound (the older by at least the
+    // cost of a transposition) so will every later row.
+    int prev_row_min = 0;
     for(int i = 1; i <= n; ++i) {
         const char s_i(source[i - 1]);
+        int row_min = matrix[i][0];
         for(int j = 1; j <= m; ++j) {
             const char t_j = target[j - 1];
             const int cost((s_i == t_j) ? 0 : 1);
@@ -61,29 +79,51 @@ int Levenshtein_Damerau_Dist(const std::string &source, const std::string &targe
                 }
             }
             matrix[i][j] = cell;
+            if(cell < row_min) row_min = cell;
         }
+        if((bound < row_min) && (bound <= prev_row_min)) return row_min;
+        prev_row_min = row_min;
     }
     return matrix[n][m];
 }
 
-// Initializor function.
-void Explicator_Module_Levenshtein_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+static std::shared_ptr<levenshtein_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    auto state      = std::make_shared<levenshtein_state>();
+    state->families = Clean_Families<Clean_Family_Entry>(lexicon);
+
     // Determine the maximum (dirty) string length. This is used to determine upper bound on score.
     auto string_length_comp
         = [](const std::pair<std::string, std::string> &A, const std::pair<std::string, std::string> &B) -> bool {
         return A.first.size() < B.first.size();
     };
-    Longest_String_Length
-        = static_cast<float>((std::max_element(lexicon.begin(), lexicon.end(), string_length_comp))->first.size());
+    if(!lexicon.empty()) {
+        state->longest_string_length
+            = static_cast<float>((std::max_element(lexicon.begin(), lexicon.end(), string_length_comp))->first.size());
+    }
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_Levenshtein_Build(const std::map<std::string, std::string> &lexicon,
+                                                                float threshold) {
+    return Build_State(lexicon);
+}
+
+// Initializor function.
+void Explicator_Module_Levenshtein_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
 }
 
-// Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_Levenshtein_Query(const std::map<std::string, std::string> &lexicon,
-                                    const std::string &in,
-                                    float threshold) {
+Explicator_Module_Levenshtein_Query_V2(const void *state,
+                                       const std::map<std::string, std::string> &lexicon,
+                                       const Explicator_Query &q,
+                                       float threshold) {
+    if(state == nullptr) state = current_state.get();
+    const std::string &in = q.Text();
     // Remember: The lexicon looks like: < dirty : clean >
     std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
+    const auto &S                     = *static_cast<const levenshtein_state *>(state);
+    const float Longest_String_Length = S.longest_string_length;
 
     // I think this is the maximum theoretial distance, but am unsure. If it is not, then one will see negatives in the
     // score output!
@@ -102,25 +142,153 @@ Explicator_Module_Levenshtein_Query(const std::map<std::string, std::string> &le
         return output;
     }
 
+    // The largest distance which scores well enough to be kept, or -1 if there is none. Distances are at least the
+    // difference in string lengths, and the distance computation stops once this is exceeded.
+    Top_K_Cleans best(q.Top_K(), threshold);
+    const auto max_distance = [&](float cutoff) -> int {
+        int d = static_cast<int>(EXPLICATORMAX(0.0F, (1.0F - cutoff) * theomax)) + 2;
+        while((0 <= d) && !best.Could_Keep(normalize(static_cast<float>(d)))) --d;
+        return d;
+    };
+    float cutoff = best.Cutoff();
+    int max_dist = max_distance(cutoff);
+
     // First we push back each string and the Levenshtein distance. We are trying to minimize the distance for each
-    // element in the map.
-    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
-        const float levn_dist = static_cast<float>(Levenshtein_Damerau_Dist(it->first, in));
-        const float score     = normalize(levn_dist);
-
-        // If the input-dirty string distance is the shortest for this clean string (or it hasn't been injected into the
-        // map yet,) replace it.
-        if((score > threshold) && (!(output->find(it->second) != output->end()) || ((*output)[it->second] < score))) {
-            (*output)[it->second] = score;
-            // Levenshtein distance is exact. If we find an exact match, it is best to exit immediately.
-            if(levn_dist == 0.0) {
-                break;
+    // element in the map. Distances are at least the difference in string lengths, so only the dirty strings with
+    // lengths within the largest distance which could be kept of the query's are visited. Every dirty string of a clean
+    // also needs one edit for each query character which appears in none of them, so whole families can be skipped.
+    const auto length_diff = [&](size_t length) -> size_t {
+        return (length < in.size()) ? (in.size() - length) : (length - in.size());
+    };
+    size_t scanned = 0;
+    bool exact     = false;
+    for(const auto &f : S.families) {
+        if(exact) break;
+        if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+        if(!q.Is_Candidate(f.clean)) continue;
+        if(cutoff != best.Cutoff()) {
+            cutoff   = best.Cutoff();
+            max_dist = max_distance(cutoff);
+        }
+        if(max_dist < 0) break;
+
+        const auto family_min_dist = static_cast<int>(
+            EXPLICATORMAX(length_diff(f.summary.Nearest_Length(in.size())), f.summary.Absent_Count(in)));
+        if(max_dist < family_min_dist) continue;
+
+        const auto window = f.Feasible_Window(in.size(), [&](size_t length) -> bool {
+            return length_diff(length) <= static_cast<size_t>(max_dist);
+        });
+        for(auto e_it = window.first; e_it != window.second; ++e_it) {
+            if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+            if(cutoff != best.Cutoff()) {
+                cutoff   = best.Cutoff();
+                max_dist = max_distance(cutoff);
             }
+            if(max_dist < family_min_dist) break;
+            if(static_cast<size_t>(max_dist) < length_diff(e_it->dirty.size())) continue;
+
+            const int dist = Levenshtein_Damerau_Dist(e_it->dirty, in, max_dist);
+            if(max_dist < dist) continue;
+
+            // If the input-dirty string distance is the shortest for this clean string (or it hasn't been injected into
+            // the map yet,) replace it.
+            const float levn_dist = static_cast<float>(dist);
+            best.Insert(f.clean, normalize(levn_dist));
+
+            // Levenshtein distance is exact. If we find an exact match, it is best to exit immediately.
+            exact = (levn_dist == 0.0);
+
+            // No other dirty string of the family can be any closer.
+            if(dist <= family_min_dist) break;
         }
+        if(q.Interrupted()) break;
     }
-    return output;
+    return best.Release();
+}
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Levenshtein_Query_State(const void *state,
+                                          const std::map<std::string, std::string> &lexicon,
+                                          const std::string &in,
+                                          float threshold) {
+    return Explicator_Module_Levenshtein_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+// Query function.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Levenshtein_Query(const std::map<std::string, std::string> &lexicon,
+                                    const std::string &in,
+                                    float threshold) {
+    return Explicator_Module_Levenshtein_Query_State(current_state.get(), lexicon, in, threshold);
+}
+
+void Explicator_Module_Levenshtein_Save(std::string &state) {
+    Snapshot_Writer w;
+    w.Put(current_state->longest_string_length);
+    current_state->families.Save(w);
+    state = std::move(w.blob);
+}
+
+void Explicator_Module_Levenshtein_Load(const std::string &state) {
+    Snapshot_Reader r(state);
+    auto loaded                   = std::make_shared<levenshtein_state>();
+    loaded->longest_string_length = r.Get<float>();
+    loaded->families              = Clean_Families<Clean_Family_Entry>::Load(r);
+    current_state                 = loaded;
+}
+
+// Incremental lexicon edits.
+static void Add_To_State(levenshtein_state &S, const std::string &dirty, const std::string &clean) {
+    const auto length = static_cast<float>(dirty.size());
+    if(S.longest_string_length < length) S.longest_string_length = length;
+    S.families.Add(dirty, clean);
+}
+
+static void Remove_From_State(std::shared_ptr<levenshtein_state> &S,
+                              const std::map<std::string, std::string> &lexicon,
+                              const std::string &dirty,
+                              const std::string &clean) {
+    // Only removing the longest dirty string can change the bound.
+    if(S->longest_string_length <= static_cast<float>(dirty.size())) {
+        S = Build_State(lexicon);
+    } else {
+        S->families.Remove(dirty, clean);
+    }
+}
+
+void Explicator_Module_Levenshtein_Add(const std::map<std::string, std::string> &lexicon,
+                                       const std::string &dirty,
+                                       const std::string &clean) {
+    Add_To_State(*current_state, dirty, clean);
+}
+
+void Explicator_Module_Levenshtein_Remove(const std::map<std::string, std::string> &lexicon,
+                                          const std::string &dirty,
+                                          const std::string &clean) {
+    Remove_From_State(current_state, lexicon, dirty, clean);
+}
+
+std::shared_ptr<const void> Explicator_Module_Levenshtein_Add_State(const std::shared_ptr<const void> &state,
+                                                                    const std::map<std::string, std::string> &lexicon,
+                                                                    const std::string &dirty,
+                                                                    const std::string &clean) {
+    auto S = std::make_shared<levenshtein_state>(*static_cast<const levenshtein_state *>(state.get()));
+    Add_To_State(*S, dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_Levenshtein_Remove_State(const std::shared_ptr<const void> &state,
+                                           const std::map<std::string, std::string> &lexicon,
+                                           const std::string &dirty,
+                                           const std::string &clean) {
+    auto S = std::make_shared<levenshtein_state>(*static_cast<const levenshtein_state *>(state.get()));
+    Remove_From_State(S, lexicon, dirty, clean);
+    return S;
 }
 
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_Levenshtein_Deinit(void) {
+    current_state = std::make_shared<levenshtein_state>();
 }
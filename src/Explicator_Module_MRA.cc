@@ -16,6 +16,7 @@
 #include <string>
 #include <utility>
 
+#include "Explicator_Query.h"
 #include "Misc.h"
 #include "String.h"
 
@@ -72,13 +73,18 @@ void Explicator_Module_MRA_Init(const std::map<std::string, std::string> &lexico
 
 // Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_MRA_Query(const std::map<std::string, std::string> &lexicon, const std::string &in, float threshold) {
+Explicator_Module_MRA_Query_V2(const void *state,
+                               const std::map<std::string, std::string> &lexicon,
+                               const Explicator_Query &q,
+                               float threshold) {
     // Reminder: The lexicon looks like: < dirty : clean >
     std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
-    const auto mra_in = MatchRatingApproach(in);
+    const auto mra_in = q.Key(MatchRatingApproach);
 
     // Cycle through the lexicon, computing the MRA of each item. Compare it to that of the input.
+    size_t scanned = 0;
     for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
+        if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
         const auto mra_lex = MatchRatingApproach(it->first);
 
         const auto dlength = EXPLICATORABS(static_cast<long int>(mra_lex.size()) - static_cast<long int>(mra_in.size()));
@@ -146,7 +152,56 @@ Explicator_Module_MRA_Query(const std::map<std::string, std::string> &lexicon, c
     return output;
 }
 
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_MRA_Query(const std::map<std::string, std::string> &lexicon,
+                            const std::string &in,
+                            float threshold) {
+    return Explicator_Module_MRA_Query_V2(nullptr, lexicon, Explicator_Query(in), threshold);
+}
+
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_MRA_Deinit(void) {
     return;
 }
+
+// Stateful variants. This module has no state, so they simply defer to the functions above.
+std::shared_ptr<const void> Explicator_Module_MRA_Build(const std::map<std::string, std::string> &lexicon,
+                                                        float threshold) {
+    return nullptr;
+}
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_MRA_Query_State(const void *state,
+                                  const std::map<std::string, std::string> &lexicon,
+                                  const std::string &in,
+                                  float threshold) {
+    return Explicator_Module_MRA_Query(lexicon, in, threshold);
+}
+
+// Incremental lexicon edits. This module has no state, so there is nothing to update.
+void Explicator_Module_MRA_Add(const std::map<std::string, std::string> &lexicon,
+                               const std::string &dirty,
+                               const std::string &clean) {
+    return;
+}
+
+void Explicator_Module_MRA_Remove(const std::map<std::string, std::string> &lexicon,
+                                  const std::string &dirty,
+                                  const std::string &clean) {
+    return;
+}
+
+std::shared_ptr<const void> Explicator_Module_MRA_Add_State(const std::shared_ptr<const void> &state,
+                                                            const std::map<std::string, std::string> &lexicon,
+                                                            const std::string &dirty,
+                                                            const std::string &clean) {
+    return state;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_MRA_Remove_State(const std::shared_ptr<const void> &state,
+                                   const std::map<std::string, std::string> &lexicon,
+                                   const std::string &dirty,
+                                   const std::string &clean) {
+    return state;
+}
@@ -10,14 +10,19 @@
 // abbreviations is (probably) not very good. Longer input is probably more precise, but will
 // quickly consume memory.
 //
+// N-grams are stored as sorted, packed N-gram codes (see NGram_Code()) rather than strings.
+//
+#include <stdint.h>
 #include <map>
 #include <memory>
-#include <set>
+#include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "Explicator_Query.h"
 #include "Misc.h"
+#include "Snapshot.h"
 #include "String.h" //Needed for NGram functions.
 
 using namespace explicator_internals;
@@ -25,25 +30,41 @@ using namespace explicator_internals;
 // Choose the size of the N-grams. In this case, we compute N-(character)-grams.
 #define NGRAM_N 2
 
-static std::vector<std::pair<std::string, std::set<std::string>>> lexicon_ngrams;
+struct ngrams_state {
+    std::vector<std::pair<std::string, std::vector<uint64_t>>> lexicon_ngrams; // <clean, N-gram codes of the dirty>.
+};
 
-// Initializor function.
-void Explicator_Module_NGrams_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+static std::shared_ptr<ngrams_state> current_state = std::make_shared<ngrams_state>();
+
+static std::shared_ptr<ngrams_state> Build_State(const std::map<std::string, std::string> &lexicon) {
     // We cycle through the lexicon and generate all N-grams of each 'dirty' string.
-    lexicon_ngrams.clear();
+    auto state = std::make_shared<ngrams_state>();
     for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
-        lexicon_ngrams.push_back(
-            std::pair<std::string, std::set<std::string>>(it->second, NGrams(it->first, -1, NGRAM_N, NGRAMS::CHARS)));
+        state->lexicon_ngrams.push_back(
+            std::pair<std::string, std::vector<uint64_t>>(it->second, NGram_Codes(it->first, NGRAM_N, NGRAM_N)));
     }
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_NGrams_Build(const std::map<std::string, std::string> &lexicon,
+                                                           float threshold) {
+    return Build_State(lexicon);
+}
+
+// Initializor function.
+void Explicator_Module_NGrams_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
 }
 
-// Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_NGrams_Query(const std::map<std::string, std::string> &lexicon,
-                               const std::string &in,
-                               float threshold) {
+Explicator_Module_NGrams_Query_V2(const void *state,
+                                  const std::map<std::string, std::string> &lexicon,
+                                  const Explicator_Query &q,
+                                  float threshold) {
+    if(state == nullptr) state = current_state.get();
     std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
-    const std::set<std::string> in_ngrams = NGrams(in, -1, NGRAM_N, NGRAMS::CHARS);
+    const auto &lexicon_ngrams = static_cast<const ngrams_state *>(state)->lexicon_ngrams;
+    const std::vector<uint64_t> &in_ngrams = q.NGram_Codes(NGRAM_N, NGRAM_N);
 
     const float theoworst = 0.0;
     const float theobest  = static_cast<float>(in_ngrams.size()); // Maximum number of positive matches.
@@ -54,8 +75,10 @@ Explicator_Module_NGrams_Query(const std::map<std::string, std::string> &lexicon
     }
     auto matchcount_to_score = [=](float x) -> float { return ((x - theoworst) / (theobest - theoworst)); };
 
+    size_t scanned = 0;
     for(auto it = lexicon_ngrams.begin(); it != lexicon_ngrams.end(); ++it) {
-        const float matchcount = static_cast<float>(NGram_Match_Count(in_ngrams, it->second));
+        if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+        const float matchcount = static_cast<float>(NGram_Code_Match_Count(in_ngrams, it->second));
         const float score      = matchcount_to_score(matchcount);
 
         if((score > threshold) && (!(output->find(it->first) != output->end()) || ((*output)[it->first] < score))) {
@@ -68,8 +91,103 @@ Explicator_Module_NGrams_Query(const std::map<std::string, std::string> &lexicon
     return output;
 }
 
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_NGrams_Query_State(const void *state,
+                                     const std::map<std::string, std::string> &lexicon,
+                                     const std::string &in,
+                                     float threshold) {
+    return Explicator_Module_NGrams_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+// Query function.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_NGrams_Query(const std::map<std::string, std::string> &lexicon,
+                               const std::string &in,
+                               float threshold) {
+    return Explicator_Module_NGrams_Query_State(current_state.get(), lexicon, in, threshold);
+}
+
+// Snapshot functions.
+void Explicator_Module_NGrams_Save(std::string &state) {
+    Snapshot_Writer w;
+    w.Put(static_cast<uint64_t>(NGRAM_N));
+    w.Put(static_cast<uint64_t>(current_state->lexicon_ngrams.size()));
+    for(const auto &e : current_state->lexicon_ngrams) {
+        w.Put_String(e.first);
+        w.Put_Vector(e.second);
+    }
+    state = std::move(w.blob);
+}
+
+void Explicator_Module_NGrams_Load(const std::string &state) {
+    Snapshot_Reader r(state);
+    if(r.Get<uint64_t>() != NGRAM_N) throw std::runtime_error("Snapshot N-gram length does not match");
+    auto loaded = std::make_shared<ngrams_state>();
+    loaded->lexicon_ngrams.resize(r.Get_Count(2 * sizeof(uint64_t)));
+    for(auto &e : loaded->lexicon_ngrams) {
+        e.first  = r.Get_String();
+        e.second = r.Get_Vector<uint64_t>();
+    }
+    current_state = loaded;
+}
+
+// Incremental lexicon edits. Entries are unordered, so edits append or swap-remove.
+static void Add_To_State(ngrams_state &S,
+                         const std::map<std::string, std::string> &lexicon,
+                         const std::string &dirty,
+                         const std::string &clean) {
+    S.lexicon_ngrams.emplace_back(clean, NGram_Codes(dirty, NGRAM_N, NGRAM_N));
+}
+
+static void Remove_From_State(ngrams_state &S,
+                              const std::map<std::string, std::string> &lexicon,
+                              const std::string &dirty,
+                              const std::string &clean) {
+    // Entries with the same clean and N-grams are interchangeable, so any one of them can be removed.
+    auto &lexicon_ngrams = S.lexicon_ngrams;
+    const auto codes     = NGram_Codes(dirty, NGRAM_N, NGRAM_N);
+    for(auto it = lexicon_ngrams.begin(); it != lexicon_ngrams.end(); ++it) {
+        if((it->first == clean) && (it->second == codes)) {
+            *it = std::move(lexicon_ngrams.back());
+            lexicon_ngrams.pop_back();
+            return;
+        }
+    }
+}
+
+void Explicator_Module_NGrams_Add(const std::map<std::string, std::string> &lexicon,
+                                  const std::string &dirty,
+                                  const std::string &clean) {
+    Add_To_State(*current_state, lexicon, dirty, clean);
+}
+
+void Explicator_Module_NGrams_Remove(const std::map<std::string, std::string> &lexicon,
+                                     const std::string &dirty,
+                                     const std::string &clean) {
+    Remove_From_State(*current_state, lexicon, dirty, clean);
+}
+
+std::shared_ptr<const void> Explicator_Module_NGrams_Add_State(const std::shared_ptr<const void> &state,
+                                                               const std::map<std::string, std::string> &lexicon,
+                                                               const std::string &dirty,
+                                                               const std::string &clean) {
+    auto S = std::make_shared<ngrams_state>(*static_cast<const ngrams_state *>(state.get()));
+    Add_To_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_NGrams_Remove_State(const std::shared_ptr<const void> &state,
+                                      const std::map<std::string, std::string> &lexicon,
+                                      const std::string &dirty,
+                                      const std::string &clean) {
+    auto S = std::make_shared<ngrams_state>(*static_cast<const ngrams_state *>(state.get()));
+    Remove_From_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_NGrams_Deinit(void) {
-    lexicon_ngrams.clear();
+    current_state = std::make_shared<ngrams_state>();
     // Nothing to free!
 }
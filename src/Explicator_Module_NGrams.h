@@ -9,9 +9,45 @@
 #include <utility>
 #include <memory>
 
+class Explicator_Query;
+
 void Explicator_Module_NGrams_Init(const std::map<std::string, std::string> &, float threshold);
 
 std::unique_ptr<std::map<std::string, float> >
 Explicator_Module_NGrams_Query(const std::map<std::string, std::string> &, const std::string &, float threshold);
 
 void Explicator_Module_NGrams_Deinit(void);
+
+std::shared_ptr<const void>
+Explicator_Module_NGrams_Build(const std::map<std::string, std::string> &, float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_NGrams_Query_State(const void *state,
+                                     const std::map<std::string, std::string> &,
+                                     const std::string &,
+                                     float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_NGrams_Query_V2(const void *state,
+                                  const std::map<std::string, std::string> &,
+                                  const Explicator_Query &,
+                                  float threshold);
+
+void Explicator_Module_NGrams_Save(std::string &state);
+void Explicator_Module_NGrams_Load(const std::string &state);
+
+void Explicator_Module_NGrams_Add(const std::map<std::string, std::string> &,
+                                  const std::string &dirty,
+                                  const std::string &clean);
+void Explicator_Module_NGrams_Remove(const std::map<std::string, std::string> &,
+                                     const std::string &dirty,
+                                     const std::string &clean);
+std::shared_ptr<const void> Explicator_Module_NGrams_Add_State(const std::shared_ptr<const void> &state,
+                                                               const std::map<std::string, std::string> &,
+                                                               const std::string &dirty,
+                                                               const std::string &clean);
+std::shared_ptr<const void>
+Explicator_Module_NGrams_Remove_State(const std::shared_ptr<const void> &state,
+                                      const std::map<std::string, std::string> &,
+                                      const std::string &dirty,
+                                      const std::string &clean);
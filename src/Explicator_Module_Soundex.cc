@@ -8,22 +8,46 @@
 // One could likely be implemented, but it would be of limited value because Soundex
 // is (technically) supposed to address this point itself.
 //
-// NOTE: No attempt is made to speed up or pre-cache computations because the
-// algorithm was found to be somewhat unsuitable for my intended purpose. Feel free
-// to optimize if needed.
+// NOTE: Because the match is binary, the lexicon is indexed by Soundex code at initialization. A query then costs a
+// single encoding and a single hash table probe, regardless of the size of the lexicon.
 //
 
 #include <stddef.h>
+#include <stdint.h>
+#include <array>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
+#include "Explicator_Query.h"
 #include "String.h"
 
 using namespace explicator_internals;
 
-// Returns a string like 'R123' or 'A120' or '0000' holding the Soundex score.
+struct soundex_state {
+    std::unordered_map<uint32_t, std::set<std::string>> index; // Soundex code -> cleans.
+};
+
+static std::shared_ptr<soundex_state> current_state = std::make_shared<soundex_state>();
+
+// These are grouped into collections of ~similar sounding consonants. Vowels are dummies ('x') which are removed after
+// contraction (but not prior!) Note that 'H' and 'W' (and everything else) are excluded entirely, which is denoted by a
+// null.
+static constexpr std::array<char, 256> Make_Soundex_Table(void) {
+    std::array<char, 256> t{};
+    const char *groups[] = {"1BFPV", "2CGJKQSXZ", "3DT", "4L", "5MN", "6R", "xAEIOUY"};
+    for(const char *g : groups) {
+        for(const char *c = g + 1; *c != '\0'; ++c) { t[static_cast<unsigned char>(*c)] = g[0]; }
+    }
+    return t;
+}
+static constexpr std::array<char, 256> Soundex_Table = Make_Soundex_Table();
+
+// Returns the Soundex code packed into an integer, first character in the least significant byte. The input is treated
+// as if canonicalized with CANONICALIZE::TO_AZ | CANONICALIZE::TO_UPPER, but is streamed directly without any copies.
 //
 // NOTE: This is NOT a true Soundex because it does not exclude surname prefixes, such
 // as 'Van', 'De', 'La', etc.. These require TWO soundexes to be computed, and are
@@ -39,88 +63,181 @@ using namespace explicator_internals;
 //   Soundex("Jackson") should be J250
 //   Soundex("vanDousen") should be TWO SEPARATE SOUNDEXS! (Not handled here!)
 //
-std::string Soundex(const std::string &in) {
-    std::map<char, char> Soundex_Equivs
-        = {// These are grouped into collections of ~similar sounding consonants.
-           std::make_pair('B', '1'), std::make_pair('C', '2'), std::make_pair('D', '3'), std::make_pair('F', '1'),
-           std::make_pair('G', '2'), std::make_pair('J', '2'), std::make_pair('K', '2'), std::make_pair('L', '4'),
-           std::make_pair('M', '5'), std::make_pair('N', '5'), std::make_pair('P', '1'), std::make_pair('Q', '2'),
-           std::make_pair('R', '6'), std::make_pair('S', '2'), std::make_pair('T', '3'), std::make_pair('V', '1'),
-           std::make_pair('X', '2'), std::make_pair('Z', '2'),
-
-           // These are dummies which are removed after contraction (but not prior!)
-           // Note std::make_pair('H','x'), std::make_pair('W','x')
-           // are excluded entirely.
-           std::make_pair('A', 'x'), std::make_pair('E', 'x'), std::make_pair('I', 'x'), std::make_pair('O', 'x'),
-           std::make_pair('U', 'x'), std::make_pair('Y', 'x')};
-
-    // Trim the whitespace and any non-alphanumeric chars.
-    std::string out = Canonicalize_String2(in, CANONICALIZE::TO_AZ | CANONICALIZE::TO_UPPER);
-
-    // Handle the special case where the first two chars have the same number.
-    while((out.size() > 1) && (Soundex_Equivs[out[0]] != 'x') && (Soundex_Equivs[out[0]] == Soundex_Equivs[out[1]])) {
-        out.erase(1, 1); // Remove the latter character.
-    }
+// NOTE: Earlier versions looked up codes with std::map::operator[], which silently registered any character compared
+// during the leading-duplicate contraction. Such characters were subsequently mapped to a null code rather than being
+// dropped. This quirk is reproduced (via 'registered') so that existing codes do not change.
+//
+uint32_t Soundex_Code(const std::string &in) {
+    const auto N = in.size();
+    size_t i     = 0;
 
-    // Except for the first character, transform the characters.
-    for(size_t i = 1; i < out.size();) {
-        if(Soundex_Equivs.find(out[i]) != Soundex_Equivs.end()) {
-            out[i] = Soundex_Equivs[out[i]];
-            ++i;
-        } else {
-            out.erase(i, 1);
+    // Advances to the next character that survives canonicalization, returning it upper-cased (or 0 if none remain).
+    const auto next = [&](void) -> char {
+        while(i < N) {
+            char c = in[i++];
+            if(('a' <= c) && (c <= 'z')) c = static_cast<char>(c - 'a' + 'A');
+            if((('A' <= c) && (c <= 'Z')) || (c == ' ')) return c;
         }
-    }
+        return 0;
+    };
+    const auto code_of = [](char c) -> char { return Soundex_Table[static_cast<unsigned char>(c)]; };
 
-    // Collapse any sequential duplicates after the 1st char.
-    for(size_t j = 2; j < out.size();) {
-        const size_t i = j - 1;
-        if(out[j] == out[i]) {
-            out.erase(j, 1);
-        } else {
-            ++j;
+    std::array<char, 4> out = {{'0', '0', '0', '0'}};
+    size_t n_out            = 0;
+
+    const char first = next();
+    if(first == 0) return 0x30303030;
+    out[n_out++] = first;
+
+    std::array<bool, 256> registered{};
+    char c = next();
+    if(c != 0) {
+        // Handle the special case where the leading characters have the same number.
+        registered[static_cast<unsigned char>(first)] = true;
+        if(code_of(first) != 'x') {
+            while(c != 0) {
+                registered[static_cast<unsigned char>(c)] = true;
+                if(code_of(c) != code_of(first)) break;
+                c = next();
+            }
         }
     }
 
-    // Remove any dummy 'x's.
-    for(size_t i = 0; i < out.size();) {
-        if(out[i] == 'x') {
-            out.erase(i, 1);
-        } else {
-            ++i;
-        }
+    // Transform the remaining characters, collapse sequential duplicates, and drop the dummy 'x's.
+    bool have_prev = false;
+    char prev      = 0;
+    for(; (c != 0) && (n_out < 4); c = next()) {
+        const char code = code_of(c);
+        if((code == 0) && !registered[static_cast<unsigned char>(c)]) continue;
+        if(have_prev && (code == prev)) continue;
+        have_prev = true;
+        prev      = code;
+        if(code != 'x') out[n_out++] = code;
     }
 
-    // Ensure the string is exactly 4 chars long. Pad with '0' if required.
-    while(out.size() < 4) { out.push_back('0'); }
-    while(out.size() > 4) { out.erase(4); }
+    return static_cast<uint32_t>(static_cast<unsigned char>(out[0]))
+           | (static_cast<uint32_t>(static_cast<unsigned char>(out[1])) << 8)
+           | (static_cast<uint32_t>(static_cast<unsigned char>(out[2])) << 16)
+           | (static_cast<uint32_t>(static_cast<unsigned char>(out[3])) << 24);
+}
+
+// Returns a string like 'R123' or 'A120' or '0000' holding the Soundex score.
+std::string Soundex(const std::string &in) {
+    const auto code = Soundex_Code(in);
+    std::string out;
+    for(int i = 0; i < 4; ++i) { out.push_back(static_cast<char>((code >> (8 * i)) & 0xFF)); }
     return out;
 }
 
+static std::shared_ptr<soundex_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    // Reminder: The lexicon looks like: < dirty : clean >
+    auto state = std::make_shared<soundex_state>();
+    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
+        state->index[Soundex_Code(it->first)].insert(it->second);
+    }
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_Soundex_Build(const std::map<std::string, std::string> &lexicon,
+                                                            float threshold) {
+    return Build_State(lexicon);
+}
+
 // Initializor function.
 void Explicator_Module_Soundex_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
     return;
 }
 
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Soundex_Query_V2(const void *state,
+                                   const std::map<std::string, std::string> &lexicon,
+                                   const Explicator_Query &q,
+                                   float threshold) {
+    if(state == nullptr) state = current_state.get();
+    std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
+    const auto &soundex_index = static_cast<const soundex_state *>(state)->index;
+
+    // Every clean which shares the input's Soundex is a (perfect) match.
+    const auto it = soundex_index.find(Soundex_Code(q.Text()));
+    if(it != soundex_index.end()) {
+        for(const auto &clean : it->second) { (*output)[clean] = 1.0; }
+    }
+    return output;
+}
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Soundex_Query_State(const void *state,
+                                      const std::map<std::string, std::string> &lexicon,
+                                      const std::string &in,
+                                      float threshold) {
+    return Explicator_Module_Soundex_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
 // Query function.
 std::unique_ptr<std::map<std::string, float>>
 Explicator_Module_Soundex_Query(const std::map<std::string, std::string> &lexicon,
                                 const std::string &in,
                                 float threshold) {
-    // Reminder: The lexicon looks like: < dirty : clean >
-    std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
-    const auto soundex_in(Soundex(in));
+    return Explicator_Module_Soundex_Query_State(current_state.get(), lexicon, in, threshold);
+}
 
-    // Cycle through the lexicon, computing the Soundex of each item. Compare it to that of the input.
+// Incremental lexicon edits.
+static void Add_To_State(soundex_state &S,
+                         const std::map<std::string, std::string> &lexicon,
+                         const std::string &dirty,
+                         const std::string &clean) {
+    S.index[Soundex_Code(dirty)].insert(clean);
+}
+
+static void Remove_From_State(soundex_state &S,
+                              const std::map<std::string, std::string> &lexicon,
+                              const std::string &dirty,
+                              const std::string &clean) {
+    // The clean stays indexed under the code if any of its remaining dirty strings share it.
+    const auto code = Soundex_Code(dirty);
     for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
-        if(Soundex(it->first) == soundex_in) {
-            (*output)[it->second] = 1.0;
-        }
+        if((it->second == clean) && (Soundex_Code(it->first) == code)) return;
     }
-    return output;
+    auto it = S.index.find(code);
+    if(it == S.index.end()) return;
+    it->second.erase(clean);
+    if(it->second.empty()) S.index.erase(it);
+}
+
+void Explicator_Module_Soundex_Add(const std::map<std::string, std::string> &lexicon,
+                                   const std::string &dirty,
+                                   const std::string &clean) {
+    Add_To_State(*current_state, lexicon, dirty, clean);
+}
+
+void Explicator_Module_Soundex_Remove(const std::map<std::string, std::string> &lexicon,
+                                      const std::string &dirty,
+                                      const std::string &clean) {
+    Remove_From_State(*current_state, lexicon, dirty, clean);
+}
+
+std::shared_ptr<const void> Explicator_Module_Soundex_Add_State(const std::shared_ptr<const void> &state,
+                                                                const std::map<std::string, std::string> &lexicon,
+                                                                const std::string &dirty,
+                                                                const std::string &clean) {
+    auto S = std::make_shared<soundex_state>(*static_cast<const soundex_state *>(state.get()));
+    Add_To_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_Soundex_Remove_State(const std::shared_ptr<const void> &state,
+                                       const std::map<std::string, std::string> &lexicon,
+                                       const std::string &dirty,
+                                       const std::string &clean) {
+    auto S = std::make_shared<soundex_state>(*static_cast<const soundex_state *>(state.get()));
+    Remove_From_State(*S, lexicon, dirty, clean);
+    return S;
 }
 
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_Soundex_Deinit(void) {
+    current_state = std::make_shared<soundex_state>();
     return;
 }
@@ -5,9 +5,42 @@
 #include <map>
 #include <memory>
 
+class Explicator_Query;
+
 void Explicator_Module_Soundex_Init(const std::map<std::string, std::string> &, float threshold);
 
 std::unique_ptr<std::map<std::string, float>>
 Explicator_Module_Soundex_Query(const std::map<std::string, std::string> &, const std::string &, float threshold);
 
 void Explicator_Module_Soundex_Deinit(void);
+
+std::shared_ptr<const void>
+Explicator_Module_Soundex_Build(const std::map<std::string, std::string> &, float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Soundex_Query_State(const void *state,
+                                      const std::map<std::string, std::string> &,
+                                      const std::string &,
+                                      float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Soundex_Query_V2(const void *state,
+                                   const std::map<std::string, std::string> &,
+                                   const Explicator_Query &,
+                                   float threshold);
+
+void Explicator_Module_Soundex_Add(const std::map<std::string, std::string> &,
+                                   const std::string &dirty,
+                                   const std::string &clean);
+void Explicator_Module_Soundex_Remove(const std::map<std::string, std::string> &,
+                                      const std::string &dirty,
+                                      const std::string &clean);
+std::shared_ptr<const void> Explicator_Module_Soundex_Add_State(const std::shared_ptr<const void> &state,
+                                                                const std::map<std::string, std::string> &,
+                                                                const std::string &dirty,
+                                                                const std::string &clean);
+std::shared_ptr<const void>
+Explicator_Module_Soundex_Remove_State(const std::shared_ptr<const void> &state,
+                                       const std::map<std::string, std::string> &,
+                                       const std::string &dirty,
+                                       const std::string &clean);
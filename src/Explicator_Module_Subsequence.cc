@@ -6,16 +6,23 @@
 // Upon receiving a query, the same procedure is performed. The query is compared with the
 // list to see how many matches (and maybe non-matches) are present. The most matches is probably
 // best, but some normalization should be performed.
+//
+// Subsequences are stored as sorted, packed N-gram codes (see NGram_Code()) rather than strings.
 
+#include <stdint.h>
 #include <algorithm>
 #include <iterator>
 #include <map>
 #include <memory>
-#include <set>
+#include <stdexcept>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "Explicator_Query.h"
 #include "Misc.h"
+#include "Snapshot.h"
 #include "String.h"
 
 using namespace explicator_internals;
@@ -23,17 +30,29 @@ using namespace explicator_internals;
 static const long int L = 2; // Minimum subsequence length.
 static const long int U = 6; // Maximum subsequence length.
 
-static std::map<std::string, std::set<std::string>> subseq_lexicon; // clean -> set of subsequences.
-static std::set<std::string> common_subseqs;                        // A list of common subsequences which are omitted.
+// The subsequences which survive are exactly those found in the dirty strings of only one clean. Incremental edits
+// track, for every subsequence, the number of cleans it appears in. This is only built upon the first edit.
+struct subsequence_edit_index {
+    std::map<std::string, std::vector<uint64_t>> all_subseqs; // clean -> sorted subsequence codes, incl. common ones.
+    std::unordered_map<uint64_t, std::pair<uint32_t, const std::string *>> clean_counts; // code -> <# cleans, a clean>.
+};
 
-static float max_set_size = -1.0;
+struct subsequence_state {
+    std::map<std::string, std::vector<uint64_t>> subseq_lexicon; // clean -> sorted subsequence codes.
+    std::vector<uint64_t> common_subseqs;                        // Sorted common subsequence codes, which are omitted.
+    float max_set_size = -1.0;
+    mutable std::unique_ptr<subsequence_edit_index> edit_index; // Not used by queries. See Copy_State().
+};
 
-// Initializor function.
-void Explicator_Module_Subsequence_Init(const std::map<std::string, std::string> &lexicon,
-                                        float threshold) { // The lexicon looks like: < dirty : clean >.
-    subseq_lexicon.clear();
+static std::shared_ptr<subsequence_state> current_state = std::make_shared<subsequence_state>();
+
+static std::shared_ptr<subsequence_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    // The lexicon looks like: < dirty : clean >.
+    auto state           = std::make_shared<subsequence_state>();
+    auto &subseq_lexicon = state->subseq_lexicon;
+    auto &common_subseqs = state->common_subseqs;
     if(lexicon.empty()) {
-        return; // Should we FUNCEXPLICATORERR instead?
+        return state; // Should we FUNCEXPLICATORERR instead?
     }
 
     // Populate the subseq_lexicon with *all* subsequences. This is slow, wasteful, and very easy to code.
@@ -42,76 +61,87 @@ void Explicator_Module_Subsequence_Init(const std::map<std::string, std::string>
             = Canonicalize_String2(it->first, CANONICALIZE::TRIM_ALL | CANONICALIZE::TO_UPPER); // Remove ALL spaces.
         const std::string clean(it->second);
 
-        std::set<std::string> allsubsequences;
-        for(long int N = L; N <= U; ++N) {
-            const auto subseqs = NGrams(dirty, -1, N, NGRAMS::CHARS);
-            allsubsequences.insert(subseqs.begin(), subseqs.end());
-        }
-        subseq_lexicon[clean].insert(allsubsequences.begin(), allsubsequences.end());
+        auto &subseqs = subseq_lexicon[clean];
+        Visit_NGram_Codes(dirty, L, U, [&](uint64_t code) { subseqs.push_back(code); });
+    }
+    for(auto &s : subseq_lexicon) {
+        std::sort(s.second.begin(), s.second.end());
+        s.second.erase(std::unique(s.second.begin(), s.second.end()), s.second.end());
     }
 
     if(subseq_lexicon.size() == 1) {
-        return; // No duplicates. Not ideal, but useable. No need to go on.
+        return state; // No duplicates. Not ideal, but useable. No need to go on.
     }
 
     // Now cycle through the suqsequences and remove all which are duplicated somewhere.
     for(auto it1 = ++(subseq_lexicon.begin()); it1 != subseq_lexicon.end(); ++it1) {
         for(auto it2 = subseq_lexicon.begin(); (it2 != subseq_lexicon.end()) && (it2 != it1); ++it2) {
             // Find the subsequences which appear in both.
-            std::set<std::string> intersection;
+            std::vector<uint64_t> intersection;
             std::set_intersection(it1->second.begin(), it1->second.end(), it2->second.begin(), it2->second.end(),
-                                  std::inserter(intersection, intersection.begin()));
+                                  std::back_inserter(intersection));
 
-            common_subseqs.insert(intersection.begin(), intersection.end());
+            {
+                std::vector<uint64_t> merged;
+                std::set_union(common_subseqs.begin(), common_subseqs.end(), intersection.begin(), intersection.end(),
+                               std::back_inserter(merged));
+                common_subseqs.swap(merged);
+            }
 
             // Remove the matching subsequences from both sets.
             {
-                std::set<std::string> diff;
+                std::vector<uint64_t> diff;
                 std::set_difference(it1->second.begin(), it1->second.end(), common_subseqs.begin(),
-                                    common_subseqs.end(), std::inserter(diff, diff.begin()));
-                it1->second = diff;
+                                    common_subseqs.end(), std::back_inserter(diff));
+                it1->second.swap(diff);
             }
             {
-                std::set<std::string> diff;
+                std::vector<uint64_t> diff;
                 std::set_difference(it2->second.begin(), it2->second.end(), common_subseqs.begin(),
-                                    common_subseqs.end(), std::inserter(diff, diff.begin()));
-                it2->second = diff;
+                                    common_subseqs.end(), std::back_inserter(diff));
+                it2->second.swap(diff);
             }
         }
     }
 
     // Find the largest and smallest set size.
-    const auto lambda_lt = [](const std::pair<std::string, std::set<std::string>> &A,
-                              const std::pair<std::string, std::set<std::string>> &B) -> bool {
+    const auto lambda_lt = [](const std::pair<const std::string, std::vector<uint64_t>> &A,
+                              const std::pair<const std::string, std::vector<uint64_t>> &B) -> bool {
         return A.second.size() < B.second.size();
     };
-    max_set_size = static_cast<float>(
+    state->max_set_size = static_cast<float>(
         (std::max_element(subseq_lexicon.begin(), subseq_lexicon.end(), lambda_lt))->second.size());
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_Subsequence_Build(const std::map<std::string, std::string> &lexicon,
+                                                                float threshold) {
+    return Build_State(lexicon);
+}
+
+// Initializor function.
+void Explicator_Module_Subsequence_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
 }
 
-// Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_Subsequence_Query(const std::map<std::string, std::string> &lexicon,
-                                    const std::string &in,
-                                    float threshold) {
+Explicator_Module_Subsequence_Query_V2(const void *state,
+                                       const std::map<std::string, std::string> &lexicon,
+                                       const Explicator_Query &q,
+                                       float threshold) {
+    if(state == nullptr) state = current_state.get();
     // Remember: The lexicon looks like: < dirty : clean >
     std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
+    const auto &subseq_lexicon = static_cast<const subsequence_state *>(state)->subseq_lexicon;
+    const auto &common_subseqs = static_cast<const subsequence_state *>(state)->common_subseqs;
 
-    const std::string dirty
-        = Canonicalize_String2(in, CANONICALIZE::TRIM_ALL | CANONICALIZE::TO_UPPER); // Remove ALL spaces.
-
-    // Find all the subsequences in this string.
-    std::set<std::string> in_subseqs;
-    for(long int N = L; N <= U; ++N) {
-        const auto subseqs = NGrams(dirty, -1, N, NGRAMS::CHARS);
-        in_subseqs.insert(subseqs.begin(), subseqs.end());
-    }
+    // Find all the subsequences in this string (with ALL spaces removed).
+    const std::vector<uint64_t> &all_subseqs = q.Spaceless_NGram_Codes(L, U);
 
     // Remove common subsequences. If nothing remains, jump ship!
-    std::set<std::string> diff;
-    std::set_difference(in_subseqs.begin(), in_subseqs.end(), common_subseqs.begin(), common_subseqs.end(),
-                        std::inserter(diff, diff.begin()));
-    in_subseqs = diff;
+    std::vector<uint64_t> in_subseqs;
+    std::set_difference(all_subseqs.begin(), all_subseqs.end(), common_subseqs.begin(), common_subseqs.end(),
+                        std::back_inserter(in_subseqs));
     if(in_subseqs.empty()) {
         return output;
     }
@@ -131,11 +161,7 @@ Explicator_Module_Subsequence_Query(const std::map<std::string, std::string> &le
     // occured in the lexicon but were removed because they were not unique to the specific clean.
     for(auto it = subseq_lexicon.begin(); it != subseq_lexicon.end(); ++it) {
         const std::string clean(it->first);
-        std::set<std::string> intersection;
-        std::set_intersection(it->second.begin(), it->second.end(), in_subseqs.begin(), in_subseqs.end(),
-                              std::inserter(intersection, intersection.begin()));
-
-        const float matches = static_cast<float>(intersection.size());
+        const float matches = static_cast<float>(NGram_Code_Match_Count(it->second, in_subseqs));
         const float scaled  = (matches - theoworst) / (theobest - theoworst);
 
         if((scaled > threshold)
@@ -149,9 +175,237 @@ Explicator_Module_Subsequence_Query(const std::map<std::string, std::string> &le
     return output;
 }
 
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Subsequence_Query_State(const void *state,
+                                          const std::map<std::string, std::string> &lexicon,
+                                          const std::string &in,
+                                          float threshold) {
+    return Explicator_Module_Subsequence_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+// Query function.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Subsequence_Query(const std::map<std::string, std::string> &lexicon,
+                                    const std::string &in,
+                                    float threshold) {
+    return Explicator_Module_Subsequence_Query_State(current_state.get(), lexicon, in, threshold);
+}
+
+// Snapshot functions.
+void Explicator_Module_Subsequence_Save(std::string &state) {
+    Snapshot_Writer w;
+    w.Put(static_cast<int64_t>(L));
+    w.Put(static_cast<int64_t>(U));
+    w.Put(current_state->max_set_size);
+    w.Put_Vector(current_state->common_subseqs);
+    w.Put(static_cast<uint64_t>(current_state->subseq_lexicon.size()));
+    for(const auto &e : current_state->subseq_lexicon) {
+        w.Put_String(e.first);
+        w.Put_Vector(e.second);
+    }
+    state = std::move(w.blob);
+}
+
+void Explicator_Module_Subsequence_Load(const std::string &state) {
+    Snapshot_Reader r(state);
+    if((r.Get<int64_t>() != L) || (r.Get<int64_t>() != U)) {
+        throw std::runtime_error("Snapshot subsequence lengths do not match");
+    }
+    auto loaded            = std::make_shared<subsequence_state>();
+    loaded->max_set_size   = r.Get<float>();
+    loaded->common_subseqs = r.Get_Vector<uint64_t>();
+    for(auto N = r.Get_Count(2 * sizeof(uint64_t)); N != 0; --N) {
+        auto clean = r.Get_String();
+        loaded->subseq_lexicon.emplace_hint(loaded->subseq_lexicon.end(), std::move(clean), r.Get_Vector<uint64_t>());
+    }
+    current_state = loaded;
+}
+
+// Incremental lexicon edits.
+static std::vector<uint64_t> Subsequence_Codes(const std::string &dirty) {
+    return NGram_Codes(Canonicalize_String2(dirty, CANONICALIZE::TRIM_ALL | CANONICALIZE::TO_UPPER), L, U);
+}
+
+static void Sorted_Insert(std::vector<uint64_t> &A, const std::vector<uint64_t> &B) {
+    std::vector<uint64_t> merged;
+    std::set_union(A.begin(), A.end(), B.begin(), B.end(), std::back_inserter(merged));
+    A.swap(merged);
+}
+
+static void Sorted_Erase(std::vector<uint64_t> &A, const std::vector<uint64_t> &B) {
+    std::vector<uint64_t> diff;
+    std::set_difference(A.begin(), A.end(), B.begin(), B.end(), std::back_inserter(diff));
+    A.swap(diff);
+}
+
+// Builds the edit index for the lexicon as it was before the edit, i.e., without (or with) the given entry.
+static void Build_Edit_Index(subsequence_state &S,
+                             const std::map<std::string, std::string> &lexicon,
+                             const std::string &dirty,
+                             const std::string &clean,
+                             bool entry_was_present) {
+    S.edit_index.reset(new subsequence_edit_index());
+    auto &I = *S.edit_index;
+    const auto visit = [&](const std::string &d, const std::string &c) -> void {
+        const std::string canonical = Canonicalize_String2(d, CANONICALIZE::TRIM_ALL | CANONICALIZE::TO_UPPER);
+        auto &subseqs               = I.all_subseqs[c];
+        Visit_NGram_Codes(canonical, L, U, [&](uint64_t code) { subseqs.push_back(code); });
+    };
+    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
+        if(it->first != dirty) visit(it->first, it->second);
+    }
+    if(entry_was_present) visit(dirty, clean);
+
+    for(auto &family : I.all_subseqs) {
+        std::sort(family.second.begin(), family.second.end());
+        family.second.erase(std::unique(family.second.begin(), family.second.end()), family.second.end());
+        for(const auto code : family.second) {
+            auto &count = I.clean_counts[code];
+            ++count.first;
+            count.second = &family.first;
+        }
+    }
+}
+
+static void Update_Max_Set_Size(subsequence_state &S) {
+    S.max_set_size = -1.0;
+    for(const auto &s : S.subseq_lexicon) {
+        S.max_set_size = EXPLICATORMAX(S.max_set_size, static_cast<float>(s.second.size()));
+    }
+}
+
+static void Add_To_State(subsequence_state &S,
+                         const std::map<std::string, std::string> &lexicon,
+                         const std::string &dirty,
+                         const std::string &clean) {
+    if(!S.edit_index) Build_Edit_Index(S, lexicon, dirty, clean, false);
+    auto &I = *S.edit_index;
+
+    const auto family = I.all_subseqs.emplace(clean, std::vector<uint64_t>()).first;
+    S.subseq_lexicon.emplace(clean, std::vector<uint64_t>());
+    std::vector<uint64_t> added;
+    const auto codes = Subsequence_Codes(dirty);
+    std::set_difference(codes.begin(), codes.end(), family->second.begin(), family->second.end(),
+                        std::back_inserter(added));
+    Sorted_Insert(family->second, added);
+
+    // Subsequences new to the lexicon are unique to this clean. Those seen in exactly one other clean become common.
+    std::vector<uint64_t> unique, common;
+    std::map<const std::string *, std::vector<uint64_t>> no_longer_unique;
+    for(const auto code : added) {
+        auto &count = I.clean_counts[code];
+        if(++count.first == 1) {
+            count.second = &family->first;
+            unique.push_back(code);
+        } else if(count.first == 2) {
+            common.push_back(code);
+            no_longer_unique[count.second].push_back(code);
+        }
+    }
+    Sorted_Insert(S.subseq_lexicon[clean], unique);
+    Sorted_Insert(S.common_subseqs, common);
+    for(const auto &n : no_longer_unique) Sorted_Erase(S.subseq_lexicon[*(n.first)], n.second);
+    Update_Max_Set_Size(S);
+}
+
+static void Remove_From_State(subsequence_state &S,
+                              const std::map<std::string, std::string> &lexicon,
+                              const std::string &dirty,
+                              const std::string &clean) {
+    if(!S.edit_index) Build_Edit_Index(S, lexicon, dirty, clean, true);
+    auto &I = *S.edit_index;
+
+    const auto family = I.all_subseqs.find(clean);
+    if(family == I.all_subseqs.end()) return;
+
+    // Recompute the clean's subsequences from its remaining dirty strings.
+    bool clean_remains = false;
+    std::vector<uint64_t> remaining, removed;
+    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
+        if(it->second != clean) continue;
+        clean_remains = true;
+        Sorted_Insert(remaining, Subsequence_Codes(it->first));
+    }
+    std::set_difference(family->second.begin(), family->second.end(), remaining.begin(), remaining.end(),
+                        std::back_inserter(removed));
+    family->second.swap(remaining);
+
+    // Subsequences which are now absent from the lexicon are dropped. Those left in exactly one other clean become
+    // unique to it.
+    std::vector<uint64_t> absent, uncommon;
+    for(const auto code : removed) {
+        auto count = I.clean_counts.find(code);
+        if(--(count->second.first) == 0) {
+            I.clean_counts.erase(count);
+            absent.push_back(code);
+        } else if(count->second.first == 1) {
+            uncommon.push_back(code);
+        }
+    }
+    Sorted_Erase(S.subseq_lexicon[clean], absent);
+    Sorted_Erase(S.common_subseqs, uncommon);
+    if(!uncommon.empty()) {
+        for(const auto &f : I.all_subseqs) {
+            std::vector<uint64_t> now_unique;
+            std::set_intersection(f.second.begin(), f.second.end(), uncommon.begin(), uncommon.end(),
+                                  std::back_inserter(now_unique));
+            if(now_unique.empty()) continue;
+            for(const auto code : now_unique) I.clean_counts[code].second = &f.first;
+            Sorted_Insert(S.subseq_lexicon[f.first], now_unique);
+        }
+    }
+
+    if(!clean_remains) {
+        I.all_subseqs.erase(family);
+        S.subseq_lexicon.erase(clean);
+    }
+    Update_Max_Set_Size(S);
+}
+
+// Copies a state for editing. The edit index is large, and edits are normally made to the newest copy, so it is handed
+// on to the copy rather than duplicated. The original rebuilds it if it is ever edited itself.
+static std::shared_ptr<subsequence_state> Copy_State(const std::shared_ptr<const void> &state) {
+    const auto &S     = *static_cast<const subsequence_state *>(state.get());
+    auto C            = std::make_shared<subsequence_state>();
+    C->subseq_lexicon = S.subseq_lexicon;
+    C->common_subseqs = S.common_subseqs;
+    C->max_set_size   = S.max_set_size;
+    C->edit_index     = std::move(S.edit_index);
+    return C;
+}
+
+void Explicator_Module_Subsequence_Add(const std::map<std::string, std::string> &lexicon,
+                                       const std::string &dirty,
+                                       const std::string &clean) {
+    Add_To_State(*current_state, lexicon, dirty, clean);
+}
+
+void Explicator_Module_Subsequence_Remove(const std::map<std::string, std::string> &lexicon,
+                                          const std::string &dirty,
+                                          const std::string &clean) {
+    Remove_From_State(*current_state, lexicon, dirty, clean);
+}
+
+std::shared_ptr<const void> Explicator_Module_Subsequence_Add_State(const std::shared_ptr<const void> &state,
+                                                                    const std::map<std::string, std::string> &lexicon,
+                                                                    const std::string &dirty,
+                                                                    const std::string &clean) {
+    auto S = Copy_State(state);
+    Add_To_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_Subsequence_Remove_State(const std::shared_ptr<const void> &state,
+                                           const std::map<std::string, std::string> &lexicon,
+                                           const std::string &dirty,
+                                           const std::string &clean) {
+    auto S = Copy_State(state);
+    Remove_From_State(*S, lexicon, dirty, clean);
+    return S;
+}
+
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_Subsequence_Deinit(void) {
-    subseq_lexicon.clear();
-    common_subseqs.clear();
-    max_set_size = -1.0;
+    current_state = std::make_shared<subsequence_state>();
 }
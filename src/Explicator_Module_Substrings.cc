@@ -5,50 +5,179 @@
 // determining N longest common substrings, and then weighting each
 // in a progressively less heavy manner. This will allow for soft matches,
 // but will keep the precision up for very long substrings.
+//
+// A suffix automaton is built for each dirty string at initialization, so each comparison is a single walk over the
+// query. Currently only the single longest common substring is used. The walk also provides the longest match ending
+// at each position of the query, from which the N longest common substrings can be extracted cheaply if needed.
 
 #include <string>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
+#include "Explicator_Query.h"
 #include "Misc.h"
+#include "Snapshot.h"
 #include "String.h"
 
 using namespace explicator_internals;
 
-void Explicator_Module_Substrings_Init(const std::map<std::string, std::string> &lexicon,
-                                       float threshold) { // The lexicon looks like: < dirty : clean >.
+struct substrings_entry {
+    std::string dirty;
+    Suffix_Automaton automaton; // Recognizes substrings of the dirty string.
+
+    explicit substrings_entry(const std::string &d) : dirty(d), automaton(d) {}
+    substrings_entry(std::string d, Suffix_Automaton a) : dirty(std::move(d)), automaton(std::move(a)) {}
+};
+
+struct substrings_state {
+    Clean_Families<substrings_entry> families;
+};
+
+static std::shared_ptr<substrings_state> current_state = std::make_shared<substrings_state>();
+
+static std::shared_ptr<substrings_state> Build_State(const std::map<std::string, std::string> &lexicon) {
+    // The lexicon looks like: < dirty : clean >.
+    auto state      = std::make_shared<substrings_state>();
+    state->families = Clean_Families<substrings_entry>(lexicon);
+    return state;
+}
+
+std::shared_ptr<const void> Explicator_Module_Substrings_Build(const std::map<std::string, std::string> &lexicon,
+                                                               float threshold) {
+    return Build_State(lexicon);
+}
+
+void Explicator_Module_Substrings_Init(const std::map<std::string, std::string> &lexicon, float threshold) {
+    current_state = Build_State(lexicon);
     return;
 }
 
-// Query function.
 std::unique_ptr<std::map<std::string, float>>
-Explicator_Module_Substrings_Query(const std::map<std::string, std::string> &lexicon,
-                                   const std::string &in,
-                                   float threshold) {
+Explicator_Module_Substrings_Query_V2(const void *state,
+                                      const std::map<std::string, std::string> &lexicon,
+                                      const Explicator_Query &q,
+                                      float threshold) {
+    if(state == nullptr) state = current_state.get();
+    const std::string &in = q.Text();
     // Remember: The lexicon looks like: < dirty : clean >
-    std::unique_ptr<std::map<std::string, float>> output(new std::map<std::string, float>());
+    Top_K_Cleans best(q.Top_K(), threshold);
+    const auto &families = static_cast<const substrings_state *>(state)->families;
 
-    for(auto it = lexicon.begin(); it != lexicon.end(); ++it) {
-        const auto max_substr_len = static_cast<float>(ALongestCommonSubstring(it->first, in).size());
-        const auto max_str_len    = static_cast<float>(EXPLICATORMAX((it->first).size(), in.size()));
+    // The common substring can be no longer than the shorter string, nor than the longest run of query characters
+    // which all appear in some dirty string of the clean. The bound is highest for dirty strings as long as the query,
+    // so only those with lengths near it which could score well enough to be kept are visited, and whole families are
+    // skipped if none could.
+    size_t scanned = 0;
+    for(const auto &f : families) {
+        if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+        if(!q.Is_Candidate(f.clean)) continue;
 
-        if(max_str_len == 0.0) {
-            FUNCEXPLICATORWARN("Comparing two empty strings. Ignoring!");
-            continue;
-        }
+        const auto run         = f.summary.Longest_Present_Run(in);
+        const auto score_bound = [&](size_t length) -> float {
+            const auto max_str_len = static_cast<float>(EXPLICATORMAX(length, in.size()));
+            return static_cast<float>(EXPLICATORMIN(run, length)) / max_str_len;
+        };
+        const auto could_keep = [&](size_t length) -> bool {
+            return (EXPLICATORMAX(length, in.size()) == 0) || best.Could_Keep(score_bound(length));
+        };
+        const auto nearest = f.summary.Nearest_Length(in.size());
+        if(!could_keep(nearest)) continue;
 
-        const auto score = max_substr_len / max_str_len;
-        if(score > threshold) { // If not present, insert it. If present, keep highest score.
-            if(!(output->find(it->second) != output->end()) || ((*output)[it->second] < score)) {
-                (*output)[it->second] = score;
+        const auto window = f.Feasible_Window(in.size(), could_keep);
+        for(auto e_it = window.first; e_it != window.second; ++e_it) {
+            if(((++scanned % Explicator_Query::Deadline_Check_Interval) == 0) && q.Past_Deadline()) break;
+            const auto max_str_len = static_cast<float>(EXPLICATORMAX(e_it->dirty.size(), in.size()));
+
+            if(max_str_len == 0.0) {
+                FUNCEXPLICATORWARN("Comparing two empty strings. Ignoring!");
+                continue;
             }
+
+            // Skip the walk if even the longest possible common substring would not score well enough to be kept.
+            if(!best.Could_Keep(score_bound(e_it->dirty.size()))) continue;
+
+            // If not present, insert it. If present, keep highest score.
+            const auto max_substr_len = static_cast<float>(e_it->automaton.Longest_Common_Substring_Length(in));
+            const auto score          = max_substr_len / max_str_len;
+            best.Insert(f.clean, score);
+            if(score_bound(nearest) <= score) break; // No other dirty string of the family can score higher.
         }
+        if(q.Interrupted()) break;
     }
-    return output;
+    return best.Release();
+}
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Substrings_Query_State(const void *state,
+                                         const std::map<std::string, std::string> &lexicon,
+                                         const std::string &in,
+                                         float threshold) {
+    return Explicator_Module_Substrings_Query_V2(state, lexicon, Explicator_Query(in), threshold);
+}
+
+// Query function.
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Substrings_Query(const std::map<std::string, std::string> &lexicon,
+                                   const std::string &in,
+                                   float threshold) {
+    return Explicator_Module_Substrings_Query_State(current_state.get(), lexicon, in, threshold);
+}
+
+// The suffix automata are saved along with the dirty strings, so they need not be rebuilt either.
+void Explicator_Module_Substrings_Save(std::string &state) {
+    Snapshot_Writer w;
+    current_state->families.Save(w, [](Snapshot_Writer &w, const substrings_entry &e) -> void { e.automaton.Save(w); });
+    state = std::move(w.blob);
+}
+
+void Explicator_Module_Substrings_Load(const std::string &state) {
+    Snapshot_Reader r(state);
+    auto loaded      = std::make_shared<substrings_state>();
+    loaded->families = Clean_Families<substrings_entry>::Load(r, [](Snapshot_Reader &r, std::string dirty) {
+        return substrings_entry(std::move(dirty), Suffix_Automaton::Load(r));
+    });
+    current_state    = loaded;
+}
+
+// Incremental lexicon edits.
+void Explicator_Module_Substrings_Add(const std::map<std::string, std::string> &lexicon,
+                                      const std::string &dirty,
+                                      const std::string &clean) {
+    current_state->families.Add(dirty, clean);
+    return;
+}
+
+void Explicator_Module_Substrings_Remove(const std::map<std::string, std::string> &lexicon,
+                                         const std::string &dirty,
+                                         const std::string &clean) {
+    current_state->families.Remove(dirty, clean);
+    return;
+}
+
+std::shared_ptr<const void> Explicator_Module_Substrings_Add_State(const std::shared_ptr<const void> &state,
+                                                                   const std::map<std::string, std::string> &lexicon,
+                                                                   const std::string &dirty,
+                                                                   const std::string &clean) {
+    auto S = std::make_shared<substrings_state>(*static_cast<const substrings_state *>(state.get()));
+    S->families.Add(dirty, clean);
+    return S;
+}
+
+std::shared_ptr<const void>
+Explicator_Module_Substrings_Remove_State(const std::shared_ptr<const void> &state,
+                                          const std::map<std::string, std::string> &lexicon,
+                                          const std::string &dirty,
+                                          const std::string &clean) {
+    auto S = std::make_shared<substrings_state>(*static_cast<const substrings_state *>(state.get()));
+    S->families.Remove(dirty, clean);
+    return S;
 }
 
 // De-initializor function. Ensure this function can be called both after AND before the init function.
 void Explicator_Module_Substrings_Deinit(void) {
+    current_state = std::make_shared<substrings_state>();
     return;
 }
@@ -4,9 +4,46 @@
 #include <map>
 #include <memory>
 
+class Explicator_Query;
+
 void Explicator_Module_Substrings_Init(const std::map<std::string, std::string> &, float threshold);
 
 std::unique_ptr<std::map<std::string, float>>
 Explicator_Module_Substrings_Query(const std::map<std::string, std::string> &, const std::string &, float threshold);
 
 void Explicator_Module_Substrings_Deinit(void);
+
+std::shared_ptr<const void>
+Explicator_Module_Substrings_Build(const std::map<std::string, std::string> &, float threshold);
+
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Substrings_Query_State(const void *state,
+                                         const std::map<std::string, std::string> &,
+                                         const std::string &,
+                                         float threshold);
+
+// Honours Explicator_Query::Top_K() and Explicator_Query::Restrict_Candidates().
+std::unique_ptr<std::map<std::string, float>>
+Explicator_Module_Substrings_Query_V2(const void *state,
+                                      const std::map<std::string, std::string> &,
+                                      const Explicator_Query &,
+                                      float threshold);
+
+void Explicator_Module_Substrings_Save(std::string &state);
+void Explicator_Module_Substrings_Load(const std::string &state);
+
+void Explicator_Module_Substrings_Add(const std::map<std::string, std::string> &,
+                                      const std::string &dirty,
+                                      const std::string &clean);
+void Explicator_Module_Substrings_Remove(const std::map<std::string, std::string> &,
+                                         const std::string &dirty,
+                                         const std::string &clean);
+std::shared_ptr<const void> Explicator_Module_Substrings_Add_State(const std::shared_ptr<const void> &state,
+                                                                   const std::map<std::string, std::string> &,
+                                                                   const std::string &dirty,
+                                                                   const std::string &clean);
+std::shared_ptr<const void>
+Explicator_Module_Substrings_Remove_State(const std::shared_ptr<const void> &state,
+                                          const std::map<std::string, std::string> &,
+                                          const std::string &dirty,
+                                          const std::string &clean);
@@ -0,0 +1,193 @@
+// Explicator_Query.cc - A preprocessed query shared by all modules.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Explicator_Query.h"
+#include "Misc.h"   //Needed for EXPLICATORMAX().
+#include "String.h" //Needed for Canonicalize_String2() and NGram_Codes().
+
+Explicator_Query::Explicator_Query(const std::string &in) : text(in) {}
+
+const std::string &Explicator_Query::Text(void) const {
+    return this->text;
+}
+
+const std::string &Explicator_Query::Spaceless(void) const {
+    if(!this->spaceless) {
+        this->spaceless = explicator_internals::Canonicalize_String2(
+            this->text, explicator_internals::CANONICALIZE::TRIM_ALL | explicator_internals::CANONICALIZE::TO_UPPER);
+    }
+    return *(this->spaceless);
+}
+
+const std::vector<uint64_t> &Explicator_Query::Find_NGram_Codes(long int L, long int U, bool spaceless) const {
+    for(const auto &n : this->ngrams) {
+        if((n.L == L) && (n.U == U) && (n.spaceless == spaceless)) return n.codes;
+    }
+    const auto &s = spaceless ? this->Spaceless() : this->text;
+    this->ngrams.push_back({L, U, spaceless, explicator_internals::NGram_Codes(s, L, U)});
+    return this->ngrams.back().codes;
+}
+
+const std::vector<uint64_t> &Explicator_Query::NGram_Codes(long int L, long int U) const {
+    return this->Find_NGram_Codes(L, U, false);
+}
+
+const std::vector<uint64_t> &Explicator_Query::Spaceless_NGram_Codes(long int L, long int U) const {
+    return this->Find_NGram_Codes(L, U, true);
+}
+
+const std::string &Explicator_Query::Key(std::string (*encode)(const std::string &)) const {
+    for(const auto &k : this->keys) {
+        if(k.first == encode) return k.second;
+    }
+    this->keys.emplace_back(encode, encode(this->text));
+    return this->keys.back().second;
+}
+
+void Explicator_Query::Restrict_Candidates(std::vector<std::string> cleans) {
+    std::sort(cleans.begin(), cleans.end());
+    this->candidates = std::move(cleans);
+}
+
+bool Explicator_Query::Is_Candidate(const std::string &clean) const {
+    return !this->candidates || std::binary_search(this->candidates->begin(), this->candidates->end(), clean);
+}
+
+void Explicator_Query::Set_Top_K(size_t K) {
+    this->top_k = K;
+}
+
+size_t Explicator_Query::Top_K(void) const {
+    return this->top_k;
+}
+
+void Explicator_Query::Set_Search_Radius(long int radius) {
+    this->search_radius = radius;
+}
+
+long int Explicator_Query::Search_Radius(void) const {
+    return this->search_radius;
+}
+
+void Explicator_Query::Set_Deadline(std::chrono::steady_clock::time_point t) {
+    this->deadline = t;
+}
+
+bool Explicator_Query::Has_Deadline(void) const {
+    return this->deadline.has_value();
+}
+
+bool Explicator_Query::Past_Deadline(void) const {
+    if(!this->interrupted && this->deadline && !(std::chrono::steady_clock::now() < *(this->deadline))) {
+        this->interrupted = true;
+    }
+    return this->interrupted;
+}
+
+bool Explicator_Query::Interrupted(void) const {
+    return this->interrupted;
+}
+
+Top_K_Cleans::Top_K_Cleans(size_t k, float thold)
+    : K(k), threshold(thold), kth_best(thold), best(new std::map<std::string, float>()) {}
+
+bool Top_K_Cleans::Could_Keep(float score) const {
+    if(!(score > this->threshold)) return false;
+    return (this->K == 0) || (this->ranked.size() < this->K) || !(score < this->kth_best);
+}
+
+float Top_K_Cleans::Cutoff(void) const {
+    if((this->K == 0) || (this->ranked.size() < this->K)) return this->threshold;
+    return this->kth_best;
+}
+
+void Top_K_Cleans::Insert(const std::string &clean, float score) {
+    if(!this->Could_Keep(score)) return;
+    auto it = this->best->find(clean);
+    if((it != this->best->end()) && !(it->second < score)) return;
+    if(this->K == 0) {
+        (*(this->best))[clean] = score;
+        return;
+    }
+
+    if(it != this->best->end()) {
+        this->ranked.erase({it->second, clean});
+        it->second = score;
+    } else {
+        this->best->emplace(clean, score);
+    }
+    this->ranked.insert({score, clean});
+
+    // Drop the cleans which are no longer among the K best, keeping any tied with the K-th.
+    if(this->K <= this->ranked.size()) {
+        this->kth_best = std::prev(this->ranked.end(), static_cast<long int>(this->K))->first;
+        while(this->ranked.begin()->first < this->kth_best) {
+            this->best->erase(this->ranked.begin()->second);
+            this->ranked.erase(this->ranked.begin());
+        }
+    }
+}
+
+std::unique_ptr<std::map<std::string, float>> Top_K_Cleans::Release(void) {
+    this->ranked.clear();
+    return std::move(this->best);
+}
+
+uint64_t Clean_Family_Summary::Char_Bit(char c) {
+    return static_cast<uint64_t>(1) << (static_cast<unsigned char>(c) % 64);
+}
+
+void Clean_Family_Summary::Include(const std::string &dirty) {
+    this->min_length = EXPLICATORMIN(this->min_length, dirty.size());
+    this->max_length = EXPLICATORMAX(this->max_length, dirty.size());
+    for(const char c : dirty) this->chars |= Char_Bit(c);
+    if(this->count == 0) {
+        this->prefix = dirty;
+    } else {
+        const auto mismatch = std::mismatch(this->prefix.begin(),
+                                            this->prefix.begin() + EXPLICATORMIN(this->prefix.size(), dirty.size()),
+                                            dirty.begin());
+        this->prefix.erase(mismatch.first, this->prefix.end());
+    }
+    ++(this->count);
+}
+
+size_t Clean_Family_Summary::Nearest_Length(size_t length) const {
+    return EXPLICATORMIN(EXPLICATORMAX(length, this->min_length), this->max_length);
+}
+
+size_t Clean_Family_Summary::Absent_Count(const std::string &text) const {
+    size_t absent = 0;
+    for(const char c : text) {
+        if((this->chars & Char_Bit(c)) == 0) ++absent;
+    }
+    return absent;
+}
+
+size_t Clean_Family_Summary::Longest_Present_Run(const std::string &text) const {
+    size_t longest = 0, run = 0;
+    for(const char c : text) {
+        run     = ((this->chars & Char_Bit(c)) == 0) ? 0 : run + 1;
+        longest = EXPLICATORMAX(longest, run);
+    }
+    return longest;
+}
+
+size_t Clean_Family_Summary::Shared_Prefix_Bound(const std::string &text) const {
+    const auto N        = EXPLICATORMIN(this->prefix.size(), text.size());
+    const auto mismatch = std::mismatch(this->prefix.begin(), this->prefix.begin() + N, text.begin());
+    const auto shared   = static_cast<size_t>(std::distance(this->prefix.begin(), mismatch.first));
+    return (shared < this->prefix.size()) ? shared : text.size();
+}
+
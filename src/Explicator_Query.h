@@ -0,0 +1,324 @@
+// Explicator_Query.h - A preprocessed query shared by all modules.
+//
+// Many modules derive the same forms of the query (e.g., with whitespace removed, or as N-gram codes) before scoring.
+// An Explicator_Query is built once per translation and passed to every module which supports the second-generation
+// query interface (see explicator_module_func_query_v2), so each derived form is computed at most once, and only if
+// some module asks for it.
+//
+// Queries are not thread-safe; each is used by a single translation.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Snapshot.h"
+
+class Explicator_Query {
+  public:
+    // The text must already be canonicalized as per Explicator::Translate() (trimmed and upper-cased).
+    explicit Explicator_Query(const std::string &text);
+
+    Explicator_Query(const Explicator_Query &) = delete;
+    Explicator_Query &operator=(const Explicator_Query &) = delete;
+
+    // The query as passed to modules by the original query interface.
+    const std::string &Text(void) const;
+
+    // The text with all whitespace removed (CANONICALIZE::TRIM_ALL).
+    const std::string &Spaceless(void) const;
+
+    // Sorted, unique N-gram codes (see NGram_Codes()) of the text or the spaceless text, for N in [L, U].
+    const std::vector<uint64_t> &NGram_Codes(long int L, long int U) const;
+    const std::vector<uint64_t> &Spaceless_NGram_Codes(long int L, long int U) const;
+
+    // A key derived from the text by the given function, e.g., a phonetic code. Each function is called at most once.
+    const std::string &Key(std::string (*encode)(const std::string &)) const;
+
+    // Restricts modules which honour it to lexicon entries for the given cleans, e.g., a shortlist selected by cheaper
+    // modules (see Explicator::cascade_candidate_limit). By default every clean is a candidate.
+    void Restrict_Candidates(std::vector<std::string> cleans);
+    bool Is_Candidate(const std::string &clean) const;
+
+    // The number of cleans the caller wants (see Explicator::Translate_Top_K()), or zero if it wants all of them.
+    // Modules which honour it need only report their K best cleans, e.g., via Top_K_Cleans.
+    void Set_Top_K(size_t K);
+    size_t Top_K(void) const;
+
+    // The Hamming radius within which modules which support a bounded search look for matches (see
+    // Explicator::dicom_hash_search_radius), or negative (the default) for an exhaustive search.
+    void Set_Search_Radius(long int radius);
+    long int Search_Radius(void) const;
+
+    // A time by which the caller wants a result (see Explicator::Translate()). Modules which honour it check
+    // Past_Deadline() periodically during long scans and stop early when it returns true, which is remembered so the
+    // caller can tell the module's results are incomplete via Interrupted(). Without a deadline, neither is ever true.
+    void Set_Deadline(std::chrono::steady_clock::time_point deadline);
+    bool Has_Deadline(void) const;
+    bool Past_Deadline(void) const;
+    bool Interrupted(void) const;
+    static constexpr size_t Deadline_Check_Interval = 64; // Lexicon entries or clean families visited between checks.
+
+  private:
+    std::string text;
+    mutable std::optional<std::string> spaceless;
+    std::optional<std::vector<std::string>> candidates; // Sorted.
+    size_t top_k = 0;
+    long int search_radius = -1;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    mutable bool interrupted = false;
+
+    // Lists are used so that references handed out remain valid as more forms are computed.
+    struct ngram_codes {
+        long int L;
+        long int U;
+        bool spaceless;
+        std::vector<uint64_t> codes;
+    };
+    mutable std::list<ngram_codes> ngrams;
+    mutable std::list<std::pair<std::string (*)(const std::string &), std::string>> keys;
+
+    const std::vector<uint64_t> &Find_NGram_Codes(long int L, long int U, bool spaceless) const;
+};
+
+// Collects the highest score of each clean which exceeds a threshold, keeping only the K best cleans and any tied with
+// the K-th (or all of them, if K is zero). Once K cleans are held, cleans scoring below the K-th best can no longer be
+// kept, so Could_Keep() can be used to skip candidates early. Cleans which are not kept either scored below the lowest
+// kept score or did not exceed the threshold.
+class Top_K_Cleans {
+  public:
+    Top_K_Cleans(size_t K, float threshold);
+
+    // Whether a clean with the given score would be kept. Cutoff() changes whenever the answer might.
+    bool Could_Keep(float score) const;
+    float Cutoff(void) const;
+
+    void Insert(const std::string &clean, float score);
+
+    std::unique_ptr<std::map<std::string, float>> Release(void);
+
+  private:
+    size_t K;
+    float threshold;
+    float kth_best; // Only meaningful when K cleans are held.
+    std::unique_ptr<std::map<std::string, float>> best;
+    std::set<std::pair<float, std::string>> ranked; // Only used when K is non-zero. Worst first.
+};
+
+// A summary of every dirty string of one clean (a 'family'), computed when a module is initialized. Modules which score
+// each dirty string but keep only the best score of each clean can bound the score of every dirty string in the family
+// at once, and skip the whole family when even the bound would not be kept.
+struct Clean_Family_Summary {
+    size_t min_length = std::numeric_limits<size_t>::max();
+    size_t max_length = 0;
+    uint64_t chars    = 0; // Char_Bit() of every character of every dirty string.
+    std::string prefix;    // The longest prefix shared by every dirty string.
+    size_t count = 0;      // The number of dirty strings.
+
+    static uint64_t Char_Bit(char c);
+
+    void Include(const std::string &dirty);
+
+    // The length in [min_length, max_length] nearest the given length.
+    size_t Nearest_Length(size_t length) const;
+
+    // The number of characters of the text which appear in no dirty string. Each must be edited away, and none can be
+    // common to the text and a dirty string.
+    size_t Absent_Count(const std::string &text) const;
+
+    // The length of the longest run of characters of the text which all appear in some dirty string. No common
+    // substring of the text and a dirty string is longer.
+    size_t Longest_Present_Run(const std::string &text) const;
+
+    // An upper bound on the length of the prefix the text shares with any dirty string.
+    size_t Shared_Prefix_Bound(const std::string &text) const;
+};
+
+// The entries of a lexicon grouped by clean, along with a summary of each group. 'Entry' holds whatever a module keeps
+// for each dirty string; it must be constructible from the dirty string and keep it as 'dirty'.
+struct Clean_Family_Entry {
+    std::string dirty;
+    explicit Clean_Family_Entry(const std::string &d) : dirty(d) {}
+};
+
+template <class Entry> class Clean_Families {
+  public:
+    struct family {
+        std::string clean;
+        Clean_Family_Summary summary;
+        std::vector<Entry> entries; // Sorted by the length of the dirty string.
+
+        // The entries whose dirty string length satisfies 'feasible', which must hold for a single run of lengths
+        // around 'peak' and for none outside it, e.g., a score bound which is highest at that length and falls off
+        // either side of it. The run is found by binary search, so entries outside it are never visited.
+        template <class F>
+        std::pair<typename std::vector<Entry>::const_iterator, typename std::vector<Entry>::const_iterator>
+        Feasible_Window(size_t peak, F feasible) const {
+            const auto mid   = std::lower_bound(this->entries.begin(), this->entries.end(), peak,
+                                                [](const Entry &e, size_t l) -> bool { return e.dirty.size() < l; });
+            const auto first = std::partition_point(this->entries.begin(), mid, [&](const Entry &e) -> bool {
+                return !feasible(e.dirty.size());
+            });
+            const auto last  = std::partition_point(mid, this->entries.end(), [&](const Entry &e) -> bool {
+                return feasible(e.dirty.size());
+            });
+            return {first, last};
+        }
+    };
+
+    class const_iterator {
+      public:
+        explicit const_iterator(typename std::vector<std::shared_ptr<family>>::const_iterator i) : it(i) {}
+        const family &operator*(void) const { return **(this->it); }
+        const family *operator->(void) const { return this->it->get(); }
+        const_iterator &operator++(void) {
+            ++(this->it);
+            return *this;
+        }
+        bool operator==(const const_iterator &rhs) const { return this->it == rhs.it; }
+        bool operator!=(const const_iterator &rhs) const { return this->it != rhs.it; }
+
+      private:
+        typename std::vector<std::shared_ptr<family>>::const_iterator it;
+    };
+
+    Clean_Families() = default;
+    explicit Clean_Families(const std::map<std::string, std::string> &lexicon) {
+        // The lexicon looks like: < dirty : clean >.
+        std::vector<std::pair<std::string, std::string>> by_clean;
+        by_clean.reserve(lexicon.size());
+        for(const auto &p : lexicon) by_clean.emplace_back(p.second, p.first);
+        std::stable_sort(by_clean.begin(), by_clean.end(),
+                         [](const std::pair<std::string, std::string> &A,
+                            const std::pair<std::string, std::string> &B) -> bool {
+                             if(A.first != B.first) return A.first < B.first;
+                             return A.second.size() < B.second.size();
+                         });
+        for(const auto &p : by_clean) {
+            if(this->families.empty() || (this->families.back()->clean != p.first)) {
+                this->families.emplace_back(std::make_shared<family>());
+                this->families.back()->clean = p.first;
+            }
+            this->families.back()->summary.Include(p.second);
+            this->families.back()->entries.emplace_back(p.second);
+        }
+    }
+
+    const_iterator begin(void) const { return const_iterator(this->families.begin()); }
+    const_iterator end(void) const { return const_iterator(this->families.end()); }
+
+    // Copies share families, so copying is cheap. Editing a family shared with another copy first gives this copy its
+    // own, so copies never affect one another.
+    void Add(const std::string &dirty, const std::string &clean) {
+        auto it = this->Find(clean);
+        if((it == this->families.end()) || ((*it)->clean != clean)) {
+            it           = this->families.emplace(it, std::make_shared<family>());
+            (*it)->clean = clean;
+        }
+        auto &f = this->Unshare(*it);
+        f.summary.Include(dirty);
+        const auto e_it = std::upper_bound(f.entries.begin(), f.entries.end(), dirty.size(),
+                                           [](size_t l, const Entry &e) -> bool { return l < e.dirty.size(); });
+        f.entries.emplace(e_it, dirty);
+    }
+
+    void Remove(const std::string &dirty, const std::string &clean) {
+        auto it = this->Find(clean);
+        if((it == this->families.end()) || ((*it)->clean != clean)) return;
+        const auto &shared_entries = (*it)->entries;
+        if(std::none_of(shared_entries.begin(), shared_entries.end(),
+                        [&](const Entry &e) -> bool { return e.dirty == dirty; })) {
+            return;
+        }
+        if(shared_entries.size() == 1) {
+            this->families.erase(it);
+            return;
+        }
+        auto &f         = this->Unshare(*it);
+        const auto e_it = std::find_if(f.entries.begin(), f.entries.end(), [&](const Entry &e) -> bool {
+            return e.dirty == dirty;
+        });
+        f.entries.erase(e_it);
+        f.summary = Clean_Family_Summary();
+        for(const auto &e : f.entries) f.summary.Include(e.dirty);
+    }
+
+    // Writes the families to a lexicon snapshot, or reads them back, so they need not be regrouped from the lexicon.
+    // 'save_entry' writes whatever an entry holds besides its dirty string, and 'load_entry' reads it back and returns
+    // the entry; by default entries hold nothing else. Summaries are recomputed when read. Load throws
+    // std::runtime_error if the families are malformed.
+    template <class F> void Save(explicator_internals::Snapshot_Writer &w, F save_entry) const {
+        w.Put(static_cast<uint64_t>(this->families.size()));
+        for(const auto &f : this->families) {
+            w.Put_String(f->clean);
+            w.Put(static_cast<uint64_t>(f->entries.size()));
+            for(const auto &e : f->entries) {
+                w.Put_String(e.dirty);
+                save_entry(w, e);
+            }
+        }
+    }
+    void Save(explicator_internals::Snapshot_Writer &w) const {
+        this->Save(w, [](explicator_internals::Snapshot_Writer &, const Entry &) -> void {});
+    }
+
+    template <class F> static Clean_Families Load(explicator_internals::Snapshot_Reader &r, F load_entry) {
+        Clean_Families out;
+        out.families.resize(r.Get_Count(2 * sizeof(uint64_t)));
+        for(auto &f : out.families) {
+            f        = std::make_shared<family>();
+            f->clean = r.Get_String();
+            const auto N_entries = r.Get_Count(sizeof(uint64_t));
+            f->entries.reserve(N_entries);
+            for(auto N = N_entries; N != 0; --N) {
+                auto dirty = r.Get_String();
+                if(!f->entries.empty() && (dirty.size() < f->entries.back().dirty.size())) {
+                    throw std::runtime_error("Clean family entries are not sorted by length");
+                }
+                f->summary.Include(dirty);
+                f->entries.emplace_back(load_entry(r, std::move(dirty)));
+            }
+            if(f->entries.empty()) throw std::runtime_error("Clean family is empty");
+        }
+        const auto out_of_order = std::adjacent_find(
+            out.families.begin(), out.families.end(),
+            [](const std::shared_ptr<family> &A, const std::shared_ptr<family> &B) -> bool {
+                return !(A->clean < B->clean);
+            });
+        if(out_of_order != out.families.end()) throw std::runtime_error("Clean families are not sorted by clean");
+        return out;
+    }
+    static Clean_Families Load(explicator_internals::Snapshot_Reader &r) {
+        return Load(r, [](explicator_internals::Snapshot_Reader &, std::string dirty) -> Entry {
+            return Entry(dirty);
+        });
+    }
+
+  private:
+    std::vector<std::shared_ptr<family>> families; // Sorted by clean.
+
+    typename std::vector<std::shared_ptr<family>>::iterator Find(const std::string &clean) {
+        return std::lower_bound(this->families.begin(), this->families.end(), clean,
+                                [](const std::shared_ptr<family> &f, const std::string &c) -> bool {
+                                    return f->clean < c;
+                                });
+    }
+
+    family &Unshare(std::shared_ptr<family> &f) {
+        if(f.use_count() != 1) f = std::make_shared<family>(*f);
+        return *f;
+    }
+};
+
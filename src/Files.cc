@@ -1,7 +1,13 @@
 // YgorFilesDirs.cc - Routines for interacting with files and directories.
 //
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
 #include <fstream>  //Needed for fstream (for file checking.)
+#include <stdexcept>
 #include <string>
 #include <system_error>
 #include <filesystem>
@@ -34,5 +40,58 @@ bool Does_Dir_Exist_And_Can_Be_Read(const std::string &dir) {
         && ((perms & std::filesystem::perms::others_read) != std::filesystem::perms::none);
 }
 
+Mapped_File::Mapped_File(const std::string &filename) {
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("Unable to open file '" + filename + "'");
+    }
+
+    struct stat info;
+    if((::fstat(fd, &info) != 0) || S_ISDIR(info.st_mode)) {
+        ::close(fd);
+        throw std::runtime_error("Unable to read file '" + filename + "'");
+    }
+
+    if(S_ISREG(info.st_mode) && (0 < info.st_size)) {
+        void *m = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if(m != MAP_FAILED) {
+            this->mapping = m;
+            this->length  = static_cast<size_t>(info.st_size);
+            ::madvise(m, this->length, MADV_SEQUENTIAL);
+            ::close(fd);
+            return;
+        }
+    }
+
+    // Fall back to reading the file. This is needed for special files, which report no size and cannot be mapped.
+    char chunk[1 << 16];
+    while(true) {
+        const auto n = ::read(fd, chunk, sizeof(chunk));
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            ::close(fd);
+            throw std::runtime_error("Unable to read file '" + filename + "'");
+        }
+        if(n == 0) break;
+        this->buffer.insert(this->buffer.end(), chunk, chunk + n);
+    }
+    ::close(fd);
+    this->length = this->buffer.size();
+}
+
+Mapped_File::~Mapped_File() {
+    if(this->mapping != nullptr) {
+        ::munmap(this->mapping, this->length);
+    }
+}
+
+const char *Mapped_File::Data(void) const {
+    return (this->mapping != nullptr) ? static_cast<const char *>(this->mapping) : this->buffer.data();
+}
+
+size_t Mapped_File::Size(void) const {
+    return this->length;
+}
+
 } //namespace explicator_internals
 
@@ -2,7 +2,9 @@
 
 #pragma once
 
+#include <stddef.h>
 #include <string>
+#include <vector>
 
 namespace explicator_internals {
 
@@ -12,5 +14,25 @@ bool Does_File_Exist_And_Can_Be_Read(const std::string &filename);
 // Checks if a directory exists and can be read.
 bool Does_Dir_Exist_And_Can_Be_Read(const std::string &dir);
 
+// A read-only view of the entire contents of a file. Regular files are memory-mapped; anything that cannot be mapped
+// (e.g., pipes) is read into memory instead. Throws std::runtime_error if the file cannot be opened or read, or if it is
+// a directory.
+class Mapped_File {
+  public:
+    explicit Mapped_File(const std::string &filename);
+    ~Mapped_File();
+
+    Mapped_File(const Mapped_File &) = delete;
+    Mapped_File &operator=(const Mapped_File &) = delete;
+
+    const char *Data(void) const;
+    size_t Size(void) const;
+
+  private:
+    void *mapping = nullptr;
+    size_t length = 0;
+    std::vector<char> buffer; // Only used when the file could not be mapped.
+};
+
 } //namespace explicator_internals
 
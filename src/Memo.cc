@@ -0,0 +1,247 @@
+// Memo.cc - A persistent, memory-mapped memo of translations.
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+
+#include "Memo.h"
+#include "Misc.h"
+#include "Snapshot.h" //Needed for Snapshot_Checksum().
+
+namespace explicator_internals {
+
+// Memo layout. All values are in the byte order of the host which created the file.
+//
+//    Header (64 bytes):  char[8]   magic ("EXPLMEMO")
+//                        uint32_t  version
+//                        uint32_t  byte order marker (0x01020304)
+//                        uint64_t  number of buckets (a power of two)
+//                        uint64_t  end of the record region (offset of the next record to be written)
+//                        (reserved)
+//    Buckets:            uint64_t  offset of the newest record in each chain, or zero
+//    Records:            uint64_t  offset of the next (older) record in the chain, or zero
+//                        uint64_t  hash of the dirty string
+//                        uint64_t  stamp
+//                        uint64_t  module
+//                        float     score
+//                        uint32_t  length of the dirty string
+//                        uint32_t  length of the clean string
+//                        uint32_t  (padding)
+//                        char[]    dirty string, then clean string, padded to a multiple of 8 bytes
+static const char Memo_Magic[8]         = {'E', 'X', 'P', 'L', 'M', 'E', 'M', 'O'};
+static const uint32_t Memo_Version      = 1;
+static const uint32_t Memo_Byte_Order   = 0x01020304;
+static const size_t Memo_Header_Size    = 64;
+static const size_t Memo_Offset_Buckets = 16;
+static const size_t Memo_Offset_End     = 24;
+static const uint64_t Memo_N_Buckets    = 1 << 16;
+static const size_t Memo_Record_Header  = 48;
+static const size_t Memo_Initial_Data   = 1 << 20;
+
+// Marks a chain which leads past the end of the current mapping, i.e., the file was grown by another process.
+static const uint64_t Beyond_Mapping = std::numeric_limits<uint64_t>::max();
+
+// Words which are written after other processes may be reading the file are accessed atomically.
+static uint64_t Load_Word(const char *p) {
+    return __atomic_load_n(reinterpret_cast<const uint64_t *>(p), __ATOMIC_ACQUIRE);
+}
+
+static void Store_Word(char *p, uint64_t v) {
+    __atomic_store_n(reinterpret_cast<uint64_t *>(p), v, __ATOMIC_RELEASE);
+}
+
+template <class T> static T Read_Field(const char *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+template <class T> static void Write_Field(char *p, const T &v) {
+    std::memcpy(p, &v, sizeof(T));
+}
+
+Translation_Memo::Translation_Memo(const std::string &file_name) : filename(file_name) {
+    this->fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if(this->fd < 0) {
+        throw std::runtime_error("Unable to open memo '" + filename + "': " + std::strerror(errno));
+    }
+
+    // Creation and validation are done while holding the lock, so concurrent creators see a complete header.
+    ::flock(this->fd, LOCK_EX);
+    try {
+        struct stat info;
+        if(::fstat(this->fd, &info) != 0) throw std::runtime_error("Unable to read memo '" + filename + "'");
+        const size_t records_begin = Memo_Header_Size + Memo_N_Buckets * sizeof(uint64_t);
+
+        if(info.st_size == 0) {
+            const size_t new_length = records_begin + Memo_Initial_Data;
+            if(::ftruncate(this->fd, static_cast<off_t>(new_length)) != 0) {
+                throw std::runtime_error("Unable to create memo '" + filename + "': " + std::strerror(errno));
+            }
+            this->Map(new_length);
+            std::memcpy(this->mapping, Memo_Magic, sizeof(Memo_Magic));
+            Write_Field(this->mapping + 8, Memo_Version);
+            Write_Field(this->mapping + 12, Memo_Byte_Order);
+            Write_Field(this->mapping + Memo_Offset_Buckets, Memo_N_Buckets);
+            Store_Word(this->mapping + Memo_Offset_End, records_begin);
+
+        } else {
+            this->Map(static_cast<size_t>(info.st_size));
+            if((this->length < Memo_Header_Size) || (std::memcmp(this->mapping, Memo_Magic, sizeof(Memo_Magic)) != 0)) {
+                throw std::runtime_error("'" + filename + "' is not a translation memo");
+            }
+            if(Read_Field<uint32_t>(this->mapping + 8) != Memo_Version) {
+                throw std::runtime_error("Memo '" + filename + "' was written by an incompatible version");
+            }
+            if(Read_Field<uint32_t>(this->mapping + 12) != Memo_Byte_Order) {
+                throw std::runtime_error("Memo '" + filename + "' was written on a host with a different byte order");
+            }
+            const auto end = Load_Word(this->mapping + Memo_Offset_End);
+            if((Read_Field<uint64_t>(this->mapping + Memo_Offset_Buckets) != Memo_N_Buckets) || (end < records_begin)
+               || (this->length < end)) {
+                throw std::runtime_error("Memo '" + filename + "' is corrupt");
+            }
+        }
+    } catch(const std::exception &) {
+        if(this->mapping != nullptr) ::munmap(this->mapping, this->length);
+        ::close(this->fd);
+        throw;
+    }
+    ::flock(this->fd, LOCK_UN);
+}
+
+Translation_Memo::~Translation_Memo() {
+    if(this->mapping != nullptr) ::munmap(this->mapping, this->length);
+    ::close(this->fd);
+}
+
+void Translation_Memo::Map(size_t new_length) {
+    void *m = ::mmap(nullptr, new_length, PROT_READ | PROT_WRITE, MAP_SHARED, this->fd, 0);
+    if(m == MAP_FAILED) {
+        throw std::runtime_error("Unable to map memo '" + this->filename + "': " + std::strerror(errno));
+    }
+    if(this->mapping != nullptr) ::munmap(this->mapping, this->length);
+    this->mapping = static_cast<char *>(m);
+    this->length  = new_length;
+}
+
+void Translation_Memo::Remap_If_Grown(void) {
+    struct stat info;
+    if(::fstat(this->fd, &info) != 0) return;
+    std::unique_lock<std::shared_mutex> lock(this->mapping_lock);
+    if(this->length < static_cast<size_t>(info.st_size)) this->Map(static_cast<size_t>(info.st_size));
+}
+
+// Returns the offset of the matching record, zero if there is none, or Beyond_Mapping. The mapping must be locked.
+uint64_t Translation_Memo::Find_Offset(const std::string &dirty, uint64_t key_hash, uint64_t stamp) const {
+    const auto bucket = Memo_Header_Size + (key_hash & (Memo_N_Buckets - 1)) * sizeof(uint64_t);
+    for(auto off = Load_Word(this->mapping + bucket); off != 0;) {
+        if(this->length < (off + Memo_Record_Header)) return Beyond_Mapping;
+        const char *rec = this->mapping + off;
+        const auto dirty_length = Read_Field<uint32_t>(rec + 36);
+        const auto clean_length = Read_Field<uint32_t>(rec + 40);
+        if(this->length < (off + Memo_Record_Header + dirty_length + clean_length)) return Beyond_Mapping;
+
+        if((Read_Field<uint64_t>(rec + 8) == key_hash) && (Read_Field<uint64_t>(rec + 16) == stamp)
+           && (dirty_length == dirty.size())
+           && (std::memcmp(rec + Memo_Record_Header, dirty.data(), dirty.size()) == 0)) {
+            return off;
+        }
+        off = Load_Word(rec);
+    }
+    return 0;
+}
+
+bool Translation_Memo::Find(const std::string &dirty, uint64_t stamp, std::string &clean, float &score,
+                            uint64_t &module) {
+    const auto key_hash = Snapshot_Checksum(dirty.data(), dirty.size());
+    for(int attempt = 0; attempt < 2; ++attempt) {
+        {
+            std::shared_lock<std::shared_mutex> lock(this->mapping_lock);
+            const auto off = this->Find_Offset(dirty, key_hash, stamp);
+            if(off == 0) break;
+            if(off != Beyond_Mapping) {
+                const char *rec = this->mapping + off;
+                module          = Read_Field<uint64_t>(rec + 24);
+                score           = Read_Field<float>(rec + 32);
+                clean.assign(rec + Memo_Record_Header + dirty.size(), Read_Field<uint32_t>(rec + 40));
+                this->hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        this->Remap_If_Grown();
+    }
+    this->misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void Translation_Memo::Insert(const std::string &dirty, uint64_t stamp, const std::string &clean, float score,
+                              uint64_t module) {
+    if((std::numeric_limits<uint32_t>::max() < dirty.size()) || (std::numeric_limits<uint32_t>::max() < clean.size())) {
+        return;
+    }
+    const auto key_hash = Snapshot_Checksum(dirty.data(), dirty.size());
+    const auto size     = (Memo_Record_Header + dirty.size() + clean.size() + 7) & ~static_cast<size_t>(7);
+
+    // Threads in this process share the file description, so flock() alone does not serialize them.
+    std::lock_guard<std::mutex> append_guard(this->append_lock);
+    ::flock(this->fd, LOCK_EX);
+    this->Remap_If_Grown();
+
+    {
+        std::shared_lock<std::shared_mutex> lock(this->mapping_lock);
+        if(this->Find_Offset(dirty, key_hash, stamp) != 0) {
+            ::flock(this->fd, LOCK_UN);
+            return;
+        }
+    }
+
+    // Grow the file if needed. Other processes notice the growth when they follow a record past their mapping.
+    const auto end = Load_Word(this->mapping + Memo_Offset_End);
+    if(this->length < (end + size)) {
+        const auto new_length = EXPLICATORMAX(2 * this->length, end + size);
+        try {
+            if(::ftruncate(this->fd, static_cast<off_t>(new_length)) != 0) {
+                throw std::runtime_error(std::strerror(errno));
+            }
+            std::unique_lock<std::shared_mutex> lock(this->mapping_lock);
+            this->Map(new_length);
+        } catch(const std::exception &e) {
+            FUNCEXPLICATORWARN("Unable to grow memo '" << this->filename << "': " << e.what());
+            ::flock(this->fd, LOCK_UN);
+            return;
+        }
+    }
+
+    // Write the record, then claim its space, then link it into its chain. If the process dies part-way, the record is
+    // either overwritten by the next insertion or harmlessly unreachable.
+    std::shared_lock<std::shared_mutex> lock(this->mapping_lock);
+    const auto bucket = Memo_Header_Size + (key_hash & (Memo_N_Buckets - 1)) * sizeof(uint64_t);
+    char *rec         = this->mapping + end;
+    Write_Field(rec, Load_Word(this->mapping + bucket));
+    Write_Field(rec + 8, key_hash);
+    Write_Field(rec + 16, stamp);
+    Write_Field(rec + 24, module);
+    Write_Field(rec + 32, score);
+    Write_Field(rec + 36, static_cast<uint32_t>(dirty.size()));
+    Write_Field(rec + 40, static_cast<uint32_t>(clean.size()));
+    Write_Field(rec + 44, static_cast<uint32_t>(0));
+    std::memcpy(rec + Memo_Record_Header, dirty.data(), dirty.size());
+    std::memcpy(rec + Memo_Record_Header + dirty.size(), clean.data(), clean.size());
+    Store_Word(this->mapping + Memo_Offset_End, end + size);
+    Store_Word(this->mapping + bucket, end);
+    ::flock(this->fd, LOCK_UN);
+}
+
+} //namespace explicator_internals
@@ -0,0 +1,57 @@
+// Memo.h - A persistent, memory-mapped memo of translations.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+
+namespace explicator_internals {
+
+// A hash table of <dirty, stamp> -> <clean, score, module> stored in a memory-mapped file, so translations can be
+// reused across runs and shared between processes. The stamp identifies the lexicon contents and settings which
+// produced the translation; entries with other stamps are simply never matched.
+//
+// The file holds a header, a fixed array of buckets, and a region of records which is only ever appended to. Each
+// bucket holds the offset of the most recently added record in its chain. A record is fully written before it is
+// linked into its chain, so readers never need a lock, and writers (in any process) serialize via flock(). The file
+// grows as needed. Stale entries are not reclaimed; delete the file to compact it.
+//
+// Files are tied to the byte order of the host which created them. Throws std::runtime_error if the file cannot be
+// opened or created, or if it is not a compatible memo.
+class Translation_Memo {
+  public:
+    explicit Translation_Memo(const std::string &filename);
+    ~Translation_Memo();
+
+    Translation_Memo(const Translation_Memo &) = delete;
+    Translation_Memo &operator=(const Translation_Memo &) = delete;
+
+    // Both may be called concurrently from multiple threads.
+    bool Find(const std::string &dirty, uint64_t stamp, std::string &clean, float &score, uint64_t &module);
+    void Insert(const std::string &dirty, uint64_t stamp, const std::string &clean, float score, uint64_t module);
+
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+
+  private:
+    std::string filename;
+    int fd        = -1;
+    char *mapping = nullptr;
+    size_t length = 0;
+
+    // Shared for reading the mapping, exclusive for remapping it.
+    std::shared_mutex mapping_lock;
+
+    // Serializes insertions within this process. Insertions from other processes are serialized with flock().
+    std::mutex append_lock;
+
+    void Map(size_t new_length);
+    void Remap_If_Grown(void);
+    uint64_t Find_Offset(const std::string &dirty, uint64_t key_hash, uint64_t stamp) const;
+};
+
+} //namespace explicator_internals
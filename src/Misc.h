@@ -115,3 +115,21 @@
 #ifndef BITMASK_BITS_ARE_SET
 #define BITMASK_BITS_ARE_SET(A, BITMASK) ((A & BITMASK) == BITMASK)
 #endif
+
+// Counts the number of set bits in a 64-bit word. Compilers which provide a builtin will typically emit a single
+// instruction (when permitted by the target architecture), which is what makes packed bit-set comparisons cheap.
+//
+// For example: EXPLICATORPOPCOUNT(0b1011) == 3.
+//
+#ifndef EXPLICATORPOPCOUNT
+#if defined(__GNUC__) || defined(__clang__)
+#define EXPLICATORPOPCOUNT(X) (__builtin_popcountll(static_cast<unsigned long long>(X)))
+#else
+inline int Explicator_Popcount_Fallback(unsigned long long x) {
+    int n = 0;
+    for(; x != 0; x &= (x - 1)) ++n;
+    return n;
+}
+#define EXPLICATORPOPCOUNT(X) (Explicator_Popcount_Fallback(static_cast<unsigned long long>(X)))
+#endif
+#endif
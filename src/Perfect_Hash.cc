@@ -0,0 +1,194 @@
+// Perfect_Hash.cc - A minimal perfect hash index of a lexicon's dirty strings.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Perfect_Hash.h"
+#include "Snapshot.h"
+
+namespace explicator_internals {
+
+// The finalizer of MurmurHash3, which scrambles every bit of the input into every bit of the output.
+static uint64_t Mix(uint64_t x) {
+    x ^= (x >> 33);
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= (x >> 33);
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= (x >> 33);
+    return x;
+}
+
+// Hashes eight bytes at a time. The length is mixed in first so that trailing zero bytes are not ignored.
+static uint64_t Hash(std::string_view s, uint64_t seed) {
+    uint64_t h = Mix(seed ^ (static_cast<uint64_t>(s.size()) * 0x9e3779b97f4a7c15ULL));
+    size_t i   = 0;
+    for(; (i + 8) <= s.size(); i += 8) {
+        uint64_t w;
+        std::memcpy(&w, s.data() + i, 8);
+        h = Mix(h ^ w);
+    }
+    if(i < s.size()) {
+        uint64_t w = 0;
+        std::memcpy(&w, s.data() + i, s.size() - i);
+        h = Mix(h ^ w);
+    }
+    return h;
+}
+
+size_t Exact_Index::Bucket(uint64_t h) const {
+    return static_cast<size_t>((h >> 32) % this->displacements.size());
+}
+
+size_t Exact_Index::Slot(uint64_t h, uint32_t displacement) const {
+    return static_cast<size_t>(Mix(h + static_cast<uint64_t>(displacement) * 0x9e3779b97f4a7c15ULL)
+                               % this->cleans.size());
+}
+
+Exact_Index::Exact_Index(const std::map<std::string, std::string> &lexicon) {
+    const size_t N = lexicon.size();
+    if(N == 0) return;
+    if(std::numeric_limits<uint32_t>::max() <= N) {
+        throw std::invalid_argument("Lexicon is too large to index");
+    }
+
+    std::vector<const std::pair<const std::string, std::string> *> entries;
+    entries.reserve(N);
+    size_t key_bytes = 0;
+    for(const auto &p : lexicon) {
+        entries.push_back(&p);
+        key_bytes += p.first.size();
+    }
+    if(std::numeric_limits<uint32_t>::max() <= key_bytes) {
+        throw std::invalid_argument("Lexicon is too large to index");
+    }
+
+    // About four keys per bucket keeps the index small while most buckets are still easy to place. Slots are only
+    // assigned once every bucket has been placed, so Slot() can rely on the number of cleans.
+    this->displacements.assign((N + 3) / 4, 0);
+    this->cleans.resize(N);
+
+    std::vector<uint64_t> hashes(N);
+    std::vector<uint32_t> slot_of(N);
+    std::vector<bool> taken(N);
+    std::vector<std::vector<uint32_t>> buckets(this->displacements.size());
+    std::vector<uint32_t> order(buckets.size());
+    std::vector<size_t> slots;
+
+    // Each displacement is tried in turn. The last buckets to be placed usually hold a single key and have only a few
+    // free slots to land in, so many may be needed. If a bucket cannot be placed (e.g., because two of its keys have
+    // identical hashes) everything is retried with another seed.
+    const uint64_t max_displacement
+        = std::min<uint64_t>(16 * static_cast<uint64_t>(N) + 1024, std::numeric_limits<uint32_t>::max());
+    for(uint64_t attempt = 0;; ++attempt) {
+        this->seed = Mix(attempt + 1);
+        for(auto &b : buckets) b.clear();
+        for(size_t i = 0; i < N; ++i) {
+            hashes[i] = Hash(entries[i]->first, this->seed);
+            buckets[this->Bucket(hashes[i])].push_back(static_cast<uint32_t>(i));
+        }
+        for(size_t b = 0; b < order.size(); ++b) order[b] = static_cast<uint32_t>(b);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t A, uint32_t B) -> bool { return buckets[B].size() < buckets[A].size(); });
+        std::fill(taken.begin(), taken.end(), false);
+
+        bool placed_all = true;
+        for(const auto b : order) {
+            const auto &keys = buckets[b];
+            if(keys.empty()) break;
+
+            bool placed = false;
+            for(uint64_t d = 0; !placed && (d <= max_displacement); ++d) {
+                slots.clear();
+                placed = true;
+                for(const auto k : keys) {
+                    const auto slot = this->Slot(hashes[k], static_cast<uint32_t>(d));
+                    if(taken[slot] || (std::find(slots.begin(), slots.end(), slot) != slots.end())) {
+                        placed = false;
+                        break;
+                    }
+                    slots.push_back(slot);
+                }
+                if(!placed) continue;
+                this->displacements[b] = static_cast<uint32_t>(d);
+                for(size_t j = 0; j < keys.size(); ++j) {
+                    taken[slots[j]]  = true;
+                    slot_of[keys[j]] = static_cast<uint32_t>(slots[j]);
+                }
+            }
+            if(!placed) {
+                placed_all = false;
+                break;
+            }
+        }
+        if(placed_all) break;
+    }
+
+    // Lay out the keys and cleans in slot order.
+    std::vector<uint32_t> key_of(N);
+    for(size_t i = 0; i < N; ++i) key_of[slot_of[i]] = static_cast<uint32_t>(i);
+    this->key_offsets.reserve(N + 1);
+    this->keys.reserve(key_bytes);
+    for(size_t s = 0; s < N; ++s) {
+        this->key_offsets.push_back(static_cast<uint32_t>(this->keys.size()));
+        this->keys.append(entries[key_of[s]]->first);
+        this->cleans[s] = entries[key_of[s]]->second;
+    }
+    this->key_offsets.push_back(static_cast<uint32_t>(this->keys.size()));
+}
+
+const std::string *Exact_Index::Find(std::string_view dirty) const {
+    if(this->cleans.empty()) return nullptr;
+    const uint64_t h    = Hash(dirty, this->seed);
+    const size_t slot   = this->Slot(h, this->displacements[this->Bucket(h)]);
+    const uint32_t pos  = this->key_offsets[slot];
+    const size_t length = this->key_offsets[slot + 1] - pos;
+    if((length != dirty.size()) || (std::memcmp(this->keys.data() + pos, dirty.data(), length) != 0)) return nullptr;
+    return &(this->cleans[slot]);
+}
+
+size_t Exact_Index::Size(void) const {
+    return this->cleans.size();
+}
+
+void Exact_Index::Save(Snapshot_Writer &w, const std::map<std::string, uint32_t> &clean_ids) const {
+    w.Put(this->seed);
+    w.Put_Vector(this->displacements);
+    w.Put_Vector(this->key_offsets);
+    w.Put_String(this->keys);
+    w.Put(static_cast<uint64_t>(this->cleans.size()));
+    for(const auto &clean : this->cleans) w.Put(clean_ids.at(clean));
+}
+
+Exact_Index Exact_Index::Load(Snapshot_Reader &r, const std::vector<std::string> &clean_table) {
+    Exact_Index out;
+    out.seed          = r.Get<uint64_t>();
+    out.displacements = r.Get_Vector<uint32_t>();
+    out.key_offsets   = r.Get_Vector<uint32_t>();
+    out.keys          = r.Get_String();
+    out.cleans.resize(r.Get_Count(sizeof(uint32_t)));
+    for(auto &clean : out.cleans) {
+        const auto clean_id = r.Get<uint32_t>();
+        if(clean_table.size() <= clean_id) throw std::runtime_error("Exact-match index has an invalid clean ID");
+        clean = clean_table[clean_id];
+    }
+
+    // Find() indexes the displacements and key offsets without checking them.
+    const size_t N = out.cleans.size();
+    const bool consistent
+        = (N == 0) ? (out.displacements.empty() && out.key_offsets.empty() && out.keys.empty())
+                   : ((out.displacements.size() == ((N + 3) / 4)) && (out.key_offsets.size() == (N + 1))
+                      && (out.key_offsets.front() == 0) && (out.key_offsets.back() == out.keys.size())
+                      && std::is_sorted(out.key_offsets.begin(), out.key_offsets.end()));
+    if(!consistent) throw std::runtime_error("Exact-match index is malformed");
+    return out;
+}
+
+} //namespace explicator_internals
@@ -0,0 +1,51 @@
+// Perfect_Hash.h - A minimal perfect hash index of a lexicon's dirty strings.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace explicator_internals {
+
+class Snapshot_Writer; // See Snapshot.h.
+class Snapshot_Reader;
+
+// Maps each dirty string of a lexicon to its clean using a minimal perfect hash built in the 'hash and displace' style
+// (CHD). Keys are hashed into buckets of a few keys each, and each bucket is given the smallest displacement which
+// places all of its keys in distinct free slots, largest buckets first. There are exactly as many slots as keys, so a
+// lookup costs one hash of the query, a cheap rehash to find its slot, and a single comparison against the key stored
+// there, regardless of the lexicon's size.
+//
+// The index holds copies of the keys and cleans, so it does not refer to the lexicon once built. It is immutable, and
+// may be queried concurrently from multiple threads.
+class Exact_Index {
+  public:
+    Exact_Index() = default;
+    explicit Exact_Index(const std::map<std::string, std::string> &lexicon);
+
+    // Returns the clean of the given dirty string, or nullptr if it is not in the lexicon.
+    const std::string *Find(std::string_view dirty) const;
+
+    size_t Size(void) const;
+
+    // Writes the index to a lexicon snapshot, or reads one back. Cleans are stored as IDs into the snapshot's table of
+    // unique cleans. Load throws std::runtime_error if the index is malformed.
+    void Save(Snapshot_Writer &w, const std::map<std::string, uint32_t> &clean_ids) const;
+    static Exact_Index Load(Snapshot_Reader &r, const std::vector<std::string> &clean_table);
+
+  private:
+    uint64_t seed = 0;
+    std::vector<uint32_t> displacements; // One per bucket.
+    std::vector<uint32_t> key_offsets;   // Slot i's key is keys[key_offsets[i], key_offsets[i+1]).
+    std::string keys;
+    std::vector<std::string> cleans; // One per slot.
+
+    size_t Bucket(uint64_t h) const;
+    size_t Slot(uint64_t h, uint32_t displacement) const;
+};
+
+} //namespace explicator_internals
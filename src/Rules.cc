@@ -0,0 +1,191 @@
+// Rules.cc - Compiled rule cascades.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Rules.h"
+
+namespace explicator_internals {
+
+static std::string Trim_Spaces(const std::string &in) {
+    const auto first = in.find_first_not_of(" \t");
+    if(first == std::string::npos) return "";
+    const auto last = in.find_last_not_of(" \t");
+    return in.substr(first, last - first + 1);
+}
+
+static std::vector<std::string> Split_On(const std::string &in, char sep) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while(true) {
+        const auto pos = in.find(sep, start);
+        out.push_back(Trim_Spaces(in.substr(start, pos - start)));
+        if(pos == std::string::npos) break;
+        start = pos + 1;
+    }
+    return out;
+}
+
+Rule_Cascade::Rule_Cascade(const std::vector<std::pair<std::string, std::string>> &rules) {
+    // Parse the rules, assigning each distinct pattern an index.
+    std::map<std::string, uint32_t> pattern_index;
+    std::vector<std::vector<std::vector<uint32_t>>> parsed; // rule -> clause -> atom indices.
+    for(const auto &r : rules) {
+        this->outputs.push_back(r.first);
+        parsed.emplace_back();
+        for(const auto &clause : Split_On(r.second, '&')) {
+            parsed.back().emplace_back();
+            for(auto text : Split_On(clause, '|')) {
+                atom a = {atom_kind::contains, 0};
+                if(!text.empty() && (text.front() == '@')) {
+                    const auto colon = text.find(':');
+                    if((colon == std::string::npos) || (colon == 1)) {
+                        throw std::invalid_argument("Unable to parse positional atom '" + text + "'");
+                    }
+                    a.kind     = atom_kind::at;
+                    a.position = std::stol(text.substr(1, colon - 1));
+                    text       = text.substr(colon + 1);
+                } else if(!text.empty() && (text.front() == '^')) {
+                    a.kind = atom_kind::prefix;
+                    text   = text.substr(1);
+                } else if(!text.empty() && (text.back() == '$')) {
+                    a.kind = atom_kind::suffix;
+                    text.pop_back();
+                }
+                if(text.empty()) {
+                    throw std::invalid_argument("Rule '" + r.second + "' contains an empty pattern");
+                }
+
+                auto p_it = pattern_index.find(text);
+                if(p_it == pattern_index.end()) {
+                    p_it = pattern_index.emplace(text, static_cast<uint32_t>(this->patterns.size())).first;
+                    this->patterns.push_back(text);
+                    this->pattern_atoms.emplace_back();
+                }
+                const auto atom_id = static_cast<uint32_t>(this->atom_count++);
+                this->pattern_atoms[p_it->second].emplace_back(a, atom_id);
+                parsed.back().back().push_back(atom_id);
+            }
+        }
+    }
+
+    // Convert the clauses into bitmasks over atoms.
+    this->words_per_mask = (this->atom_count + 64) / 64; // Always at least one word.
+    for(const auto &r : parsed) {
+        this->rule_clauses.push_back(this->clause_masks.size() / this->words_per_mask);
+        for(const auto &clause : r) {
+            const auto offset = this->clause_masks.size();
+            this->clause_masks.resize(offset + this->words_per_mask, 0);
+            for(const auto id : clause) this->clause_masks[offset + id / 64] |= (static_cast<uint64_t>(1) << (id % 64));
+        }
+    }
+    this->rule_clauses.push_back(this->clause_masks.size() / this->words_per_mask);
+
+    // Build the compact alphabet.
+    for(const auto &p : this->patterns) {
+        for(const char c : p) {
+            auto &cc = this->char_class[static_cast<unsigned char>(c)];
+            if(cc == 0) cc = static_cast<uint8_t>(this->alphabet_size++);
+        }
+    }
+
+    // Build the trie.
+    const auto A = this->alphabet_size;
+    const uint32_t none = static_cast<uint32_t>(-1);
+    this->gotos.assign(A, none);
+    this->node_outputs.emplace_back();
+    for(size_t p = 0; p < this->patterns.size(); ++p) {
+        uint32_t node = 0;
+        for(const char c : this->patterns[p]) {
+            const auto cc = this->char_class[static_cast<unsigned char>(c)];
+            if(this->gotos[node * A + cc] == none) {
+                this->gotos[node * A + cc] = static_cast<uint32_t>(this->node_outputs.size());
+                this->node_outputs.emplace_back();
+                this->gotos.resize(this->gotos.size() + A, none);
+            }
+            node = this->gotos[node * A + cc];
+        }
+        this->node_outputs[node].push_back(static_cast<uint32_t>(p));
+    }
+
+    // Compute failure links breadth-first, converting the trie into a complete transition table.
+    std::vector<uint32_t> fail(this->node_outputs.size(), 0);
+    std::deque<uint32_t> queue;
+    for(size_t c = 0; c < A; ++c) {
+        auto &g = this->gotos[c];
+        if(g == none) {
+            g = 0;
+        } else {
+            fail[g] = 0;
+            queue.push_back(g);
+        }
+    }
+    while(!queue.empty()) {
+        const auto node = queue.front();
+        queue.pop_front();
+        const auto &inherited = this->node_outputs[fail[node]];
+        this->node_outputs[node].insert(this->node_outputs[node].end(), inherited.begin(), inherited.end());
+        for(size_t c = 0; c < A; ++c) {
+            auto &g = this->gotos[node * A + c];
+            if(g == none) {
+                g = this->gotos[fail[node] * A + c];
+            } else {
+                fail[g] = this->gotos[fail[node] * A + c];
+                queue.push_back(g);
+            }
+        }
+    }
+}
+
+long int Rule_Cascade::Match(const std::string &in) const {
+    if(this->outputs.empty()) return -1;
+
+    // Make a single pass over the string, marking the atoms which are satisfied by each pattern occurrence.
+    std::vector<uint64_t> satisfied(this->words_per_mask, 0);
+    const auto A    = this->alphabet_size;
+    const auto N    = static_cast<long int>(in.size());
+    uint32_t node   = 0;
+    for(long int i = 0; i < N; ++i) {
+        node = this->gotos[node * A + this->char_class[static_cast<unsigned char>(in[i])]];
+        for(const auto p : this->node_outputs[node]) {
+            const long int end   = i + 1;
+            const long int start = end - static_cast<long int>(this->patterns[p].size());
+            for(const auto &a : this->pattern_atoms[p]) {
+                const bool ok = (a.first.kind == atom_kind::contains)
+                                || ((a.first.kind == atom_kind::prefix) && (start == 0))
+                                || ((a.first.kind == atom_kind::suffix) && (end == N))
+                                || ((a.first.kind == atom_kind::at) && (start == a.first.position));
+                if(ok) satisfied[a.second / 64] |= (static_cast<uint64_t>(1) << (a.second % 64));
+            }
+        }
+    }
+
+    // Find the first rule for which every clause has a satisfied atom.
+    const auto W = this->words_per_mask;
+    for(size_t r = 0; (r + 1) < this->rule_clauses.size(); ++r) {
+        bool all = true;
+        for(size_t c = this->rule_clauses[r]; all && (c < this->rule_clauses[r + 1]); ++c) {
+            bool any = false;
+            for(size_t w = 0; w < W; ++w) any = any || ((this->clause_masks[c * W + w] & satisfied[w]) != 0);
+            all = any;
+        }
+        if(all) return static_cast<long int>(r);
+    }
+    return -1;
+}
+
+const std::string &Rule_Cascade::Output(long int rule) const {
+    return this->outputs.at(static_cast<size_t>(rule));
+}
+
+size_t Rule_Cascade::Size(void) const {
+    return this->outputs.size();
+}
+
+} //namespace explicator_internals
@@ -0,0 +1,70 @@
+// Rules.h - Compiled rule cascades.
+
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace explicator_internals {
+
+// A rule cascade maps a string to the output of the first (i.e., highest-priority) rule which the string satisfies.
+// Rules are provided as data, so new domain-specific rule sets can be added without writing new matching code.
+//
+// Each rule is a conjunction of clauses separated by '&'. Each clause is a disjunction of atoms separated by '|'.
+// Whitespace around separators is ignored. Atoms are:
+//
+//    PAT       The string contains PAT anywhere.
+//    ^PAT      The string begins with PAT.
+//    PAT$      The string ends with PAT.
+//    @N:PAT    PAT occurs beginning at (zero-based) position N.
+//
+// For example, "^L|@3:L & SUB" is satisfied by "LSUBMAND" and "RT_L_SUB" but not "RSUB".
+//
+// All patterns are compiled into a single Aho-Corasick automaton, so matching makes a single pass over the string and
+// the cost does not grow with the number of rules (aside from a few bitwise operations per rule).
+class Rule_Cascade {
+  public:
+    Rule_Cascade() = default;
+
+    // Rules are <output, rule> pairs in priority order. Throws std::invalid_argument if a rule cannot be parsed.
+    explicit Rule_Cascade(const std::vector<std::pair<std::string, std::string>> &rules);
+
+    // Returns the index of the first rule satisfied by the string, or -1 if no rules are satisfied.
+    long int Match(const std::string &in) const;
+
+    // Returns the output associated with a rule.
+    const std::string &Output(long int rule) const;
+
+    size_t Size(void) const;
+
+  private:
+    enum class atom_kind { contains, prefix, suffix, at };
+    struct atom {
+        atom_kind kind;
+        long int position; // Only used for atom_kind::at.
+    };
+
+    std::vector<std::string> outputs;
+
+    // Atoms, indexed by pattern. Each atom is identified by its position in a flattened list.
+    std::vector<std::vector<std::pair<atom, uint32_t>>> pattern_atoms; // pattern -> <atom, atom index>.
+    std::vector<std::string> patterns;
+    size_t atom_count = 0;
+
+    // Clauses are bitmasks over atoms, stored in words_per_mask words. Rule r owns clauses [rule_clauses[r],
+    // rule_clauses[r+1]).
+    size_t words_per_mask = 0;
+    std::vector<uint64_t> clause_masks;
+    std::vector<size_t> rule_clauses;
+
+    // The Aho-Corasick automaton. Bytes are mapped to a compact alphabet of the characters appearing in patterns (plus
+    // one class for all other characters), and node n's transition on class c is gotos[n * alphabet_size + c].
+    uint8_t char_class[256] = {};
+    size_t alphabet_size    = 1;
+    std::vector<uint32_t> gotos;
+    std::vector<std::vector<uint32_t>> node_outputs; // Patterns which end at each node (including via suffix links).
+};
+
+} //namespace explicator_internals
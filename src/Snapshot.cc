@@ -0,0 +1,29 @@
+// Snapshot.cc - Binary serialization helpers for lexicon snapshots.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstring>
+
+#include "Snapshot.h"
+
+namespace explicator_internals {
+
+uint64_t Snapshot_Checksum(const char *data, size_t size) {
+    // The bulk of the data is mixed in 64-bit words, which is considerably faster than mixing single bytes.
+    uint64_t h = 14695981039346656037ULL;
+    size_t i   = 0;
+    for(; (i + 8) <= size; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, data + i, 8);
+        h ^= w;
+        h *= 1099511628211ULL;
+        h ^= (h >> 29);
+    }
+    for(; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+} //namespace explicator_internals
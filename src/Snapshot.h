@@ -0,0 +1,92 @@
+// Snapshot.h - Binary serialization helpers for lexicon snapshots.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace explicator_internals {
+
+// Appends values to a binary blob. Values are stored in native byte order; snapshots record the byte order of the host
+// that wrote them and are rejected by hosts with a different byte order.
+class Snapshot_Writer {
+  public:
+    std::string blob;
+
+    template <class T> void Put(const T &v) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written directly");
+        this->blob.append(reinterpret_cast<const char *>(&v), sizeof(T));
+    }
+
+    void Put_String(const std::string &s) {
+        this->Put(static_cast<uint64_t>(s.size()));
+        this->blob.append(s);
+    }
+
+    template <class T> void Put_Vector(const std::vector<T> &v) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be written directly");
+        this->Put(static_cast<uint64_t>(v.size()));
+        if(!v.empty()) this->blob.append(reinterpret_cast<const char *>(v.data()), v.size() * sizeof(T));
+    }
+};
+
+// Reads values sequentially from a blob without copying it. Throws std::runtime_error if the blob is too short.
+class Snapshot_Reader {
+  public:
+    Snapshot_Reader(const char *data, size_t size) : cur(data), end(data + size) {}
+    explicit Snapshot_Reader(const std::string &blob) : Snapshot_Reader(blob.data(), blob.size()) {}
+
+    template <class T> T Get(void) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read directly");
+        T v;
+        std::memcpy(&v, this->Take(sizeof(T)), sizeof(T));
+        return v;
+    }
+
+    std::string Get_String(void) {
+        const auto N = this->Get_Count(1);
+        return std::string(this->Take(N), N);
+    }
+
+    template <class T> std::vector<T> Get_Vector(void) {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be read directly");
+        const auto N = this->Get_Count(sizeof(T));
+        std::vector<T> v(N);
+        if(N != 0) std::memcpy(v.data(), this->Take(N * sizeof(T)), N * sizeof(T));
+        return v;
+    }
+
+    // Reads an element count, verifying that at least that many elements of the given size could follow.
+    size_t Get_Count(size_t element_size) {
+        const auto N = this->Get<uint64_t>();
+        if((element_size != 0) && ((static_cast<uint64_t>(this->end - this->cur) / element_size) < N)) {
+            throw std::runtime_error("Snapshot is truncated");
+        }
+        return static_cast<size_t>(N);
+    }
+
+    bool Empty(void) const {
+        return this->cur == this->end;
+    }
+
+  private:
+    const char *cur;
+    const char *end;
+
+    const char *Take(size_t N) {
+        if(static_cast<size_t>(this->end - this->cur) < N) throw std::runtime_error("Snapshot is truncated");
+        const char *out = this->cur;
+        this->cur += N;
+        return out;
+    }
+};
+
+// A 64-bit FNV-1a-style checksum, used to detect corrupted snapshots. It is not cryptographically secure.
+uint64_t Snapshot_Checksum(const char *data, size_t size);
+
+} //namespace explicator_internals
@@ -1,18 +1,26 @@
 // String.cc.
 
 #include <stddef.h>
+#include <stdint.h>
 #include <algorithm> //Needed for set_intersection(..), reverse().
-// For Canonicalization function.
-#include <cctype> //Needed for locale-less ::toupper().
+#include <array>
 #include <iostream>
 #include <iterator>
 #include <map>
 #include <memory>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
 #include "Misc.h"   //Needed for error functions (for debugging) and isininc macro.
+#include "Snapshot.h"
 #include "String.h" //Includes namespace constants, function decl.'s, etc..
 
 namespace explicator_internals {
@@ -27,6 +35,9 @@ namespace explicator_internals {
 // To have N-grams which WOULD cross whitespace (but still ignore it,) one will need to move the internal
 // while loop outside of the outer loop for these routines (but it shouldn't be too difficult to adjust!)
 //
+// NOTE: These routines originally split words with std::istream >>. When the string ends with whitespace, the final
+// (failed) extraction left the previous word in place and it was processed a second time. Character N-grams were not
+// affected (the word had already been consumed), but word N-grams were. This behaviour is reproduced below.
 std::map<std::string, float> NGrams_With_Occurence(const std::string &thestring,
                                                    long int numb_of_ngrams,
                                                    long int length_of_ngrams,
@@ -36,34 +47,33 @@ std::map<std::string, float> NGrams_With_Occurence(const std::string &thestring,
     // output upon truncation.
     std::map<std::string, float> output;
     long int ngrams_generated = 0;
-    std::stringstream inss(thestring);
-    std::string theword;
-    while(inss.good()) {
-        inss >> theword;
-
+    size_t pos                = 0;
+    std::string_view theword;
+    bool repeat_last = false;
+    while(repeat_last || Next_Word(thestring, pos, theword)) {
         if((type & NGRAMS::CHARS) == NGRAMS::CHARS) { // Character N-grams. These are of a (user) specified length.
-            while(static_cast<long int>(theword.size()) >= length_of_ngrams) {
+            for(size_t k = 0; (0 < length_of_ngrams) && ((k + static_cast<size_t>(length_of_ngrams)) <= theword.size()); ++k) {
                 if((ngrams_generated >= numb_of_ngrams) && (numb_of_ngrams != -1)) {
                     return output;
                 }
-
-                // Push back the current Ngram. Remove the first character for the next cycle.
                 ++ngrams_generated;
-                output[theword.substr(0, length_of_ngrams)] += 1.0f;
-                theword.erase(theword.begin());
+                output[std::string(theword.substr(k, length_of_ngrams))] += 1.0f;
             }
 
         } else if((type & NGRAMS::WORDS)
                   == NGRAMS::WORDS) { // Word N-grams. These are NOT of a (user) specified length.
             if(ngrams_generated <= numb_of_ngrams) {
                 if(theword.size() > 0) {
-                    output[theword] += 1.0f;
+                    output[std::string(theword)] += 1.0f;
                     ++ngrams_generated;
                 }
             } else {
                 return output;
             }
         }
+        if(repeat_last) break;
+        repeat_last = ((type & NGRAMS::CHARS) != NGRAMS::CHARS) && (pos < thestring.size())
+                      && (thestring.find_first_not_of(" \t\n\v\f\r", pos) == std::string::npos);
     }
     return output;
 }
@@ -77,27 +87,23 @@ NGrams(const std::string &thestring, long int numb_of_ngrams, long int length_of
     // output upon truncation.
     std::set<std::string> output;
     long int ngrams_generated = 0;
-    std::stringstream inss(thestring);
-    std::string theword;
-    while(inss.good()) {
-        inss >> theword;
+    size_t pos                = 0;
+    std::string_view theword;
+    while(Next_Word(thestring, pos, theword)) {
         if((type & NGRAMS::CHARS) == NGRAMS::CHARS) { // Character N-grams. These are of a (user) specified length.
-            while(static_cast<long int>(theword.size()) >= length_of_ngrams) {
+            for(size_t k = 0; (0 < length_of_ngrams) && ((k + static_cast<size_t>(length_of_ngrams)) <= theword.size()); ++k) {
                 if((ngrams_generated >= numb_of_ngrams) && (numb_of_ngrams != -1)) {
                     return output;
                 }
-
-                // Push back the current Ngram. Remove the first character for the next cycle.
                 ++ngrams_generated;
-                output.insert(theword.substr(0, length_of_ngrams));
-                theword.erase(theword.begin());
+                output.emplace(theword.substr(k, length_of_ngrams));
             }
 
         } else if((type & NGRAMS::WORDS)
                   == NGRAMS::WORDS) { // Word N-grams. These are NOT of a (user) specified length.
             if(ngrams_generated <= numb_of_ngrams) {
                 if(theword.size() > 0) {
-                    output.insert(theword);
+                    output.emplace(theword);
                     ++ngrams_generated;
                 }
             } else {
@@ -108,6 +114,32 @@ NGrams(const std::string &thestring, long int numb_of_ngrams, long int length_of
     return output;
 }
 
+std::vector<uint64_t> NGram_Codes(const std::string &thestring, long int L, long int U) {
+    std::vector<uint64_t> output;
+    Visit_NGram_Codes(thestring, L, U, [&](uint64_t code) { output.push_back(code); });
+    std::sort(output.begin(), output.end());
+    output.erase(std::unique(output.begin(), output.end()), output.end());
+    return output;
+}
+
+long int NGram_Code_Match_Count(const std::vector<uint64_t> &A, const std::vector<uint64_t> &B) {
+    long int count = 0;
+    auto a         = A.begin();
+    auto b         = B.begin();
+    while((a != A.end()) && (b != B.end())) {
+        if(*a < *b) {
+            ++a;
+        } else if(*b < *a) {
+            ++b;
+        } else {
+            ++count;
+            ++a;
+            ++b;
+        }
+    }
+    return count;
+}
+
 std::set<std::string> NGram_Matches(const std::set<std::string> &A, const std::set<std::string> &B) {
     std::set<std::string> output;
     std::set_intersection(A.cbegin(), A.cend(), B.cbegin(), B.cend(), std::inserter(output, output.begin()));
@@ -132,8 +164,10 @@ std::string ALongestCommonSubstring(const std::string &A, const std::string &B)
     //  "ABCDEF_FEDCBA" and "CDEFED" could return "CDE" or "FED". Both are substrings and have equal length.
     //  "ABCDEFABC" and "ABC" will uniquely return "ABC". But there are two such substrings. This may be relevant.
     //
-    // The code below finds one of the longest substrings (I think). If the user doesn't care (often the case) and
-    // still chooses to use this routine, then so be it!
+    // The code below finds one of the longest substrings. If the user doesn't care (often the case) and still chooses
+    // to use this routine, then so be it!
+    //
+    // Only the lengths of the common suffixes are tracked; the substring is extracted once at the end.
 
     if(A.empty() || B.empty()) {
         return "";
@@ -142,161 +176,304 @@ std::string ALongestCommonSubstring(const std::string &A, const std::string &B)
         return ALongestCommonSubstring(B, A); // Less memory usage.
     }
 
-    std::vector<std::string> curr(B.size(), ""), prev(B.size(), ""), forswap;
-    std::string out;
+    std::vector<size_t> curr(B.size() + 1, 0), prev(B.size() + 1, 0);
+    size_t best_len = 0;
+    size_t best_end = 0; // One-past-the-end position in A.
     for(size_t i = 0; i < A.size(); ++i) {
         for(size_t j = 0; j < B.size(); ++j) {
-            if(A[i] != B[j]) {
-                if(out.size() < curr[j].size()) {
-                    out = curr[j];
-                }
-                curr[j].clear();
-            } else {
-                if(i == 0 || j == 0) {
-                    curr[j].clear();
-                } else {
-                    curr[j] = prev[j - 1];
-                }
-                curr[j] += A[i];
+            curr[j + 1] = (A[i] == B[j]) ? (prev[j] + 1) : 0;
+            if(best_len < curr[j + 1]) {
+                best_len = curr[j + 1];
+                best_end = i + 1;
             }
         }
-        forswap = std::move(curr);
-        curr    = std::move(prev);
-        prev    = std::move(forswap);
+        std::swap(curr, prev);
     }
+    return A.substr(best_end - best_len, best_len);
+}
 
-    for(size_t i = 0; i < curr.size(); ++i) {
-        if(out.size() < curr[i].size()) {
-            out = curr[i];
-        }
-        if(out.size() < prev[i].size()) {
-            out = prev[i];
+long int Longest_Common_Substring_Length(const std::string &A, const std::string &B) {
+    if(B.size() > A.size()) {
+        return Longest_Common_Substring_Length(B, A); // Less memory usage.
+    }
+
+    std::vector<long int> curr(B.size() + 1, 0), prev(B.size() + 1, 0);
+    long int best_len = 0;
+    for(size_t i = 0; i < A.size(); ++i) {
+        for(size_t j = 0; j < B.size(); ++j) {
+            curr[j + 1] = (A[i] == B[j]) ? (prev[j] + 1) : 0;
+            best_len    = EXPLICATORMAX(best_len, curr[j + 1]);
         }
+        std::swap(curr, prev);
     }
-    return out;
+    return best_len;
 }
 
-//-------------------------------------------------------------------------------------------------------------------------------
-//-------------------------------------------------- Common text transformations
-//------------------------------------------------
-//-------------------------------------------------------------------------------------------------------------------------------
-static std::string &Canonicalize_String(std::string &in, const unsigned char &opts) {
-    // This function can be used as a filter OR as a pass-in-and-act-on-it function.
-
-    // Transform to all upper case.
-    if((opts & CANONICALIZE::TO_UPPER) == CANONICALIZE::TO_UPPER) {
-        // Using the C (ctype.h or cctype needed) way. No locale involved, I think.
-        std::string temp;
-        std::transform(in.begin(), in.end(), std::back_inserter(temp), ::toupper);
-        in = temp;
-
-        // Using the C++ <locale> way. (Requires a specific locale.)
-        // for (size_t i=0; i<in.length(); ++i) in[i] = toupper(in[i],loc);
+// This is the standard online construction. Transitions are accumulated in small per-state lists and then compacted.
+Suffix_Automaton::Suffix_Automaton(const std::string &text) {
+    std::vector<std::vector<std::pair<char, int32_t>>> edges;
+    edges.reserve(2 * text.size() + 1);
+    this->lens.reserve(2 * text.size() + 1);
+    this->links.reserve(2 * text.size() + 1);
 
-        // Using Boost. This way is fairly fast.
-        // boost::to_upper(in);
-    }
-
-    // Whitespace filter. Works for beginning, end, and interim whitespaces.
-    if((opts & CANONICALIZE::TRIM) == CANONICALIZE::TRIM) {
-        // stringstream >> will spit out an empty string if there is trailing space. This routine *requires* such space!
-        std::stringstream ss(in + " ");
-        if(!ss.good()) {
-            return in;
+    const auto find_edge = [&](int32_t s, char c) -> std::pair<char, int32_t> * {
+        for(auto &e : edges[s]) {
+            if(e.first == c) return &e;
         }
-        in.clear();
-        std::string temp;
-        ss >> temp;
-        do {
-            if(!temp.empty()) {
-                in += temp;
-            }
-            ss >> temp;
-            if(!temp.empty() && ss.good()) {
-                in += " ";
+        return nullptr;
+    };
+
+    this->lens.push_back(0);
+    this->links.push_back(-1);
+    edges.emplace_back();
+    int32_t last = 0;
+
+    for(const char c : text) {
+        const auto cur = static_cast<int32_t>(this->lens.size());
+        this->lens.push_back(this->lens[last] + 1);
+        this->links.push_back(0);
+        edges.emplace_back();
+
+        int32_t p = last;
+        while((p != -1) && (find_edge(p, c) == nullptr)) {
+            edges[p].emplace_back(c, cur);
+            p = this->links[p];
+        }
+        if(p != -1) {
+            const int32_t q = find_edge(p, c)->second;
+            if(this->lens[p] + 1 == this->lens[q]) {
+                this->links[cur] = q;
+            } else {
+                const auto clone = static_cast<int32_t>(this->lens.size());
+                this->lens.push_back(this->lens[p] + 1);
+                this->links.push_back(this->links[q]);
+                edges.push_back(edges[q]);
+                while(p != -1) {
+                    auto *e = find_edge(p, c);
+                    if((e == nullptr) || (e->second != q)) break;
+                    e->second = clone;
+                    p         = this->links[p];
+                }
+                this->links[q]   = clone;
+                this->links[cur] = clone;
             }
-        } while(ss.good());
+        }
+        last = cur;
     }
 
-    // Whitespace filter. Works for beginning, end, and interim whitespaces.
-    if((opts & CANONICALIZE::TRIM_ENDS) == CANONICALIZE::TRIM_ENDS) {
-        const std::string whitespace(" \t"); //\f\v\n\r"); //Consider vertical tabs and newlines too? Don't assume so...
-
-        // Trailing.
-        const auto last_non = in.find_last_not_of(whitespace);
-        if(last_non != std::string::npos) {
-            in.erase(last_non + 1);
-        } else { // All whitespace!
-            in.clear();
+    // Compact the transitions.
+    this->offsets.reserve(edges.size() + 1);
+    this->offsets.push_back(0);
+    for(const auto &es : edges) {
+        for(const auto &e : es) {
+            this->edge_chars.push_back(e.first);
+            this->edge_targets.push_back(e.second);
         }
+        this->offsets.push_back(static_cast<uint32_t>(this->edge_chars.size()));
+    }
+}
 
-        // Preceeding.
-        const auto first_non = in.find_first_not_of(whitespace);
-        if(first_non != std::string::npos) {
-            in.erase(0, first_non);
-        } else { // All whitespace!
-            in.clear();
-        }
+int32_t Suffix_Automaton::Next(int32_t state, char c) const {
+    for(uint32_t i = this->offsets[state]; i < this->offsets[state + 1]; ++i) {
+        if(this->edge_chars[i] == c) return this->edge_targets[i];
     }
+    return -1;
+}
 
-    // Remove ALL whitespace, leaving a single, long, whitespace-less string (in the order they originally were in.)
-    if((opts & CANONICALIZE::TRIM_ALL) == CANONICALIZE::TRIM_ALL) {
-        std::stringstream inss(in + " ");
-        in.clear();
-        std::string theword;
-        while(inss.good()) {
-            inss >> theword;
-            if(!theword.empty() && inss.good()) {
-                in += theword;
-            }
+long int Suffix_Automaton::Longest_Common_Substring_Length(const std::string &S) const {
+    long int best_len = 0;
+    this->Walk(S, [&](size_t, long int len) -> void { best_len = EXPLICATORMAX(best_len, len); });
+    return best_len;
+}
+
+void Suffix_Automaton::Save(Snapshot_Writer &w) const {
+    w.Put_Vector(this->lens);
+    w.Put_Vector(this->links);
+    w.Put_Vector(this->offsets);
+    w.Put_Vector(this->edge_chars);
+    w.Put_Vector(this->edge_targets);
+}
+
+Suffix_Automaton Suffix_Automaton::Load(Snapshot_Reader &r) {
+    Suffix_Automaton out;
+    out.lens         = r.Get_Vector<int32_t>();
+    out.links        = r.Get_Vector<int32_t>();
+    out.offsets      = r.Get_Vector<uint32_t>();
+    out.edge_chars   = r.Get_Vector<char>();
+    out.edge_targets = r.Get_Vector<int32_t>();
+
+    // Walk() follows links and edges without checking them, so they must all refer to valid states.
+    const auto N = out.lens.size();
+    if(N == 0) {
+        if(!out.links.empty() || !out.offsets.empty() || !out.edge_chars.empty() || !out.edge_targets.empty()) {
+            throw std::runtime_error("Suffix automaton is malformed");
         }
+        return out;
     }
+    if((out.links.size() != N) || (out.offsets.size() != (N + 1)) || (out.offsets.front() != 0)
+       || (out.offsets.back() != out.edge_chars.size()) || (out.edge_targets.size() != out.edge_chars.size())
+       || !std::is_sorted(out.offsets.begin(), out.offsets.end())) {
+        throw std::runtime_error("Suffix automaton is malformed");
+    }
+    const auto is_state = [N](int32_t s) -> bool { return (0 <= s) && (static_cast<size_t>(s) < N); };
+    if(!std::all_of(out.links.begin() + 1, out.links.end(), is_state)
+       || !std::all_of(out.edge_targets.begin(), out.edge_targets.end(), is_state)) {
+        throw std::runtime_error("Suffix automaton is malformed");
+    }
+    return out;
+}
 
-    // Remove all non-[ A-Za-z] characters.
-    if((opts & CANONICALIZE::TO_AZ) == CANONICALIZE::TO_AZ) {
-        for(auto it = in.begin(); it != in.end(); ++it) {
-            if((*it) != ' ') {
-                if(!(isininc('A', *it, 'Z') || isininc('a', *it, 'z'))) { // !( ((*it) >= 'A') && ((*it) <= 'Z') )  &&
-                                                                          // !( ((*it) >= 'a') && ((*it) <= 'z') ) ){
-                    in.erase(it);
-                    --it;
-                }
-            }
-        }
+//-------------------------------------------------------------------------------------------------------------------------------
+//-------------------------------------------------- Common text transformations
+//------------------------------------------------
+//-------------------------------------------------------------------------------------------------------------------------------
+// Character classes used for canonicalization.
+namespace {
+    const unsigned char CC_ALPHA = 1; // [A-Za-z].
+    const unsigned char CC_NUM   = 2; // [0-9.-].
+    const unsigned char CC_SPACE = 4; // Whitespace, as understood by std::istream (i.e., " \t\n\v\f\r").
+    const unsigned char CC_EDGE  = 8; // Whitespace, as understood by TRIM_ENDS (i.e., " \t").
+}
+
+static constexpr std::array<unsigned char, 256> Make_Canonicalize_Classes(void) {
+    std::array<unsigned char, 256> t{};
+    for(int c = 'A'; c <= 'Z'; ++c) t[c] |= CC_ALPHA;
+    for(int c = 'a'; c <= 'z'; ++c) t[c] |= CC_ALPHA;
+    for(int c = '0'; c <= '9'; ++c) t[c] |= CC_NUM;
+    t['.'] |= CC_NUM;
+    t['-'] |= CC_NUM;
+    for(const unsigned char c : {' ', '\t', '\n', '\v', '\f', '\r'}) t[c] |= CC_SPACE;
+    t[' '] |= CC_EDGE;
+    t['\t'] |= CC_EDGE;
+    return t;
+}
+static constexpr std::array<unsigned char, 256> Canonicalize_Classes = Make_Canonicalize_Classes();
+
+// The canonicalization operations were originally applied one after another, i.e., TO_UPPER, TRIM, TRIM_ENDS, TRIM_ALL,
+// TO_AZ, TO_NUM, and finally TO_NUMAZ. This routine applies them all in a single pass, producing identical output.
+//
+// The whitespace operations are applied before the character filters, so they are considered first. TRIM_ALL subsumes
+// TRIM and TRIM_ENDS, and TRIM subsumes TRIM_ENDS. The filters each retain spaces, so they never interfere with the
+// whitespace operations; they simply discard characters which would have survived otherwise.
+//
+// The output is never longer than the input, so 'out' needs room for (at most) N characters. 'in' and 'out' may alias.
+size_t Canonicalize_String(const char *in, size_t N, unsigned char mask, char *out) {
+    const bool to_upper  = BITMASK_BITS_ARE_SET(mask, CANONICALIZE::TO_UPPER);
+    const bool trim_all  = BITMASK_BITS_ARE_SET(mask, CANONICALIZE::TRIM_ALL);
+    const bool trim      = !trim_all && BITMASK_BITS_ARE_SET(mask, CANONICALIZE::TRIM);
+    const bool trim_ends = !trim_all && !trim && BITMASK_BITS_ARE_SET(mask, CANONICALIZE::TRIM_ENDS);
+    const bool to_az     = BITMASK_BITS_ARE_SET(mask, CANONICALIZE::TO_AZ);
+    const bool to_num    = BITMASK_BITS_ARE_SET(mask, CANONICALIZE::TO_NUM);
+    const bool to_numaz  = BITMASK_BITS_ARE_SET(mask, CANONICALIZE::TO_NUMAZ);
+
+    size_t i   = 0;
+    size_t end = N;
+    if(trim_ends) {
+        while((i < end) && (Canonicalize_Classes[static_cast<unsigned char>(in[i])] & CC_EDGE)) ++i;
+        while((i < end) && (Canonicalize_Classes[static_cast<unsigned char>(in[end - 1])] & CC_EDGE)) --end;
     }
 
-    // Remove all non-[ 0-9-.] characters.
-    if((opts & CANONICALIZE::TO_NUM) == CANONICALIZE::TO_NUM) {
-        for(auto it = in.begin(); it != in.end(); ++it) {
-            if((*it) != ' ') {
-                if(!(isininc('1', *it, '9') || (*it == '0') || (*it == '.') || (*it == '-'))) {
-                    in.erase(it);
-                    --it;
-                }
-            }
-        }
+    const auto keep = [&](unsigned char c) -> bool {
+        const auto cc = Canonicalize_Classes[c];
+        if(c == ' ') return true;
+        return (!to_az || (cc & CC_ALPHA)) && (!to_num || (cc & CC_NUM)) && (!to_numaz || (cc & (CC_ALPHA | CC_NUM)));
+    };
+
+    size_t j           = 0;
+    bool seen_word     = false; // Used by TRIM to decide whether whitespace separates two words.
+    bool pending_space = false;
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    // Fast path: blocks consisting entirely of retained, non-whitespace ASCII characters can be case-folded and copied
+    // wholesale. Anything else is handled by the scalar loop below.
+    const auto in_range = [](auto v, char lo, char hi, auto cmpgt, auto set1, auto and_) {
+        return and_(cmpgt(v, set1(static_cast<char>(lo - 1))), cmpgt(set1(static_cast<char>(hi + 1)), v));
+    };
+#endif
+#if defined(__AVX2__)
+    while((i + 32) <= end) {
+        const auto cmpgt = [](__m256i a, __m256i b) { return _mm256_cmpgt_epi8(a, b); };
+        const auto set1  = [](char c) { return _mm256_set1_epi8(c); };
+        const auto and_  = [](__m256i a, __m256i b) { return _mm256_and_si256(a, b); };
+        const auto or_   = [](__m256i a, __m256i b) { return _mm256_or_si256(a, b); };
+
+        const __m256i v     = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+        const __m256i lower = in_range(v, 'a', 'z', cmpgt, set1, and_);
+        const __m256i alpha = or_(lower, in_range(v, 'A', 'Z', cmpgt, set1, and_));
+        const __m256i num   = or_(in_range(v, '0', '9', cmpgt, set1, and_),
+                                  or_(_mm256_cmpeq_epi8(v, set1('.')), _mm256_cmpeq_epi8(v, set1('-'))));
+        const __m256i space = or_(_mm256_cmpeq_epi8(v, set1(' ')), in_range(v, '\t', '\r', cmpgt, set1, and_));
+        __m256i ok = _mm256_andnot_si256(space, _mm256_cmpgt_epi8(v, set1(static_cast<char>(0x1F))));
+        if(to_az) ok = and_(ok, alpha);
+        if(to_num) ok = and_(ok, num);
+        if(to_numaz) ok = and_(ok, or_(alpha, num));
+        if(static_cast<uint32_t>(_mm256_movemask_epi8(ok)) != 0xFFFFFFFFU) break;
+
+        const __m256i folded = to_upper ? _mm256_sub_epi8(v, and_(lower, set1(0x20))) : v;
+        if(trim && pending_space) out[j++] = ' ';
+        pending_space = false;
+        seen_word     = true;
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + j), folded);
+        i += 32;
+        j += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    while((i + 16) <= end) {
+        const auto cmpgt = [](__m128i a, __m128i b) { return _mm_cmpgt_epi8(a, b); };
+        const auto set1  = [](char c) { return _mm_set1_epi8(c); };
+        const auto and_  = [](__m128i a, __m128i b) { return _mm_and_si128(a, b); };
+        const auto or_   = [](__m128i a, __m128i b) { return _mm_or_si128(a, b); };
+
+        const __m128i v     = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+        const __m128i lower = in_range(v, 'a', 'z', cmpgt, set1, and_);
+        const __m128i alpha = or_(lower, in_range(v, 'A', 'Z', cmpgt, set1, and_));
+        const __m128i num   = or_(in_range(v, '0', '9', cmpgt, set1, and_),
+                                  or_(_mm_cmpeq_epi8(v, set1('.')), _mm_cmpeq_epi8(v, set1('-'))));
+        const __m128i space = or_(_mm_cmpeq_epi8(v, set1(' ')), in_range(v, '\t', '\r', cmpgt, set1, and_));
+        __m128i ok = _mm_andnot_si128(space, _mm_cmpgt_epi8(v, set1(static_cast<char>(0x1F))));
+        if(to_az) ok = and_(ok, alpha);
+        if(to_num) ok = and_(ok, num);
+        if(to_numaz) ok = and_(ok, or_(alpha, num));
+        if(_mm_movemask_epi8(ok) != 0xFFFF) break;
+
+        const __m128i folded = to_upper ? _mm_sub_epi8(v, and_(lower, set1(0x20))) : v;
+        if(trim && pending_space) out[j++] = ' ';
+        pending_space = false;
+        seen_word     = true;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + j), folded);
+        i += 16;
+        j += 16;
     }
+#endif
 
-    // Remove all non-[ A-Za-z0-9-.]
-    if((opts & CANONICALIZE::TO_NUMAZ) == CANONICALIZE::TO_NUMAZ) {
-        for(auto it = in.begin(); it != in.end(); ++it) {
-            if((*it) != ' ') {
-                if(!(isininc('1', *it, '9') || (*it == '0') || (*it == '.') || (*it == '-') || isininc('A', *it, 'Z')
-                     || isininc('a', *it, 'z'))) {
-                    in.erase(it);
-                    --it;
-                }
-            }
+    for(; i < end; ++i) {
+        auto c = static_cast<unsigned char>(in[i]);
+        if(to_upper && isininc('a', c, 'z')) c = static_cast<unsigned char>(c - 'a' + 'A');
+
+        if((trim_all || trim) && (Canonicalize_Classes[c] & CC_SPACE)) {
+            pending_space = seen_word;
+            continue;
         }
+        if(trim && pending_space) out[j++] = ' ';
+        pending_space = false;
+        seen_word     = true;
+        if(keep(c)) out[j++] = static_cast<char>(c);
     }
+    return j;
+}
 
-    return in;
+void Canonicalize_String(const std::string &in, unsigned char mask, std::string &out) {
+    out.resize(in.size());
+    const auto N = Canonicalize_String(in.data(), in.size(), mask, &out[0]);
+    out.resize(N);
+    return;
 }
 
 std::string Canonicalize_String2(const std::string &in, const unsigned char &mask) {
-    std::string temp(in);
-    Canonicalize_String(temp, mask);
-    return temp;
+    std::string out;
+    Canonicalize_String(in, mask, out);
+    return out;
 }
 
 } //namespace explicator_internals
@@ -1,12 +1,18 @@
 // String.h
 #pragma once
 
+#include <stdint.h>
 #include <map>
 #include <set>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace explicator_internals {
 
+class Snapshot_Writer; // See Snapshot.h.
+class Snapshot_Reader;
+
 //-------------------------------------------------------------------------------------------------------------------------------
 //------------------------------------------------ Self-contained N-gram routines
 //-----------------------------------------------
@@ -25,12 +31,149 @@ NGrams(const std::string &thestring, long int numb_of_ngrams, long int length_of
 std::set<std::string> NGram_Matches(const std::set<std::string> &A, const std::set<std::string> &B);
 long int NGram_Match_Count(const std::set<std::string> &A, const std::set<std::string> &B);
 
+// Streaming N-gram routines. These split on whitespace (as std::istream does) and visit character N-grams within each
+// word, in order, as views into the original buffer. Nothing is copied and nothing is allocated.
+//
+// Advances 'pos' past the next whitespace-delimited word, returning false if there are no more words.
+inline bool Next_Word(std::string_view s, size_t &pos, std::string_view &word) {
+    const auto is_space = [](char c) -> bool { return (c == ' ') || (('\t' <= c) && (c <= '\r')); };
+    while((pos < s.size()) && is_space(s[pos])) ++pos;
+    if(pos == s.size()) return false;
+    const auto start = pos;
+    while((pos < s.size()) && !is_space(s[pos])) ++pos;
+    word = s.substr(start, pos - start);
+    return true;
+}
+
+// Calls f(std::string_view) for every character N-gram of length N.
+template <class F> void Visit_NGrams(std::string_view s, long int N, F f) {
+    if(N < 1) return;
+    const auto n = static_cast<size_t>(N);
+    size_t pos   = 0;
+    std::string_view word;
+    while(Next_Word(s, pos, word)) {
+        for(size_t k = 0; (k + n) <= word.size(); ++k) f(word.substr(k, n));
+    }
+    return;
+}
+
+// Calls f(std::string_view) for every character N-gram with length in [L,U] in a single pass. N-grams are visited in
+// order of their starting position, and then by length.
+template <class F> void Visit_NGrams(std::string_view s, long int L, long int U, F f) {
+    if(U < L) return;
+    const auto l = static_cast<size_t>((L < 1) ? 1 : L);
+    const auto u = static_cast<size_t>(U);
+    size_t pos   = 0;
+    std::string_view word;
+    while(Next_Word(s, pos, word)) {
+        for(size_t k = 0; (k + l) <= word.size(); ++k) {
+            for(size_t n = l; (n <= u) && ((k + n) <= word.size()); ++n) f(word.substr(k, n));
+        }
+    }
+    return;
+}
+
+// Packed N-gram codes. N-grams of up to NGram_Code_Max_Length characters are packed into an integer along with their
+// length, so codes for different N-grams (of any length) never collide. Sorted codes are ordered first by length and
+// then lexicographically (by unsigned byte value).
+const long int NGram_Code_Max_Length = 7;
+inline uint64_t NGram_Code(std::string_view ngram) {
+    uint64_t code = 0;
+    for(const char c : ngram) code = (code << 8) | static_cast<unsigned char>(c);
+    return code | (static_cast<uint64_t>(ngram.size()) << 56);
+}
+
+// Calls f(uint64_t) with the packed code of every character N-gram with length in [L,U] in a single pass, in the same
+// order as Visit_NGrams(). Codes are built incrementally, so each is O(1). U must not exceed NGram_Code_Max_Length.
+template <class F> void Visit_NGram_Codes(std::string_view s, long int L, long int U, F f) {
+    if((U < L) || (NGram_Code_Max_Length < U)) return;
+    const auto l = static_cast<size_t>((L < 1) ? 1 : L);
+    const auto u = static_cast<size_t>(U);
+    size_t pos   = 0;
+    std::string_view word;
+    while(Next_Word(s, pos, word)) {
+        for(size_t k = 0; (k + l) <= word.size(); ++k) {
+            uint64_t bytes = 0;
+            for(size_t n = 1; (n <= u) && ((k + n) <= word.size()); ++n) {
+                bytes = (bytes << 8) | static_cast<unsigned char>(word[k + n - 1]);
+                if(l <= n) f(bytes | (static_cast<uint64_t>(n) << 56));
+            }
+        }
+    }
+    return;
+}
+
+// Returns the sorted, unique codes of every character N-gram with length in [L,U].
+std::vector<uint64_t> NGram_Codes(const std::string &thestring, long int L, long int U);
+
+// Counts the elements common to two sorted, unique sequences of codes.
+long int NGram_Code_Match_Count(const std::vector<uint64_t> &A, const std::vector<uint64_t> &B);
+
 //-------------------------------------------------------------------------------------------------------------------------------
 //--------------------------------------------- Substring and Subsequence routines
 //----------------------------------------------
 //-------------------------------------------------------------------------------------------------------------------------------
 std::string ALongestCommonSubstring(const std::string &A, const std::string &B);
 
+// Returns the length of the longest common sequential substring. Only lengths are tracked, so nothing is copied.
+long int Longest_Common_Substring_Length(const std::string &A, const std::string &B);
+
+// A suffix automaton recognizes every substring of a fixed text. It is built in O(|text|) and is useful when one text
+// is compared against many others, since each comparison is then a single O(|other|) walk over the other string.
+class Suffix_Automaton {
+  public:
+    Suffix_Automaton() = default;
+    explicit Suffix_Automaton(const std::string &text);
+
+    // Walks the given string through the automaton. For each position i, f(i, len) is invoked where len is the length
+    // of the longest substring of the text which ends at position i of the given string (i.e., the matching
+    // statistics). This is sufficient to recover the longest (or the top-N longest) common substrings.
+    template <class F>
+    void Walk(const std::string &S, F &&f) const;
+
+    // Returns the length of the longest common sequential substring of the text and the given string.
+    long int Longest_Common_Substring_Length(const std::string &S) const;
+
+    // Writes the automaton to a lexicon snapshot, or reads one back. Load throws std::runtime_error if the automaton is
+    // malformed.
+    void Save(Snapshot_Writer &w) const;
+    static Suffix_Automaton Load(Snapshot_Reader &r);
+
+  private:
+    // Transitions are stored compactly: the edges of state s are edge_chars/edge_targets[offsets[s] ... offsets[s+1]).
+    std::vector<int32_t> lens;
+    std::vector<int32_t> links;
+    std::vector<uint32_t> offsets;
+    std::vector<char> edge_chars;
+    std::vector<int32_t> edge_targets;
+
+    int32_t Next(int32_t state, char c) const;
+};
+
+template <class F>
+void Suffix_Automaton::Walk(const std::string &S, F &&f) const {
+    int32_t v   = 0;
+    int32_t len = 0;
+    for(size_t i = 0; i < S.size(); ++i) {
+        const char c = S[i];
+        int32_t n    = (this->lens.empty()) ? -1 : this->Next(v, c);
+        while((n < 0) && (v != 0)) {
+            v   = this->links[v];
+            len = this->lens[v];
+            n   = this->Next(v, c);
+        }
+        if(n < 0) {
+            v   = 0;
+            len = 0;
+        } else {
+            v = n;
+            ++len;
+        }
+        f(i, static_cast<long int>(len));
+    }
+    return;
+}
+
 //-------------------------------------------------------------------------------------------------------------------------------
 //-------------------------------------------------- Common text transformations
 //------------------------------------------------
@@ -45,6 +188,13 @@ namespace CANONICALIZE {                 // Canonicalization masks. Use several
     const unsigned char TO_NUMAZ  = 128; // Remove all non [ A-Za-z0-9.-] characters.
 }
 
+// Canonicalizes [in, in+N) into a caller-provided buffer in a single pass, returning the number of characters written.
+// The output is never longer than the input. 'in' and 'out' may alias.
+size_t Canonicalize_String(const char *in, size_t N, unsigned char mask, char *out);
+
+// Canonicalizes into 'out', reusing its storage. 'in' and 'out' may be the same string.
+void Canonicalize_String(const std::string &in, unsigned char mask, std::string &out);
+
 std::string Canonicalize_String2(const std::string &in, const unsigned char &mask); //<--- prefer this version
 
 } //namespace explicator_internals